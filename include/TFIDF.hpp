@@ -10,8 +10,17 @@
 #ifndef _TFIDF_HPP
 #define _TFIDF_HPP
 
+#include <array>
+#include <memory>
 #include "count_vectorization.hpp"
 #include "file_operations.hpp"
+#include "batch_classifier.hpp"
+#include "streaming.hpp"
+#include "trained_model.hpp"
+#include "online_classifier.hpp"
+#include "classify_server.hpp"
+#include "incremental_model.hpp"
+#include "profiler.hpp"
 
 
 namespace TFIDF { // namespace TFIDF
@@ -40,35 +49,31 @@ namespace TFIDF { // namespace TFIDF
             std::vector<cats::Category> trained_cat_vect;
             corpus::Corpus un_trained_corpus;
             std::vector<std::string> un_trained_cats_correct;
+            std::unique_ptr<corpus::FrozenCorpus> trained_frozen_corpus;    ///< CSR view of `trained_corpus` (use_csr only).
+            std::unique_ptr<corpus::FrozenCorpus> un_trained_frozen_corpus; ///< CSR view of `un_trained_corpus` (use_csr only).
+            cats::centroids_s trained_centroids; ///< Category centroids of the trained CSR corpus (use_csr only).
+            std::shared_ptr<const cats::CentroidMatrix> trained_centroid_matrix; ///< Frozen, normalized centroids every unknown document is scored against.
+            std::shared_ptr<const model::TrainedModel> trained_model; ///< Model file the centroids were loaded from (load_model only).
+            std::shared_ptr<const cats::OnlineClassifier> online_classifier; ///< Single-text classifier over the trained centroids and IDF.
+            cats::IncrementalModel incremental_model; ///< Sufficient statistics of every trained batch (use_csr only).
 
             /**
-             * @struct Timer
-             * @brief A structure used for measuring performance during the TF-IDF computation.
+             * @brief Times the Vectorization, TF-IDF, Categories and Unknown Classification sections.
              * 
-             * @details The `Timer` struct helps in timing how long certain operations take during 
-             *          the TF-IDF computation, allowing performance metrics to be collected.
-             */
-            struct Timer {
-                std::chrono::_V2::system_clock::time_point start;
-                std::chrono::_V2::system_clock::time_point end;
-                double duration;
-
-                /**
-                 * @brief Starts the timer.
-                 */
-                void start_timer() {
-                    start = std::chrono::high_resolution_clock::now();
-                }
-                
-                /**
-                 * @brief Ends the timer and calculates the duration.
-                 */
-                void end_timer() {
-                    end = std::chrono::high_resolution_clock::now();
-                    duration = elapsed_time_ms(start, end);
-                }
-            };
-            Timer timer;
+             * @details Every section is also added to `prof::profiler()`, where the sub-stages
+             * timed inside it (`PROF_SCOPE`) are reported as its children.
+             */
+            prof::SectionTimer timer;
+
+            /**
+             * @brief Milliseconds spent in each `section_type_` by this object, with nanosecond resolution.
+             */
+            std::array<double, 4> section_durations{};
+
+            /**
+             * @brief Work each NUMA node of the pool ran in each `section_type_` (one node unless `use_numa`).
+             */
+            std::array<std::vector<tpool::NodeStats>, 4> section_node_stats;
 
             /**
              * @brief Constructs a TFIDF_ object with user-defined configuration settings.
@@ -86,6 +91,12 @@ namespace TFIDF { // namespace TFIDF
              * @param convert_output_to_csv Whether to convert output to CSV (default: true).
              * @param is_base_lvl_logging Whether to log errors to stderr (default: true).
              * @param num_threads Number of threads for parallel processing (default: -1 for dynamic threads).
+             * @param use_csr Whether to run TF-IDF, categories, and classification over a frozen CSR corpus (default: false).
+             * @param use_streaming Whether to vectorize through the bounded streaming pipeline, implies `use_csr` (default: false).
+             * @param use_training_idf Whether to weight unknown documents with the trained corpus's IDF instead of their own (default: false).
+             * @param num_important_terms Number of most important terms kept per Category (default: 5).
+             * @param use_arenas Whether document term maps come from per-thread arenas instead of the heap (default: false).
+             * @param use_numa Whether workers are pinned over the NUMA nodes, which each process and hold their own slice of the documents (default: false).
              */
             TFIDF_(
                    bool is_parallel=true, 
@@ -101,20 +112,34 @@ namespace TFIDF { // namespace TFIDF
                    bool output_classification=true,
                    bool convert_output_to_csv=true,
                    bool is_base_lvl_logging=true,
-                   int num_threads=64
+                   int num_threads=64,
+                   bool use_csr=false,
+                   bool use_streaming=false,
+                   bool use_training_idf=false,
+                   size_t num_important_terms=topk::DEFAULT_IMPORTANT_TERMS,
+                   bool use_arenas=false,
+                   bool use_numa=false
                   ) 
-                : task_settings{is_parallel, 
+                : trained_corpus{use_arenas ? arena::Mode::arena : arena::Mode::heap},
+                un_trained_corpus{use_arenas ? arena::Mode::arena : arena::Mode::heap},
+                task_settings{is_parallel, 
                               (un_trained_input_file.empty() || un_trained_input_file == "") ? false : complete_all_tasks,
                               classify_unknown, record_performance, (record_performance) ? output_performance : false,
                               output_classification, (output_classification && output_performance) ? convert_output_to_csv : false, is_base_lvl_logging,
-                              (is_parallel == false) ? 1 : num_threads
+                              (is_parallel == false) ? 1 : num_threads,
+                              use_csr || use_streaming,
+                              use_streaming,
+                              use_training_idf,
+                              num_important_terms
                              },
                 input_files{trained_input_file, 
                               un_trained_input_file, 
                               un_trained_correct_classification_file, 
                               output_results_file,
                               processed_data_csv_file
-                             }
+                             },
+                thread_pool{is_parallel && use_numa ? std::make_unique<tpool::ThreadPool>(tpool::workers_for(num_threads), numa::Topology::detect())
+                                                    : std::make_unique<tpool::ThreadPool>(is_parallel ? tpool::workers_for(num_threads) : 0)}
             {}
 
             /**
@@ -132,6 +157,67 @@ namespace TFIDF { // namespace TFIDF
              */
             void process_all_data();
 
+            /**
+             * @brief Adds labeled documents to the trained model without retraining on earlier ones.
+             * 
+             * @details Call after `process_training_data()`, requires `use_csr`. The documents are
+             * vectorized and folded into `incremental_model`, then the IDF, centroids and online
+             * classifier are refreshed. The result matches training once on both CSV files
+             * concatenated, see `cats::IncrementalModel`. Earlier documents are not revisited,
+             * but the IDF and every centroid are rebuilt over the whole vocabulary. Timed under
+             * the `add-training-data` profiler site, `section_durations` are left untouched.
+             * 
+             * @param csv_file A CSV file laid out like the trained input file.
+             * @return False if the mode is not `use_csr`, there is no trained model or a step failed (logged).
+             */
+            bool add_training_data(const std::string& csv_file);
+
+            /**
+             * @brief Saves the vocabulary, training IDF and category centroids to a binary model file.
+             * 
+             * @details Call after `process_training_data()`.
+             * 
+             * @param model_file The model file, overwritten.
+             * @return False if there is no trained model or it cannot be written (logged).
+             */
+            bool save_model(const std::string& model_file);
+
+            /**
+             * @brief Loads a model file saved by `save_model()` in place of `process_training_data()`.
+             * 
+             * @details The file is mapped and its centroid matrix is used in place, only the 
+             * vocabulary is interned, so `process_testing_data()` can run right after without
+             * the training CSV.
+             * 
+             * @param model_file The model file.
+             * @return False if the file cannot be loaded (logged).
+             */
+            bool load_model(const std::string& model_file);
+
+            /**
+             * @brief Classifies one raw text against the trained or loaded model.
+             * 
+             * @details Thread-safe and reentrant, writes no global state (see `cats::OnlineClassifier`). 
+             * Unlike `process_testing_data()` the text is always weighted with the trained IDF.
+             * 
+             * @param text The raw text.
+             * @return The label, its score, and the terms that weighed most.
+             * @throws std::runtime_error if no model was trained or loaded.
+             */
+            cats::Prediction classify(std::string_view text) const;
+
+            /**
+             * @brief Creates a classification server over the trained or loaded model.
+             * 
+             * @details The server scores its micro-batches on this object's thread pool, so it 
+             * must be destroyed before this object.
+             * 
+             * @param settings Batching limits.
+             * @return The server, its batcher already running.
+             * @throws std::runtime_error if no model was trained or loaded.
+             */
+            std::unique_ptr<serve::ClassifyServer> make_server(const serve::ServerSettings& settings = serve::ServerSettings{});
+
         private:
 
             /**
@@ -149,6 +235,10 @@ namespace TFIDF { // namespace TFIDF
                 // bool output_to_file;
                 bool is_base_lvl_logging; // logs errors with std::cerr
                 int num_threads; // if -1 then dynamic # threads
+                bool use_csr; // frozen CSR corpus for TF-IDF, categories and classification
+                bool use_streaming; // documents are never all resident, only CSR rows are kept
+                bool use_training_idf; // unknown documents are weighted with the trained IDF, not their own
+                size_t num_important_terms; // top terms kept per Category
 
                 enum _TaskType {
                     _START_PERFORMANCE=0x02,
@@ -172,6 +262,56 @@ namespace TFIDF { // namespace TFIDF
             };
             InputFiles input_files;
 
+            /**
+             * @brief Persistent work-stealing pool shared by every parallel stage.
+             * 
+             * @details Sized from `num_threads` (or `NUMBER_OF_THREADS_MAX` when dynamic), 
+             * capped at the hardware thread count. The calling thread runs tasks too and is one 
+             * of the `num_threads`, so `tpool::workers_for()` starts one worker fewer. Sequential 
+             * runs get a pool with no workers, which runs every task on the calling thread. With 
+             * `use_numa` the workers are pinned over the nodes of `numa::Topology::detect()`.
+             */
+            std::unique_ptr<tpool::ThreadPool> thread_pool;
+
+            /**
+             * @brief Streams the trained CSV straight into `trained_frozen_corpus`, then runs TF-IDF and categories.
+             */
+            void process_training_data_streaming();
+
+            /**
+             * @brief TF-IDF and Category sections of the trained data, once it is vectorized.
+             */
+            void process_training_tfidf_and_categories();
+
+            /**
+             * @brief Vectorizes the read untrained corpus and calculates its TF-IDF.
+             * @return False if a step failed (already logged).
+             */
+            bool process_testing_corpus();
+
+            /**
+             * @brief Starts timing a section.
+             */
+            void start_section(section_type_ type);
+
+            /**
+             * @brief Stops timing the current section, records its duration and prints it if `output_performance`.
+             */
+            void end_section(section_type_ type);
+
+            /**
+             * @brief Builds `online_classifier` once the centroids and IDF are final.
+             */
+            void build_online_classifier();
+
+            /**
+             * @brief Returns the IDF table unknown documents are weighted with in `use_training_idf` mode.
+             * 
+             * @details The loaded model's table when there is one, otherwise the trained corpus's
+             * (in `use_csr` mode, the table of every batch added so far).
+             */
+            corpus::IdfTable training_idf() const;
+
             /**
              * @brief Handles errors by logging to stderr.
              * @param to_cerr The error message to log.
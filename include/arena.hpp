@@ -0,0 +1,133 @@
+/**
+ * @file arena.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the ThreadArenas memory resource, which gives every thread its own monotonic
+ *        arena for the term maps of a corpus's documents.
+ *
+ * @details A vectorized document holds three small hash maps (`term_count`, `term_frequency`,
+ * `tf_idf`), so a corpus is tens of thousands to millions of tiny nodes, all allocated by the
+ * pool threads at once. With `Mode::arena` each allocation is a pointer bump in the calling
+ * thread's own `std::pmr::monotonic_buffer_resource`, with no lock and no shared allocator
+ * state, and deallocation is a no-op. The whole corpus is then freed by `release()`, one
+ * block list per thread, instead of one `free()` per node.
+ *
+ * Every map of a corpus shares the same `ThreadArenas`, so maps compare equal and move in O(1),
+ * whichever thread filled them. `Mode::heap` keeps the default `operator new` / `operator delete`
+ * and only counts, so both modes report comparable `AllocatorStats`.
+ *
+ * @note Arena memory is only reused after `release()`: a map that rehashes leaves its old
+ * bucket array behind. Copies of a map (`select_on_container_copy_construction`) use the
+ * default resource, so documents copied out of a corpus never point into its arenas.
+ */
+
+#ifndef _ARENA_HPP
+#define _ARENA_HPP
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+
+/**
+ * @namespace arena
+ * @brief Provides per-thread monotonic arenas for corpus documents.
+ */
+namespace arena {
+
+    /**
+     * @enum Mode
+     * @brief Where a `ThreadArenas` takes its memory from.
+     */
+    enum class Mode {
+        heap,  ///< `operator new` / `operator delete`, counted (the default allocator).
+        arena  ///< One monotonic arena per thread, freed all at once by `release()`.
+    };
+
+    /** @brief Size of the first block of every thread's arena, later blocks grow geometrically. */
+    constexpr size_t DEFAULT_BLOCK_SIZE{64 * 1024};
+
+    /**
+     * @struct AllocatorStats
+     * @brief Counters of a `ThreadArenas`, summed over every thread that allocated from it.
+     */
+    struct AllocatorStats {
+        size_t allocations{0};   ///< Allocation calls.
+        size_t deallocations{0}; ///< Deallocation calls (no-ops in `Mode::arena`).
+        size_t bytes{0};         ///< Bytes requested by allocations.
+        size_t live_bytes{0};    ///< Bytes requested and not deallocated (never decreases in `Mode::arena`).
+        size_t reserved{0};      ///< Bytes taken from the heap by arena blocks (0 in `Mode::heap`).
+        size_t blocks{0};        ///< Arena blocks taken from the heap (0 in `Mode::heap`).
+        size_t threads{0};       ///< Threads that allocated.
+    };
+
+    /**
+     * @class ThreadArenas
+     * @brief Memory resource that serves every thread from its own arena, or counts heap allocations.
+     *
+     * @details Thread-safe: a thread finds its arena through a small thread-local cache and
+     * only takes the registry lock on a cache miss, where it looks its own slot up again
+     * before creating one, so the resource keeps one slot per thread however many
+     * resources the thread alternates between.
+     */
+    class ThreadArenas : public std::pmr::memory_resource {
+
+        public:
+
+            /**
+             * @brief Creates a resource with no arenas, they are created by the first allocation of each thread.
+             * @param mode Arena or counted heap allocations.
+             * @param block_size Size of the first block of every arena.
+             */
+            explicit ThreadArenas(Mode mode = Mode::heap, size_t block_size = DEFAULT_BLOCK_SIZE);
+
+            /** @brief Frees every arena, nothing may still use the resource. */
+            ~ThreadArenas() override;
+
+            ThreadArenas(const ThreadArenas&) = delete;
+            ThreadArenas& operator=(const ThreadArenas&) = delete;
+
+            /** @brief Returns where the memory comes from. */
+            Mode mode() const {
+                return allocation_mode;
+            }
+
+            /**
+             * @brief Returns the counters summed over every thread.
+             * @details Safe to call while threads allocate, the counters are relaxed atomics
+             * with one writer each. Exact once no thread is allocating, a snapshot otherwise.
+             */
+            AllocatorStats stats() const;
+
+            /**
+             * @brief Frees every arena block at once, O(blocks) per thread whatever the number of allocations.
+             *
+             * @details Nothing allocated from the resource may be used afterwards. The counters
+             * restart from zero. Does nothing to heap allocations in `Mode::heap`.
+             */
+            void release();
+
+        private:
+
+            struct Slot; // per-thread arena and counters
+
+            Mode allocation_mode;
+            size_t block_size;
+            uint64_t instance_id;                     ///< Never reused, tells thread-local cache entries apart.
+            mutable std::mutex registry_mtx;          ///< Guards `slots`.
+            std::vector<std::unique_ptr<Slot>> slots; ///< One per thread that allocated.
+
+            /** @brief Returns the calling thread's slot, created on first use. */
+            Slot& local_slot();
+
+            void * do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void * p, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+} // namespace arena
+
+#endif // _ARENA_HPP
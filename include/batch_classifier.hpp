@@ -0,0 +1,239 @@
+/**
+ * @file batch_classifier.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the CentroidMatrix and BatchClassifier classes, which score many documents
+ *        against every category in one pass.
+ *
+ * @details `classify_text()` scores one document at a time against a list of `Category`
+ * objects. The batch classifier instead freezes every category into one immutable,
+ * term-major `CentroidMatrix` whose row `t` holds the weight of term `t` in every category,
+ * already divided by the category norm. Scoring a block of documents is then a sparse
+ * (documents × terms) by dense (terms × categories) product: every non-zero of a document
+ * reads one contiguous row of the matrix. Documents are read in place, never copied.
+ *
+ * The matrix is shared through `std::shared_ptr<const CentroidMatrix>`, so any number of
+ * classifiers and threads can use it without locking.
+ */
+
+#ifndef _BATCH_CLASSIFIER_HPP
+#define _BATCH_CLASSIFIER_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "categories.hpp"
+#include "csr_matrix.hpp"
+
+
+namespace cats {
+
+    /**
+     * @struct ScoredLabel
+     * @brief A category index and the cosine similarity of a document to it.
+     */
+    struct ScoredLabel {
+        size_t category; ///< Index into `CentroidMatrix::category_type()`.
+        double score;    ///< Cosine similarity, always > 0.
+    };
+
+    /**
+     * @class CentroidMatrix
+     * @brief Immutable, pre-normalized, term-major matrix of every category centroid.
+     */
+    class CentroidMatrix {
+
+        public:
+
+            /**
+             * @brief Builds the matrix from the categories of `get_all_cat_par()` / `get_all_cat_seq()`.
+             * @param cat_vect Categories with their centroid built.
+             */
+            static std::shared_ptr<const CentroidMatrix> from_categories(const std::vector<Category>& cat_vect);
+
+            /**
+             * @brief Builds the matrix from the dense centroids of `csr::get_all_centroids_csr()`.
+             * @param centroids The dense centroids and their norms.
+             */
+            static std::shared_ptr<const CentroidMatrix> from_centroids(const centroids_s& centroids);
+
+            /**
+             * @brief Wraps already normalized, term-major weights without copying them.
+             *
+             * @details Used by `model::TrainedModel` to classify straight out of a mapped model file.
+             *
+             * @param category_types Category type of every column.
+             * @param norms Centroid norm of every column.
+             * @param weights `num_terms` rows of `category_types.size()` weights.
+             * @param num_terms Number of rows.
+             * @param storage Keeps `weights` alive for the lifetime of the matrix.
+             */
+            static std::shared_ptr<const CentroidMatrix> from_weights(std::vector<std::string> category_types, std::vector<double> norms, 
+                                                                      const double * weights, size_t num_terms, std::shared_ptr<const void> storage);
+
+            /** @brief Returns the number of categories (columns). */
+            size_t num_categories() const {
+                return category_types.size();
+            }
+
+            /** @brief Returns the number of terms (rows), terms past it have no weight. */
+            size_t num_terms() const {
+                return num_of_terms;
+            }
+
+            /** @brief Returns the category type of column `c`. */
+            const std::string& category_type(size_t c) const {
+                return category_types[c];
+            }
+
+            /** @brief Returns the L2 norm of the centroid of column `c`, before normalization. */
+            double norm(size_t c) const {
+                return category_norms[c];
+            }
+
+            /**
+             * @brief Returns the normalized weights of term `term` in every category.
+             * @return Pointer to `num_categories()` values, or nullptr if the term has no weight.
+             */
+            const double * term_row(vocab::term_id term) const {
+                return term < num_of_terms ? weight_data + static_cast<size_t>(term) * category_types.size() : nullptr;
+            }
+
+            /** @brief Returns all `num_terms() * num_categories()` weights, row after row. */
+            const double * data() const {
+                return weight_data;
+            }
+
+            CentroidMatrix() = default;
+            CentroidMatrix(const CentroidMatrix&) = delete;
+            CentroidMatrix& operator=(const CentroidMatrix&) = delete;
+
+        private:
+
+            std::vector<std::string> category_types; ///< Category type of every column.
+            std::vector<double> category_norms;      ///< Centroid norm of every column.
+            std::vector<double> weights;             ///< Owned weights, empty when they live in `storage`.
+            std::shared_ptr<const void> storage;     ///< Owner of external weights (a mapped model file).
+            const double * weight_data{nullptr};     ///< `num_of_terms` rows of `num_categories()` weights.
+            size_t num_of_terms{0};                  ///< Number of rows.
+    };
+
+    /**
+     * @struct BatchScores
+     * @brief Top-k labels of a batch of documents, stored flat.
+     */
+    struct BatchScores {
+        size_t top_k{1};                 ///< Label slots per document.
+        std::vector<ScoredLabel> labels; ///< `top_k` slots per document, best first.
+        std::vector<size_t> counts;      ///< Number of filled slots per document (0 when nothing matched).
+
+        /** @brief Returns the number of scored documents. */
+        size_t size() const {
+            return counts.size();
+        }
+
+        /** @brief Returns the labels of document `i`, `count(i)` of them. */
+        const ScoredLabel * labels_of(size_t i) const {
+            return labels.data() + i * top_k;
+        }
+
+        /** @brief Returns the number of labels of document `i`. */
+        size_t count(size_t i) const {
+            return counts[i];
+        }
+    };
+
+    /**
+     * @class BatchClassifier
+     * @brief Scores documents against a shared `CentroidMatrix` and keeps the top-k labels.
+     *
+     * @details The classifier holds no mutable state, `const` methods are safe to call from
+     * any number of threads.
+     */
+    class BatchClassifier {
+
+        public:
+
+            /**
+             * @brief Creates a classifier over a shared centroid matrix.
+             * @param centroids The frozen category centroids.
+             * @param top_k Number of labels to keep per document, at least 1.
+             */
+            explicit BatchClassifier(std::shared_ptr<const CentroidMatrix> centroids, size_t top_k = 1);
+
+            /** @brief Returns the centroid matrix. */
+            const CentroidMatrix& centroids() const {
+                return *centroid_matrix;
+            }
+
+            /** @brief Returns the number of labels kept per document. */
+            size_t get_top_k() const {
+                return top_k;
+            }
+
+            /**
+             * @brief Scores a single document given as a term → TF-IDF map.
+             * @param tf_idf The document's TF-IDF values.
+             * @param labels Receives up to `get_top_k()` labels, best first.
+             * @return Number of labels written.
+             */
+            size_t score(const vocab::term_map<double>& tf_idf, ScoredLabel * labels) const;
+
+            /**
+             * @brief Scores a single CSR row.
+             * @param row The row's term IDs and TF-IDF values.
+             * @param labels Receives up to `get_top_k()` labels, best first.
+             * @return Number of labels written.
+             */
+            size_t score(const sparse::RowView& row, ScoredLabel * labels) const;
+
+            /**
+             * @brief Scores every document of a corpus, one pool task per block of documents.
+             * @param corpus Corpus with its TF-IDF computed.
+             * @param thread_pool The pool that runs the blocks.
+             */
+            BatchScores classify(const corpus::Corpus& corpus, tpool::ThreadPool& thread_pool) const;
+
+            /**
+             * @brief Scores every row of a frozen corpus, one pool task per block of rows.
+             * @param corpus Frozen corpus with its TF-IDF computed.
+             * @param thread_pool The pool that runs the blocks.
+             */
+            BatchScores classify(const corpus::FrozenCorpus& corpus, tpool::ThreadPool& thread_pool) const;
+
+        private:
+
+            std::shared_ptr<const CentroidMatrix> centroid_matrix; ///< Shared, never modified.
+            size_t top_k;                                          ///< Labels kept per document.
+
+            /** @brief Turns accumulated dot products into the top-k labels. */
+            size_t select_top_k(const double * dot_products, double doc_norm, ScoredLabel * labels) const;
+    };
+
+} // namespace cats
+
+
+/**
+ * @namespace cats::batch
+ * @brief Provides classification of a whole corpus through a `BatchClassifier`.
+ */
+namespace cats::batch {
+
+    /** @brief Number of documents scored per pool task. */
+    inline constexpr size_t BLOCK_SIZE{64};
+
+    /**
+     * @brief Records the best label of every scored document in `u_classified`, replacing
+     *        the results of an earlier call.
+     *
+     * @param scores Scores of the unknown documents, in document order.
+     * @param centroids The matrix the scores were computed with.
+     * @param correct_types The correct category of every document.
+     */
+    extern void commit_classifications(const BatchScores& scores, const CentroidMatrix& centroids, const std::vector<std::string>& correct_types);
+
+} // namespace cats::batch
+
+#endif // _BATCH_CLASSIFIER_HPP
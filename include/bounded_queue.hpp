@@ -0,0 +1,91 @@
+/**
+ * @file bounded_queue.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Header-only blocking queue with a fixed capacity, used between streaming stages.
+ *
+ * @details A producer blocks in `push()` while the queue is full, so a fast stage can never
+ * run more than `capacity` items ahead of a slow one. This is what bounds the memory of the
+ * streaming pipeline regardless of the size of the input.
+ */
+
+#ifndef _BOUNDED_QUEUE_HPP
+#define _BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+namespace stream {
+
+    /**
+     * @class BoundedQueue
+     * @brief Multi-producer, multi-consumer FIFO holding at most `capacity` items.
+     *
+     * @tparam T Movable item type.
+     */
+    template<typename T>
+    class BoundedQueue {
+
+        public:
+
+            /**
+             * @brief Creates an empty queue.
+             * @param capacity Maximum number of queued items, at least 1.
+             */
+            explicit BoundedQueue(size_t capacity) : capacity{capacity == 0 ? 1 : capacity} {}
+
+            /**
+             * @brief Appends an item, blocking while the queue is full.
+             * @return False if the queue was closed, the item is then dropped.
+             */
+            bool push(T item) {
+                std::unique_lock<std::mutex> lock(queue_mtx);
+                not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+                if (closed)
+                    return false;
+
+                items.push_back(std::move(item));
+                not_empty.notify_one();
+                return true;
+            }
+
+            /**
+             * @brief Removes the oldest item, blocking while the queue is empty.
+             * @return False once the queue is closed and drained.
+             */
+            bool pop(T& item) {
+                std::unique_lock<std::mutex> lock(queue_mtx);
+                not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+                if (items.empty())
+                    return false;
+
+                item = std::move(items.front());
+                items.pop_front();
+                not_full.notify_one();
+                return true;
+            }
+
+            /** @brief Wakes every waiter, later pushes fail and pops drain what is left. */
+            void close() {
+                std::lock_guard<std::mutex> lock(queue_mtx);
+                closed = true;
+                not_full.notify_all();
+                not_empty.notify_all();
+            }
+
+        private:
+
+            std::mutex queue_mtx;
+            std::condition_variable not_full;
+            std::condition_variable not_empty;
+            std::deque<T> items;
+            size_t capacity;
+            bool closed{false};
+    };
+
+} // namespace stream
+
+#endif // _BOUNDED_QUEUE_HPP
@@ -18,6 +18,8 @@
  * 
  * @par Changelog:
  * - Added dynamic categories, no longer stuck to 5 categories.
+ * - Cosine similarity runs on flat centroid arrays with SIMD kernels, category norms are precomputed.
+ * - Parallel categories are aggregated in one lock-free pass over the documents and a tree merge.
  * 
  */
 
@@ -28,6 +30,8 @@
 #include <unordered_map>
 #include <fstream>
 #include "utils.hpp"
+#include "vocabulary.hpp"
+#include "top_terms.hpp"
 
 #define MAX_CATEGORIES 5
 
@@ -38,6 +42,15 @@
  */
 namespace corpus {
     class Corpus; // forward declaration
+    class FrozenCorpus; // forward declaration
+}
+
+/**
+ * @namespace tpool
+ * @brief Forward declarations for `tpool::ThreadPool`
+ */
+namespace tpool {
+    class ThreadPool; // forward declaration
 }
 
 /**
@@ -77,41 +90,42 @@ namespace cats {
 
             std::string category_type; ///< Category type 
             int number_of_docs;             ///< Number of documents in this category
-            std::vector<std::pair<std::string, double>> most_important_terms; ///< List of top terms in the category sorted by TF-IDF
+            size_t num_important_terms{topk::DEFAULT_IMPORTANT_TERMS};           ///< Number of top terms kept
+            std::vector<std::pair<vocab::term_id, double>> most_important_terms; ///< List of top terms (by vocabulary ID) in the category sorted by TF-IDF
         
             /**
-             * @brief Sorts the terms of the category by their TF-IDF value in descending order.
+             * @brief Stores the TF-IDF values of all terms for the category.
              * 
-             * This method sorts the given unordered map of terms based on their TF-IDF values.
+             * This method processes the TF-IDF values of the given document and saves them in the 
+             * `tf_idf_all` member.
              * 
-             * @param terms An unordered map of terms and their corresponding TF-IDF scores.
-             * @return A sorted vector of term-TF-IDF pairs.
+             * @param doc_tf_idf A map of terms and their corresponding TF-IDF values for the document.
              */
-            std::vector<std::pair<std::string, double>> sort_unordered_umap(std::unordered_map<std::string, double> terms);
+            void put_tf_idf_all(const vocab::term_map<double>& doc_tf_idf);
 
             /**
-             * @brief Retrieves the nth most important term for the category.
+             * @brief Flattens `tf_idf_all` into the centroid arrays used by `classify_text()`.
              * 
-             * This function searches for the nth most important term, excluding previously used terms.
-             * 
-             * @param all_tfidf_terms A vector containing TF-IDF terms for all documents in the category.
-             * @param used A list of previously used terms to avoid duplicates.
-             * @return The nth most important term and its TF-IDF score.
+             * @details Builds the term ID sorted arrays, the dense view when the centroid fills 
+             * at least 1/8 of its term ID range, and the L2 norm, once per Category instead of 
+             * once per classified document.
              */
-            std::pair<std::string, double> search_nth_important_term(std::vector<std::vector<std::pair<std::string, double>>> all_tfidf_terms, std::vector<std::pair<std::string, double>> used);
+            void build_centroid();
 
             /**
-             * @brief Stores the TF-IDF values of all terms for the category.
-             * 
-             * This method processes the TF-IDF values of the given document and saves them in the 
-             * `tf_idf_all` member.
+             * @brief Stores the most important terms, then builds the centroid.
              * 
-             * @param doc_tf_idf A map of terms and their corresponding TF-IDF values for the document.
+             * @param important_terms The best terms of the category's documents.
+             * @throws std::runtime_error if there are none.
              */
-            void put_tf_idf_all(std::unordered_map<std::string, double> doc_tf_idf);
+            void set_important_terms(const topk::BoundedHeap& important_terms);
 
         public:
-            std::unordered_map<std::string, double> tf_idf_all; ///< TF-IDF terms of all documents in the category
+            std::unordered_map<vocab::term_id, double> tf_idf_all; ///< TF-IDF terms (by vocabulary ID) of all documents in the category
+            std::vector<vocab::term_id> centroid_term_ids;        ///< Term IDs of `tf_idf_all`, sorted
+            std::vector<double> centroid_values;                  ///< Values matching `centroid_term_ids`
+            std::vector<double> centroid_dense;                   ///< `tf_idf_all` indexed by term ID, empty if too sparse
+            double centroid_norm{0.0};                            ///< L2 norm of `tf_idf_all`
 
             /**
              * @brief Prints all the important information for the category.
@@ -130,8 +144,10 @@ namespace cats {
              * @brief Regular constructor to create a Category from the category type.
              * 
              * @param category_type The type of category (string).
+             * @param num_important_terms Number of most important terms kept (default: 5).
              */
-            Category(std::string category_type) : category_type{category_type} {}
+            Category(std::string category_type, size_t num_important_terms = topk::DEFAULT_IMPORTANT_TERMS) 
+                : category_type{category_type}, num_important_terms{num_important_terms} {}
 
             /** 
              * @brief Copy Constructor 
@@ -148,8 +164,13 @@ namespace cats {
              */
             Category(Category&& other) noexcept
                 : category_type{other.category_type},
+                num_important_terms{other.num_important_terms},
                 most_important_terms{std::move(other.most_important_terms)},
-                tf_idf_all{std::move(other.tf_idf_all)}  // Move tf_idf_all!
+                tf_idf_all{std::move(other.tf_idf_all)},  // Move tf_idf_all!
+                centroid_term_ids{std::move(other.centroid_term_ids)},
+                centroid_values{std::move(other.centroid_values)},
+                centroid_dense{std::move(other.centroid_dense)},
+                centroid_norm{other.centroid_norm}
             {}
 
             /** 
@@ -158,8 +179,13 @@ namespace cats {
             Category& operator=(Category&& other) noexcept {
                 if (this != &other) {
                     category_type = other.category_type;
+                    num_important_terms = other.num_important_terms;
                     most_important_terms = std::move(other.most_important_terms);
                     tf_idf_all = std::move(other.tf_idf_all);  // Move tf_idf_all!
+                    centroid_term_ids = std::move(other.centroid_term_ids);
+                    centroid_values = std::move(other.centroid_values);
+                    centroid_dense = std::move(other.centroid_dense);
+                    centroid_norm = other.centroid_norm;
                 }
                 return *this;
             }
@@ -175,23 +201,45 @@ namespace cats {
             std::string get_type() const {
                 return category_type;
             }
+
+            /**
+             * @brief Gets the most important terms, best first.
+             * 
+             * @return Up to `num_important_terms` terms (by vocabulary ID) and their TF-IDF.
+             */
+            const std::vector<std::pair<vocab::term_id, double>>& get_most_important_terms() const {
+                return most_important_terms;
+            }
         
             /**
              * @brief Computes the most important terms for the category based on the corpus.
              * 
              * This function calculates the important terms based on the term frequency-inverse 
              * document frequency (TF-IDF) values from the given `Corpus` and stores them in the
-             * `most_important_terms` vector.
+             * `most_important_terms` vector. The top terms of every document are offered to one 
+             * bounded heap (see `topk::BoundedHeap`), so the cost is O(n log k) for n terms.
              * 
              * @param corpus The corpus of documents used for calculating TF-IDF.
              */
             void get_important_terms(const corpus::Corpus& corpus);
 
+            /**
+             * @brief Completes the category from terms aggregated outside of it, see `cats::par::get_all_cat_par()`.
+             * 
+             * @details Gives the same result as `get_important_terms()` over the documents the
+             * arguments were aggregated from.
+             * 
+             * @param aggregated_tf_idf The `tf_idf_all` of the category.
+             * @param important_terms The merged top terms of the category's documents.
+             */
+            void build_from_aggregate(std::unordered_map<vocab::term_id, double> aggregated_tf_idf,
+                                      const topk::BoundedHeap& important_terms);
+
             /**
              * @brief Prints detailed information about the category to a file.
              * 
              * This function writes the category type and the most important terms to a file, 
-             * including their TF-IDF scores.
+             * including their TF-IDF scores. Term strings are looked up in `vocab::vocabulary`.
              */
             void print_all_info() const; 
     };
@@ -233,6 +281,21 @@ namespace cats {
     extern unknown_classification_s u_classified; ///< cats::object for unknown classification data
 
 
+    /**
+     * @struct Centroids_S
+     * @brief Dense category centroids built from a `corpus::FrozenCorpus`.
+     * 
+     * @details `weights[c]` holds the TF-IDF centroid of `category_types[c]` indexed by 
+     * `vocab::term_id`, and `norms[c]` its precomputed L2 norm, so classification never 
+     * recomputes a category norm.
+     */
+    struct Centroids_S {
+        std::vector<std::string> category_types;  ///< Category type of every centroid.
+        std::vector<std::vector<double>> weights; ///< Dense centroid per category, indexed by term ID.
+        std::vector<double> norms;                ///< L2 norm of every centroid.
+    };
+    using centroids_s = Centroids_S; ///< Use `centroids_s`, I dislike capitals.
+
     /**
      * @brief Classifies a single document into one of the categories.
      * 
@@ -240,12 +303,16 @@ namespace cats {
      * the precomputed categories and classifies the document into the most appropriate category.
      * It also checks if the classification is correct by comparing it with the correct category.
      * 
-     * @param unknownText An unordered map of terms and their corresponding TF-IDF values for the document.
+     * The document is flattened and its norm computed once, then scored against every 
+     * category's precomputed centroid with the `sparse::dot_dense()` (SIMD gather) or 
+     * `sparse::dot_sorted()` (merge) kernel.
+     * 
+     * @param unknownText An unordered map of term IDs and their corresponding TF-IDF values for the document.
      * @param cat_vect A vector of `Category` objects to compare against.
      * @param correct_type The correct category label for the document.
      * @return A `Classified_S` struct containing the classification results for the document.
      */
-    extern unknown_class classify_text(const std::unordered_map<std::string, double>& unknownText, std::vector<Category> cat_vect, std::string correct_type);
+    extern unknown_class classify_text(const vocab::term_map<double>& unknownText, const std::vector<Category>& cat_vect, std::string correct_type);
 
 
     /**
@@ -281,30 +348,46 @@ namespace cats {
 namespace cats::par {
 
     /**
-     * @brief Get important terms for a Category using parallel processing (5 threads, 1 per Category).
+     * @brief Get important terms for a single Category, safe to call for several categories at once.
      * 
-     * This function computes the most important terms for a category using parallel processing,
-     * with each thread handling one category type.
+     * This function computes the most important terms for a category by scanning the whole corpus, 
+     * only appending to `cats` is serialized.
      * 
      * @param corpus The corpus of documents used for calculating TF-IDF.
      * @param cats A vector to store the resulting Category objects.
      * @param catint The category type to process.
+     * @param num_important_terms Number of most important terms kept per Category (default: 5).
      */
-    extern void get_single_cat_par(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category);
+    extern void get_single_cat_par(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category, size_t num_important_terms = topk::DEFAULT_IMPORTANT_TERMS);
 
     /**
-     * @brief Get important terms for all Category objects using parallel processing (5 threads, 1 per Category).
-     * 
-     * This function computes the most important terms for all 5 categories using parallel processing,
-     * with each thread handling one category type. 
+     * @brief Get important terms for all Category objects using parallel processing.
      * 
      * @param corpus The corpus of documents used for calculating TF-IDF.
-     * @param cats A vector to store the resulting Category objects.
-     * @param catint The category type to process.
      * @return A `vector<Category>` containing all processed category data.
      */
     extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus&  corpus);
-    // extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus, int num_threads);
+
+    /**
+     * @brief Get important terms for all Category objects in one parallel pass over the documents.
+     * 
+     * @details The corpus is split into contiguous chunks of documents, each pool task folds its 
+     * chunk into its own sparse per-category accumulators (no locks, no shared writes). Adjacent 
+     * chunks are then merged pairwise in a parallel tree, so the work scales with documents and 
+     * cores instead of with the number of categories.
+     * 
+     * `Category::put_tf_idf_all()` folds a document into `tf_idf_all` as `w = (w + v) / n`, which 
+     * is an affine map of `w`. A chunk keeps the composition `w = a * w + b` of its documents for 
+     * every term, and composing two chunks in corpus order is associative, so the tree merge 
+     * gives `get_single_cat_seq()`'s result up to rounding. The top terms of every chunk are kept 
+     * in one bounded heap per category, merged with the chunks.
+     * 
+     * @param corpus The corpus of documents used for calculating TF-IDF.
+     * @param thread_pool The pool that runs the aggregation and merge tasks.
+     * @param num_important_terms Number of most important terms kept per Category (default: 5).
+     * @return A `vector<Category>` containing all processed category data.
+     */
+    extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus, tpool::ThreadPool& thread_pool, size_t num_important_terms = topk::DEFAULT_IMPORTANT_TERMS);
 
     /**
      * @brief Initializes the classification process for a set of documents parallelized.
@@ -321,6 +404,16 @@ namespace cats::par {
      */
     extern void init_classification_par(const corpus::Corpus& unknown_corpus, std::vector<Category> cat_vect, std::vector<std::string> correct_types);
 
+    /**
+     * @brief Initializes the classification process, submitting small batches of documents to a thread pool.
+     * 
+     * @param unknown_corpus The corpus of documents to classify.
+     * @param cat_vect A vector of `Category` objects to compare against.
+     * @param correct_types A vector of correct category labels corresponding to the documents in `unknown_corpus`.
+     * @param thread_pool The pool that runs the classification tasks.
+     */
+    extern void init_classification_par(const corpus::Corpus& unknown_corpus, std::vector<Category> cat_vect, std::vector<std::string> correct_types, tpool::ThreadPool& thread_pool);
+
 } // namspace cats::par
 
 
@@ -339,8 +432,9 @@ namespace cats::seq {
      * @param corpus The corpus of documents used for calculating TF-IDF. It must be a valid pointer to a `Corpus` object.
      * @param cats A vector to store the resulting Category objects. The categories will be filled with the most important terms.
      * @param catint The category type to process, represented as string.
+     * @param num_important_terms Number of most important terms kept per Category (default: 5).
      */
-    extern void get_single_cat_seq(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category);
+    extern void get_single_cat_seq(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category, size_t num_important_terms = topk::DEFAULT_IMPORTANT_TERMS);
     
     /**
      * @brief Get important terms for all Category objects using sequential processing.
@@ -351,9 +445,10 @@ namespace cats::seq {
      * @param corpus The corpus of documents used for calculating TF-IDF. It must be a valid pointer to a `Corpus` object.
      * @param cats A vector to store the resulting Category objects. The categories will be filled with the most important terms.
      * @param catint The category type to process, represented as a string.
+     * @param num_important_terms Number of most important terms kept per Category (default: 5).
      * @return A `vector<Category>` containing all processed category data.
      */
-    extern std::vector<cats::Category> get_all_cat_seq(const corpus::Corpus&  corpus);
+    extern std::vector<cats::Category> get_all_cat_seq(const corpus::Corpus&  corpus, size_t num_important_terms = topk::DEFAULT_IMPORTANT_TERMS);
 
     /**
      * @brief Initializes the classification process for a set of documents sequentially.
@@ -373,4 +468,40 @@ namespace cats::seq {
 } // namspace cats::seq
 
 
+/**
+ * @namespace cats::csr
+ * @brief Provides category building and classification over a `corpus::FrozenCorpus`.
+ * 
+ * @details These functions give the same results as `cats::par`, but sweep the contiguous 
+ * CSR arrays instead of walking every document's hash maps.
+ */
+namespace cats::csr {
+
+    /**
+     * @brief Builds the centroid of every category in a frozen, TF-IDF weighted corpus.
+     * 
+     * @details Rows are accumulated in corpus order exactly as `Category::put_tf_idf_all()` 
+     * accumulates documents, one pool task per category.
+     * 
+     * @param corpus The frozen trained corpus, `tfidf_documents()` must have been called.
+     * @param thread_pool The pool that runs the category tasks.
+     * @return The centroid of every category and its norm.
+     */
+    extern centroids_s get_all_centroids_csr(const corpus::FrozenCorpus& corpus, tpool::ThreadPool& thread_pool);
+
+    /**
+     * @brief Classifies every row of a frozen corpus against the category centroids.
+     * 
+     * @details Results are stored in `cats::u_classified` in row order.
+     * 
+     * @param unknown_corpus The frozen, TF-IDF weighted, corpus of documents to classify.
+     * @param centroids The centroids returned by `get_all_centroids_csr()`.
+     * @param correct_types The correct category label for every row.
+     * @param thread_pool The pool that runs the classification tasks.
+     */
+    extern void init_classification_csr(const corpus::FrozenCorpus& unknown_corpus, const centroids_s& centroids, const std::vector<std::string>& correct_types, tpool::ThreadPool& thread_pool);
+
+} // namespace cats::csr
+
+
 #endif // _CATEGORIES_HPP
\ No newline at end of file
@@ -0,0 +1,194 @@
+/**
+ * @file classify_server.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the ClassifyServer class, a long-running classifier fed newline-delimited
+ *        documents over a Unix domain socket or a stdin/stdout pipe.
+ *
+ * @details Every request line is one document and is answered by one line,
+ * `label<TAB>score` (repeated for every kept label when `top_k > 1`, empty when nothing
+ * matched). A request that could not be scored is answered `ERROR<TAB>message`. A line longer
+ * than `max_line_bytes` gets that reply too: a pipe server skips the rest of the line and
+ * keeps serving, a socket connection is closed. Replies keep the order of the requests on
+ * each connection.
+ *
+ * Connections only read and write. Every line a connection has buffered is submitted at
+ * once to a shared request queue, and a single batcher thread drains that queue in
+ * micro-batches: it waits until `max_batch` requests are queued or the oldest one has
+ * waited `max_wait`, then vectorizes and scores the whole batch on the thread pool through
+ * `cats::OnlineClassifier::vectorize()` and `cats::BatchClassifier::score()`. Under load
+ * batches fill up and the pool stays busy, when idle a lone request waits at most `max_wait`.
+ *
+ * @note Uses POSIX sockets and `poll()`, like the rest of the build this targets Linux and macOS.
+ */
+
+#ifndef _CLASSIFY_SERVER_HPP
+#define _CLASSIFY_SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "online_classifier.hpp"
+#include "thread_pool.hpp"
+
+
+/**
+ * @namespace serve
+ * @brief Provides the classification daemon.
+ */
+namespace serve {
+
+    /**
+     * @struct ServerSettings
+     * @brief Batching limits of a `ClassifyServer`.
+     */
+    struct ServerSettings {
+        size_t max_batch{256};                          ///< Requests scored together at most.
+        std::chrono::microseconds max_wait{500};        ///< Longest a queued request waits for its batch to fill.
+        size_t top_k{1};                                ///< Labels returned per document.
+        size_t max_line_bytes{1 << 20};                 ///< Longest request line a connection or pipe may buffer.
+    };
+
+    /**
+     * @struct ServerStats
+     * @brief Counters of a `ClassifyServer`, read with `ClassifyServer::stats()`.
+     */
+    struct ServerStats {
+        size_t documents{0};   ///< Documents answered.
+        size_t batches{0};     ///< Batches scored.
+        size_t errors{0};      ///< Documents answered with an error.
+        size_t connections{0}; ///< Connections accepted (1 for a pipe).
+        double busy_ms{0.0};   ///< Time spent scoring batches.
+
+        /** @brief Returns the average number of documents per batch. */
+        double average_batch() const {
+            return batches == 0 ? 0.0 : static_cast<double>(documents) / batches;
+        }
+    };
+
+    /**
+     * @class ClassifyServer
+     * @brief Answers classification requests from pipes and Unix socket connections in micro-batches.
+     */
+    class ClassifyServer {
+
+        public:
+
+            /**
+             * @brief Creates a server and starts its batcher thread.
+             *
+             * @param classifier The model requests are classified with.
+             * @param thread_pool The pool batches are scored on, must outlive the server.
+             * @param settings Batching limits.
+             */
+            ClassifyServer(std::shared_ptr<const cats::OnlineClassifier> classifier, tpool::ThreadPool& thread_pool,
+                           ServerSettings settings = ServerSettings{});
+
+            /** @brief Stops the server and joins the batcher, no serving loop may still be running. */
+            ~ClassifyServer();
+
+            ClassifyServer(const ClassifyServer&) = delete;
+            ClassifyServer& operator=(const ClassifyServer&) = delete;
+
+            /**
+             * @brief Answers every line of `in` on `out` until end of input.
+             *
+             * @details Blocks reading `in`, so `stop()` is only noticed once the line being
+             * read arrives: a pipe server stops when its input is closed. At most
+             * `max_line_bytes` of a line are kept, a longer line is answered with an error.
+             *
+             * @param in Request lines, usually `std::cin`.
+             * @param out Reply lines, flushed after every batch, usually `std::cout`.
+             */
+            void serve_stream(std::istream& in, std::ostream& out);
+
+            /**
+             * @brief Listens on a Unix domain socket until `stop()`, one thread per connection.
+             *
+             * @details An existing socket file at `socket_path` is replaced and removed on return.
+             *
+             * @param socket_path Path of the socket.
+             * @throws std::runtime_error if the socket cannot be created, bound or listened on.
+             */
+            void serve_socket(const std::string& socket_path);
+
+            /**
+             * @brief Asks every serving loop to return, thread-safe.
+             *
+             * @details Only stores a lock-free flag, so it may be called from a signal handler.
+             * `serve_socket()` and its connections notice it within `POLL_INTERVAL`,
+             * `serve_stream()` only after its next line or at end of input.
+             */
+            void stop() {
+                stopping.store(true, std::memory_order_relaxed);
+            }
+
+            /** @brief Returns a snapshot of the counters. */
+            ServerStats stats() const;
+
+            /** @brief Longest a socket serving loop blocks before checking `stop()`. */
+            static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+
+        private:
+
+            /**
+             * @struct Request
+             * @brief One queued document and its reply slot.
+             */
+            struct Request {
+                std::string text;                     ///< The document.
+                std::vector<cats::ScoredLabel> labels; ///< Up to `top_k` labels, best first.
+                size_t count{0};                      ///< Filled labels.
+                std::string error;                    ///< Why the request was not scored, empty if it was.
+            };
+
+            /**
+             * @struct Submission
+             * @brief Requests of one connection read together, answered together.
+             */
+            struct Submission {
+                std::vector<Request> requests;
+                size_t remaining{0};           ///< Requests not scored yet, guarded by `queue_mtx`.
+                std::condition_variable done;  ///< Signalled when `remaining` reaches 0.
+            };
+
+            std::shared_ptr<const cats::OnlineClassifier> classifier; ///< Vectorizes request texts.
+            cats::BatchClassifier batch_classifier;                   ///< Scores vectorized requests.
+            tpool::ThreadPool& thread_pool;
+            ServerSettings settings;
+
+            mutable std::mutex queue_mtx;
+            std::condition_variable queue_not_empty;
+            std::deque<std::pair<Submission *, size_t>> queue; ///< Pending requests, by submission and index.
+            std::atomic<bool> stopping{false};                 ///< Set by `stop()`, ends the serving loops.
+            bool shutting_down{false};                         ///< Set by the destructor, ends the batcher, guarded by `queue_mtx`.
+            ServerStats counters;                              ///< Guarded by `queue_mtx`.
+            std::thread batcher;
+
+            /** @brief Queues every request of a submission and waits until all are scored. */
+            void submit_and_wait(Submission& submission);
+
+            /** @brief Batcher thread, drains the queue in micro-batches until the server is destroyed. */
+            void batch_loop();
+
+            /** @brief Vectorizes and scores one batch on the pool, errors propagate to the batcher. */
+            void score_batch(std::vector<std::pair<Submission *, size_t>>& batch);
+
+            /** @brief Appends the reply line of a request to `reply`. */
+            void format_reply(const Request& request, std::string& reply) const;
+
+            /** @brief Answers one socket connection until it closes or `stop()`. */
+            void serve_connection(int client_fd);
+    };
+
+} // namespace serve
+
+#endif // _CLASSIFY_SERVER_HPP
@@ -0,0 +1,178 @@
+/**
+ * @file corpus_generator.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the synthetic corpus generator, seeded Zipfian datasets of any size in the
+ *        `training-data.csv` / `testing-data.txt` / `testing-correct-data.txt` layout.
+ *
+ * @details Every token is drawn from a Zipf distribution over the vocabulary. With probability
+ * `category_skew` it is drawn from its category's own distribution instead, the same Zipf
+ * curve rotated so the category's most frequent terms are rare elsewhere, which is what makes
+ * the categories separable. Document lengths follow a fixed, uniform or log-normal distribution.
+ *
+ * The output depends only on the `CorpusConfig`: every document has its own random stream seeded
+ * from `seed` and its index, and only integer arithmetic and IEEE double operations are used, no
+ * `std::` distributions (whose results differ between standard libraries). Documents are generated
+ * on a thread pool in batches and written in order, so the thread count does not change the files.
+ *
+ * Vocabulary words are built from consonant + `a`/`o`/`u` syllables, at least two per word. They
+ * are never stopwords and the stemmer leaves them unchanged, so the vocabulary the pipeline sees
+ * is the one generated.
+ */
+
+#ifndef _CORPUS_GENERATOR_HPP
+#define _CORPUS_GENERATOR_HPP
+
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * @namespace gen
+ * @brief Provides the synthetic corpus generator used for scale testing.
+ */
+namespace gen {
+
+    /**
+     * @enum LengthDistribution
+     * @brief How the number of tokens of a document is drawn.
+     */
+    enum class LengthDistribution {
+        fixed,      ///< Always `mean_length`.
+        uniform,    ///< Uniform over `[min_length, max_length]`.
+        lognormal   ///< Log-normal with mean `mean_length` and shape `length_sigma`, clamped to `[min_length, max_length]`.
+    };
+
+    /**
+     * @brief Parses `fixed`, `uniform` or `lognormal`.
+     * @throws std::invalid_argument for any other name.
+     */
+    extern LengthDistribution parse_length_distribution(const std::string& name);
+
+    /**
+     * @struct CorpusConfig
+     * @brief Everything a generated corpus depends on, the defaults give a BBC-sized dataset.
+     */
+    struct CorpusConfig {
+        size_t num_docs{2000};                  ///< Training plus testing documents.
+        double testing_fraction{0.2};           ///< Share of the documents written as testing data.
+        size_t vocabulary_size{30000};          ///< Distinct terms.
+        double zipf_exponent{1.0};              ///< Exponent `s` of the term rank distribution, `1 / rank^s`.
+        LengthDistribution length_distribution{LengthDistribution::lognormal};
+        size_t mean_length{380};                ///< Mean tokens per document.
+        double length_sigma{0.5};               ///< Shape of the log-normal lengths.
+        size_t min_length{20};                  ///< Shortest document, in tokens.
+        size_t max_length{4000};                ///< Longest document, in tokens.
+        size_t num_categories{5};               ///< Categories, documents are spread uniformly over them.
+        double category_skew{0.35};             ///< Probability a token comes from its category's distribution.
+        uint64_t seed{1};                       ///< Seed of every random stream.
+    };
+
+    /**
+     * @struct CorpusSummary
+     * @brief What `write_corpus()` wrote.
+     */
+    struct CorpusSummary {
+        size_t training_docs{0};
+        size_t testing_docs{0};
+        uint64_t tokens{0};
+        uint64_t bytes{0};
+    };
+
+    /**
+     * @class Rng
+     * @brief xoshiro256** generator, identical on every platform.
+     */
+    class Rng {
+
+        public:
+
+            /** @brief Seeds the stream of `stream` (a document index) from `seed` with splitmix64. */
+            Rng(uint64_t seed, uint64_t stream);
+
+            uint64_t next() {
+                uint64_t result = rotl(state[1] * 5, 7) * 9;
+                uint64_t t = state[1] << 17;
+                state[2] ^= state[0];
+                state[3] ^= state[1];
+                state[1] ^= state[2];
+                state[0] ^= state[3];
+                state[2] ^= t;
+                state[3] = rotl(state[3], 45);
+                return result;
+            }
+
+            /** @brief Returns a double uniform over `[0, 1)`. */
+            double uniform() {
+                return static_cast<double>(next() >> 11) * 0x1.0p-53;
+            }
+
+            /** @brief Returns an integer uniform over `[0, bound)`. */
+            uint64_t below(uint64_t bound) {
+                return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * bound) >> 64);
+            }
+
+        private:
+
+            uint64_t state[4];
+
+            static uint64_t rotl(uint64_t x, int k) {
+                return (x << k) | (x >> (64 - k));
+            }
+    };
+
+    /**
+     * @class ZipfSampler
+     * @brief Draws ranks `[0, n)` with probability proportional to `1 / (rank + 1)^s`.
+     *
+     * @details Walker/Vose alias table: building costs O(n), drawing one rank costs two random
+     * numbers and one table load, whatever the vocabulary size.
+     */
+    class ZipfSampler {
+
+        public:
+
+            ZipfSampler(size_t n, double exponent);
+
+            uint32_t sample(Rng& rng) const {
+                uint32_t column = static_cast<uint32_t>(rng.below(probability.size()));
+                return rng.uniform() < probability[column] ? column : alias[column];
+            }
+
+        private:
+
+            std::vector<double> probability;    ///< Chance of keeping the column's own rank.
+            std::vector<uint32_t> alias;        ///< Rank drawn otherwise.
+    };
+
+    /** @brief Returns the word of vocabulary rank `rank`, distinct for every rank. */
+    extern std::string vocabulary_word(uint64_t rank);
+
+    /** @brief Returns the name of category `index`, as written to the files. */
+    extern std::string category_name(size_t index);
+
+    /**
+     * @brief Generates a corpus into `folder`, creating it if needed.
+     *
+     * @details Writes `training-data.csv` (with a `category,text` header), `testing-data.txt`
+     * and `testing-correct-data.txt`. The first documents are the training ones, the rest the
+     * testing ones. Only one batch of documents is held in memory at a time.
+     *
+     * @param config What to generate.
+     * @param folder Output folder, with or without a trailing `/`.
+     * @param thread_pool The pool generating each batch.
+     * @return Documents, tokens and bytes written.
+     * @throws std::invalid_argument if the configuration is inconsistent.
+     * @throws std::runtime_error if a file cannot be written.
+     */
+    extern CorpusSummary write_corpus(const CorpusConfig& config, const std::string& folder, tpool::ThreadPool& thread_pool);
+
+    /** @brief Same as above, on a temporary pool. */
+    extern CorpusSummary write_corpus(const CorpusConfig& config, const std::string& folder);
+
+} // namespace gen
+
+#endif // _CORPUS_GENERATOR_HPP
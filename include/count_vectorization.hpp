@@ -9,14 +9,15 @@
  * by counting term frequencies in each document. It supports both multi-threaded and 
  * sequential vectorization methods.
  * 
- * The multi-threaded approach distributes documents across multiple threads for improved 
- * performance, while the sequential approach processes documents one at a time.
+ * The multi-threaded approach submits small batches of documents to a work-stealing 
+ * `tpool::ThreadPool`, while the sequential approach processes documents one at a time.
  */
 
 #ifndef _COUNT_VECTORIZATION_HPP
 #define _COUNT_VECTORIZATION_HPP
 
 #include "document.hpp"
+#include "thread_pool.hpp"
 
 
 /**
@@ -36,6 +37,17 @@ extern void vectorize_corpus_threaded(corpus::Corpus * corpus);
 
 extern void vectorize_corpus_threaded(corpus::Corpus * corpus, int num_threads);
 
+/**
+ * @brief Vectorizes a corpus by submitting small batches of documents to a thread pool.
+ * 
+ * @details The overloads above create a temporary pool sized from `NUMBER_OF_THREADS_MAX` 
+ * or `num_threads` and call this function.
+ * 
+ * @param corpus Pointer to the `Corpus` object that contains the documents to be vectorized.
+ * @param thread_pool The pool that runs the vectorization tasks.
+ */
+extern void vectorize_corpus_threaded(corpus::Corpus * corpus, tpool::ThreadPool& thread_pool);
+
 
 /**
  * @brief Vectorizes a corpus sequentially, processing one document at a time.
@@ -55,5 +67,32 @@ extern void vectorize_corpus_threaded(corpus::Corpus * corpus, int num_threads);
  */
 extern void vectorize_corpus_sequential(corpus::Corpus * corpus);
 
+/**
+ * @brief Counts the terms of a single document and calculates its term frequencies.
+ * 
+ * @details The per-document step of both functions above, used by the streaming 
+ * pipeline which vectorizes documents batch by batch. Does not assign a document id.
+ * 
+ * @param doc Pointer to the `Document` to vectorize.
+ */
+extern void vectorize_document(docs::Document * doc);
+
+/**
+ * @brief Tokenizes, stems and counts the terms of a document into its `term_count`.
+ * 
+ * @details First half of `vectorize_document()`, without the term frequencies. 
+ * Exposed so the kernel can be benchmarked on its own.
+ * 
+ * @param doc Pointer to the `Document` to count.
+ */
+extern void count_words_doc(docs::Document * doc);
+
+/**
+ * @brief Checks whether a stemmed term is a stopword of `stopwords::active()`, which vectorization never counts.
+ * @param stem A term as returned by `preprocess_stem_term()`.
+ * @return True if the term is skipped.
+ */
+extern bool is_stopword(const std::string& stem);
+
 
 #endif // _COUNT_VECTORIZATION_HPP
\ No newline at end of file
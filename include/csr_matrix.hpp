@@ -0,0 +1,71 @@
+/**
+ * @file csr_matrix.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Header-only compressed sparse row (CSR) matrix used for document-term data.
+ *
+ * @details A CSR matrix stores every row of a sparse matrix back to back in two contiguous
+ * arrays, `term_ids` and `values`, with `row_offsets[r]` .. `row_offsets[r + 1]` delimiting
+ * row `r`. Term IDs inside a row are kept sorted, so whole-corpus passes are linear sweeps
+ * over contiguous memory instead of walks over scattered hash map nodes.
+ */
+
+#ifndef _CSR_MATRIX_HPP
+#define _CSR_MATRIX_HPP
+
+#include <vector>
+#include "vocabulary.hpp"
+
+
+/**
+ * @namespace sparse
+ * @brief Provides sparse matrix storage for the vectorized corpus.
+ */
+namespace sparse {
+
+    /**
+     * @struct RowView
+     * @brief Read only view of a single CSR row.
+     */
+    struct RowView {
+        const vocab::term_id * term_ids; ///< Sorted term IDs of the row.
+        const double * values;           ///< Values matching `term_ids`.
+        size_t size;                     ///< Number of non-zero entries in the row.
+    };
+
+    /**
+     * @class CsrMatrix
+     * @brief Compressed sparse row matrix of `double` values keyed by `vocab::term_id` columns.
+     */
+    class CsrMatrix {
+
+        public:
+
+            std::vector<size_t> row_offsets{0};   ///< Start of every row, plus one past the last row.
+            std::vector<vocab::term_id> term_ids; ///< Column (term) IDs, sorted within each row.
+            std::vector<double> values;           ///< Non-zero values matching `term_ids`.
+
+            /** @brief Returns the number of rows. */
+            size_t num_rows() const {
+                return row_offsets.size() - 1;
+            }
+
+            /** @brief Returns the number of stored non-zero entries. */
+            size_t num_nonzeros() const {
+                return term_ids.size();
+            }
+
+            /**
+             * @brief Returns a read only view of row `r`.
+             * @param r Row index, must be less than `num_rows()`.
+             */
+            RowView row(size_t r) const {
+                size_t begin = row_offsets[r];
+                return {term_ids.data() + begin, values.data() + begin, row_offsets[r + 1] - begin};
+            }
+    };
+
+} // namespace sparse
+
+#endif // _CSR_MATRIX_HPP
@@ -14,9 +14,15 @@
 #include <cstdarg>
 #include <sstream>
 #include <fstream>
+#include <memory>
 #include <unordered_set>
 
 #include "utils.hpp"
+#include "vocabulary.hpp"
+#include "csr_matrix.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "arena.hpp"
 #include "categories.hpp"
 
 class Category; ///< Forward declaration
@@ -37,8 +43,8 @@ class Category; ///< Forward declaration
  * - Providing utility functions to check for terms, calculate term frequencies, and output document-related information.
  * 
  * Key attributes of the `Document` class include:
- * - `text` : The raw text content of the document.
- * - `term_count` : A hashmap that stores the frequency of each term in the document.
+ * - `text` : The raw text content of the document (or `text_view` into a mapped input file).
+ * - `term_count` : A hashmap that stores the frequency of each term (by vocabulary ID) in the document.
  * - `term_frequency` : A hashmap that stores normalized term frequencies for each term.
  * - `tf_idf` : A hashmap that stores the TF-IDF scores of the terms in the document.
  * - `category` : The classification category assigned to the document.
@@ -82,13 +88,33 @@ namespace docs {
         public:
 
             int document_id{0}; ///< Unique document identifier (for testing/debugging)
-            std::string text;   ///< Raw text content of the document
-            std::unordered_map<std::string, int> term_count;        ///< Term occurrence count within the document
-            std::unordered_map<std::string, double> term_frequency; ///< Normalized term frequencies
-            std::unordered_map<std::string, double> tf_idf;         ///< TF-IDF scores for terms in the document
+            std::string text;   ///< Raw text content of the document, when owned
+            std::string_view text_view; ///< Raw text inside a mapped input file, used when `text` is empty
+            vocab::term_map<int> term_count;        ///< Term occurrence count within the document
+            vocab::term_map<double> term_frequency; ///< Normalized term frequencies
+            vocab::term_map<double> tf_idf;         ///< TF-IDF scores for terms in the document
             int total_terms{0};       ///< Total number of words in the document
             std::string category; ///< Classification category assigned to the document
 
+            /**
+             * @brief Creates an empty document whose maps use the default memory resource.
+             */
+            Document() = default;
+
+            /**
+             * @brief Creates an empty document whose maps allocate from `resource`.
+             * @param resource Usually the owning corpus's `arena::ThreadArenas`, must outlive the document.
+             */
+            explicit Document(std::pmr::memory_resource * resource)
+                : term_count{resource}, term_frequency{resource}, tf_idf{resource} {}
+
+            /**
+             * @brief Returns the raw text, whether owned or a view into a mapped file.
+             */
+            std::string_view raw_text() const {
+                return text.empty() ? text_view : std::string_view{text};
+            }
+
             /**
              * @brief Checks whether a given term exists in the document.
              * @param str The term to search for.
@@ -96,6 +122,13 @@ namespace docs {
              */
             bool is_term(std::string str);
 
+            /**
+             * @brief Checks whether a given term ID exists in the document.
+             * @param id The vocabulary ID of the term to search for.
+             * @return True if the term is found, otherwise false.
+             */
+            bool is_term(vocab::term_id id) const;
+
             /**
              * @brief Calculates term frequency for all words in the document.
              * 
@@ -113,10 +146,10 @@ namespace docs {
 
             /**
              * @brief Computes the term frequency of a specific word in the document.
-             * @param term The word whose frequency is to be calculated.
+             * @param term The vocabulary ID of the word whose frequency is to be calculated.
              * @return The normalized term frequency.
              */
-            double calculate_term_frequency(std::string term);
+            double calculate_term_frequency(vocab::term_id term);
 
             /* Helper functions for formatted output */
             std::string print_text() const;
@@ -151,6 +184,33 @@ namespace docs {
  */
 namespace corpus {
 
+    /**
+     * @struct IdfTable
+     * @brief Read-only view of an IDF table indexed by `vocab::term_id`, usually the training corpus's.
+     * 
+     * @details Terms past the end of the table were never seen in training and weigh 0.
+     */
+    struct IdfTable {
+        const double * values{nullptr}; ///< IDF of every term.
+        size_t size{0};                 ///< Number of values.
+
+        /** @brief Returns the IDF of `term`, 0 when it is outside the table. */
+        double operator[](vocab::term_id term) const {
+            return term < size ? values[term] : 0.0;
+        }
+    };
+
+    /**
+     * @brief Weights one document's term frequencies by a fixed IDF table.
+     * 
+     * @details Costs one lookup per distinct term of the document, no corpus-wide pass, 
+     * so a single document or a micro-batch can be weighted on its own.
+     * 
+     * @param document A document with its term frequencies calculated.
+     * @param idf The IDF table, usually the trained corpus's.
+     */
+    extern void tfidf_document(docs::Document * document, const IdfTable& idf);
+
     /**
      * @class Corpus
      * @brief Represents a collection of documents (corpus) for text analysis.
@@ -169,8 +229,8 @@ namespace corpus {
      * The class includes methods for:
      * - `tfidf_documents()` : Computes TF-IDF values using parallel processing.
      * - `tfidf_documents_seq()` : Computes TF-IDF values sequentially.
-     * - `tfidf_documents_not_dynamic()` : Computes TF-IDF using a fixed number of threads, 
-     *   with one thread per document.
+     * - `tfidf_documents_not_dynamic()` : Computes TF-IDF on the pool in fixed tasks of 
+     *   10 documents.
      * - `get_num_unique_terms()` : Returns the number of unique terms in the corpus.
      * - `print_all_info()` : Saves corpus-related statistics to an output file.
      * 
@@ -181,11 +241,39 @@ namespace corpus {
 
         public:
 
+            arena::ThreadArenas allocator;          ///< Memory of the documents' term maps, declared first so it outlives them.
             std::vector<docs::Document> documents;  ///< Collection of document objects in the corpus.
-            std::unordered_map<std::string, double> inverse_document_frequency; ///< Stores the inverse document frequency (IDF) values.
+            std::vector<int> document_frequency; ///< Number of documents containing each term, indexed by `vocab::term_id`.
+            std::vector<double> inverse_document_frequency; ///< Inverse document frequency (IDF) values, indexed by `vocab::term_id`.
             std::atomic<int> num_of_docs{0};    ///< Total number of documents in the corpus.
             std::atomic<int> num_of_categories{0};  ///< Total number of categories in the corpus.
             std::unordered_set<std::string> category_types_set; ///< set of category types as strings.
+            std::vector<std::shared_ptr<const io::MappedFile>> mapped_files; ///< Input files the documents' `text_view`s point into.
+
+            /**
+             * @brief Creates an empty corpus.
+             * @param allocator_mode Whether document term maps come from per-thread arenas or the heap (default).
+             */
+            explicit Corpus(arena::Mode allocator_mode = arena::Mode::heap) : allocator{allocator_mode} {}
+
+            /**
+             * @brief Appends empty documents whose term maps allocate from `allocator`.
+             * @param count Number of documents appended.
+             */
+            void add_documents(size_t count);
+
+            /**
+             * @brief Destroys every document, then frees the arenas at once.
+             * 
+             * @details In `arena::Mode::arena` the maps free nothing on destruction, their 
+             * memory is returned by one `arena::ThreadArenas::release()` per corpus.
+             */
+            void release_documents();
+
+            /** @brief Returns the allocation counters of the documents' term maps. */
+            arena::AllocatorStats allocator_stats() const {
+                return allocator.stats();
+            }
 
             /**
             * @brief Computes the TF-IDF values for all documents in parallel.
@@ -203,6 +291,29 @@ namespace corpus {
             */
             void tfidf_documents(int num_threads);
 
+            /**
+            * @brief Computes the TF-IDF values for all documents on a thread pool.
+            * 
+            * @details Builds the document-frequency index, then submits small batches of 
+            * documents to `thread_pool`. The overloads above create a temporary pool and 
+            * call this function.
+            * 
+            * @param thread_pool The pool that runs the TF-IDF tasks.
+            */
+            void tfidf_documents(tpool::ThreadPool& thread_pool);
+
+            /**
+             * @brief Computes the TF-IDF values with a fixed IDF table instead of this corpus's own.
+             * 
+             * @details Used for unknown documents, so a document's weights do not depend on the 
+             * other documents it is classified with. The corpus's own document frequencies 
+             * are neither counted nor changed.
+             * 
+             * @param idf The IDF table, usually the trained corpus's.
+             * @param thread_pool The pool that runs the TF-IDF tasks.
+             */
+            void tfidf_documents(const IdfTable& idf, tpool::ThreadPool& thread_pool);
+
             /**
              * @brief Computes the TF-IDF values sequentially (single-threaded).
              * 
@@ -213,13 +324,43 @@ namespace corpus {
             void tfidf_documents_seq();
 
             /**
-             * @brief Computes the TF-IDF values using one thread per document.
+             * @brief Computes the TF-IDF values by rescanning the corpus for every term.
+             * 
+             * @details This is the original O(docs * terms * docs) implementation, where the 
+             * document frequency of each term is recounted for every document it appears in. 
+             * It is kept only as a baseline for the document-frequency benchmark.
+             * 
+             * @param num_threads Number of threads to split the documents across.
+             */
+            void tfidf_documents_rescan(int num_threads);
+
+            /**
+             * @brief Builds the document-frequency index in parallel.
+             * 
+             * @details Each pool task counts the terms of its own batch of documents into a 
+             * local map, the partial counts are merged into `document_frequency`, and 
+             * `inverse_document_frequency` is filled from the merged counts. Called by 
+             * `tfidf_documents()` before weighting, so every term costs a single lookup.
+             * 
+             * @param thread_pool The pool that runs the counting tasks.
+             */
+            void build_document_frequency(tpool::ThreadPool& thread_pool);
+
+            /**
+             * @brief Builds the document-frequency index sequentially.
              * 
-             * @details Unlike `tfidf_documents()`, this function assigns one active 
-             * thread to process each document independently.
+             * @details Same result as `build_document_frequency(tpool::ThreadPool&)`, used by `tfidf_documents_seq()`.
+             */
+            void build_document_frequency_seq();
+
+            /**
+             * @brief Computes the TF-IDF values in fixed tasks of 10 documents.
              * 
-             * @warning This is NOT used in tests!! Use at your own risk, will cause 
-             * high contention and excessive resource usage!!
+             * @details Unlike `tfidf_documents()`, the task size does not depend on the 
+             * corpus size. Runs on a temporary pool sized from `NUMBER_OF_THREADS_MAX`.
+             * 
+             * @warning This is NOT used in tests!! Small fixed tasks mean more scheduling 
+             * overhead than `tfidf_documents()`.
              */
             void tfidf_documents_not_dynamic();
             
@@ -257,13 +398,14 @@ namespace corpus {
 
             unsigned num_threads_used{1}; ///< Number of threads used.
             unsigned num_doc_per_thread; ///< Number of documents processed per thread.
+            int num_unique_terms{0}; ///< Number of terms with a non-zero document frequency.
 
             /**
              * @brief Returns the number of documents that contain a given term.
-             * @param str The term to check.
+             * @param id The vocabulary ID of the term to check.
              * @return The count of documents containing the term.
              */
-            int num_doc_term(const std::string& str);
+            int num_doc_term(vocab::term_id id);
 
             /**
              * @brief Computes the inverse document frequency (IDF) of a given term.
@@ -278,12 +420,26 @@ namespace corpus {
              */
             double idf_corpus(int docs_with_term);
 
+            /**
+             * @brief Fills `inverse_document_frequency` from `document_frequency`.
+             */
+            void compute_inverse_document_frequency();
+
             /**
              * @brief Computes and inserts the TF-IDF values for a document using a separate thread.
+             * 
+             * @details Requires the document-frequency index, see `build_document_frequency()`.
+             * 
              * @param document Pointer to the `Document` object being processed.
              */
             void emplace_tfidf_document(docs::Document * document);
 
+            /**
+             * @brief Computes and inserts the TF-IDF values for a document by rescanning the corpus.
+             * @param document Pointer to the `Document` object being processed.
+             */
+            void emplace_tfidf_document_rescan(docs::Document * document);
+
             /** @brief Returns formatted number of threads used for processing. */
             std::string print_number_threads_used() const;
 
@@ -294,6 +450,73 @@ namespace corpus {
             std::string print_number_documents() const;
     };
 
+    /**
+     * @class FrozenCorpus
+     * @brief Immutable compressed-sparse-row view of a vectorized `Corpus`.
+     * 
+     * @details Built once from a `Corpus` after vectorization. Each document becomes a row of 
+     * `matrix` holding its term frequencies in sorted term ID order, so TF-IDF weighting, 
+     * category centroid building, and classification run as linear sweeps over contiguous 
+     * arrays. The source `Corpus` is left untouched, so the map-based API keeps working.
+     */
+    class FrozenCorpus {
+
+        public:
+
+            sparse::CsrMatrix matrix; ///< One row per document, term frequencies until `tfidf_documents()` weights them.
+            std::vector<std::string> category_types; ///< Distinct category types, in order of first appearance.
+            std::vector<int> row_category; ///< Index into `category_types` for every row, -1 if uncategorized.
+            std::vector<int> document_frequency; ///< Number of rows containing each term, indexed by `vocab::term_id`.
+            std::vector<double> inverse_document_frequency; ///< IDF values, indexed by `vocab::term_id`.
+
+            /** @brief Creates an empty corpus, filled by `stream::stream_corpus()`. */
+            FrozenCorpus() = default;
+
+            /**
+             * @brief Freezes a vectorized corpus into CSR form.
+             * 
+             * @param corpus A corpus whose documents have term frequencies calculated.
+             * @param thread_pool The pool that fills the rows.
+             */
+            FrozenCorpus(const Corpus& corpus, tpool::ThreadPool& thread_pool);
+
+            /**
+             * @brief Weights every row by IDF in place.
+             * 
+             * @details Document frequencies are counted with one sweep over `matrix.term_ids` 
+             * and every value is then multiplied by the IDF of its column.
+             * 
+             * @param thread_pool The pool that runs both sweeps.
+             */
+            void tfidf_documents(tpool::ThreadPool& thread_pool);
+
+            /**
+             * @brief Weights every row by IDF, using the already counted `document_frequency`.
+             * 
+             * @details Second half of `tfidf_documents()`, called directly when the document 
+             * frequencies were counted while the corpus was built (streaming).
+             * 
+             * @param thread_pool The pool that runs the sweeps.
+             */
+            void apply_inverse_document_frequency(tpool::ThreadPool& thread_pool);
+
+            /**
+             * @brief Weights every row by a fixed IDF table instead of this corpus's own.
+             * 
+             * @details Counterpart of `Corpus::tfidf_documents(const IdfTable&, tpool::ThreadPool&)`, 
+             * `document_frequency` and `inverse_document_frequency` are left untouched.
+             * 
+             * @param idf The IDF table, usually the trained corpus's.
+             * @param thread_pool The pool that runs the sweep.
+             */
+            void apply_inverse_document_frequency(const IdfTable& idf, tpool::ThreadPool& thread_pool);
+
+            /** @brief Returns the number of documents (rows). */
+            int get_num_of_docs() const {
+                return static_cast<int>(matrix.num_rows());
+            }
+    };
+
 } // namespace corpus
 
 #endif // _DOCUMENT_HPP
\ No newline at end of file
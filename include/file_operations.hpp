@@ -8,7 +8,7 @@
  * @details This file defines functions for handling file I/O operations, including:
  * - Loading a CSV file into a `Corpus` for training data.
  * - Reading and vectorizing unknown text for classification.
- * - Converting results into a CSV format for Python-based preprocessing and graphing.
+ * - Writing run times and accuracy to a CSV file for Python-based preprocessing and graphing.
  * - Retrieving input file names for processing.
  * 
  * These functions enable efficient management of document data for machine learning applications.
@@ -17,7 +17,10 @@
  * 
  * @par Changelog:
  * - Reads category string directly into corpus
+ * - Input files are memory-mapped and indexed in parallel, documents view the mapped text.
+ * - Quoted CSV fields are parsed correctly instead of splitting on the first comma.
  * - Improved CSV formatted output.
+ * - Processed CSV rows are written from the profiled section times instead of re-parsing the results file.
  * - @brief Example of new CSV format:
  * ```csv
  * Vectorization,TF-IDF,Categories,Unknown Classification,Accuracy
@@ -29,6 +32,7 @@
 #ifndef _FILE_OPERATIONS_HPP
 #define _FILE_OPERATIONS_HPP
 
+#include <array>
 #include "document.hpp"
 
 /**
@@ -43,9 +47,36 @@
  */
 extern void read_csv_to_corpus(corpus::Corpus& corpus, const std::string& file_name);
 
+/**
+ * @brief Reads a CSV file into a `Corpus`, indexing and parsing lines on a thread pool.
+ * 
+ * @details The file is memory-mapped and every `Document` refers to its text through 
+ * `Document::text_view`, so no line is copied. Fields may be double quoted, with `""` 
+ * for a literal quote, and quoted text may hold commas and newlines. The overload above 
+ * creates a temporary pool and calls this function.
+ * 
+ * @param corpus The `Corpus` object where the documents will be stored.
+ * @param file_name The path to the CSV file to be read.
+ * @param thread_pool The pool that indexes and parses the records.
+ * @throws std::runtime_error if the file cannot be opened.
+ */
+extern void read_csv_to_corpus(corpus::Corpus& corpus, const std::string& file_name, tpool::ThreadPool& thread_pool);
+
 extern std::string get_input_file_name();
 extern std::vector<std::string> read_unknown_cats(const std::string& file_name);
 
+/**
+ * @brief Fills a `Document` from one 'category,text' CSV record.
+ * 
+ * @details The text is everything after the first comma outside quotes. A text that is 
+ * a single quoted field is unquoted. The text stays a view into `record` (`text_view`) 
+ * unless it holds `""` escapes, which are unescaped into `text`.
+ * 
+ * @param record One record as returned by `io::index_records()`.
+ * @param document The document to fill.
+ */
+extern void parse_csv_record(std::string_view record, docs::Document& document);
+
 
 /**
  * @brief Reads and vectorizes unknown text for classification.
@@ -61,17 +92,29 @@ extern std::vector<std::string> read_unknown_cats(const std::string& file_name);
  */
 extern void read_unknown_text(corpus::Corpus& corpus, const std::string& file_name);
 
+/**
+ * @brief Reads unknown text into a `Corpus`, one memory-mapped `Document` view per line.
+ * 
+ * @param corpus The `Corpus` object where the new documents will be stored.
+ * @param file_name The path to the file containing unknown text.
+ * @param thread_pool The pool that indexes the lines.
+ * @throws std::runtime_error if the file cannot be opened.
+ */
+extern void read_unknown_text(corpus::Corpus& corpus, const std::string& file_name, tpool::ThreadPool& thread_pool);
+
 
 /**
- * @brief Converts a results `.txt` file to CSV for Python preprocessing and graphing.
+ * @brief Appends the section times and accuracy of a run to a CSV file for Python preprocessing and graphing.
  * 
- * @details This function formats result data into a structured CSV file for analysis.  
- * It does not validate whether `file_name` is a predefined result file.
+ * @details Writes the header first if the file is empty. Times are in milliseconds, as
+ * measured by the profiler, so nothing is parsed back from the results `.txt` file.
  * 
- * @param par_or_seq Determines execution type (0 = parallel, 1 = sequential).
- * @param comp_or_solo Specifies whether to compare results or process a single dataset.
+ * @param csv_file_name The processed CSV file, appended to.
+ * @param section_durations Milliseconds spent in each `section_type_`.
+ * @param accuracy Percentage of unknown documents classified correctly.
+ * @throws std::runtime_error if the file cannot be written.
  */
-extern void convert_results_txt_to_csv(const std::string& txt_file_name, const std::string& csv_file_name);
+extern void write_processed_csv(const std::string& csv_file_name, const std::array<double, 4>& section_durations, double accuracy);
 
 
 /**
@@ -0,0 +1,163 @@
+/**
+ * @file flat_counter.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the TermCounter class, a flat open-addressing counter keyed by term ID for the
+ *        per-token hot loop of vectorization.
+ *
+ * @details Slots live in three flat arrays (control bytes, keys, counts) split into groups of
+ * 16. Every slot has one control byte: `EMPTY`, or the low 7 bits of its key's hash. A lookup
+ * hashes the ID once, then compares the 7-bit tag against a whole group of control bytes with
+ * one SSE2 compare and `movemask`, so only slots with a matching tag touch the key array. A
+ * group with an empty slot ends the probe. Without SSE2 the group is scanned byte by byte.
+ *
+ * There is no erase, so there are no tombstones. `clear()` only resets the slots that were
+ * used, and the arrays keep their capacity, so a thread-local counter reused across documents
+ * allocates nothing once it has grown to the largest document.
+ */
+
+#ifndef _FLAT_COUNTER_HPP
+#define _FLAT_COUNTER_HPP
+
+#include <cstdint>
+#include <vector>
+#include "vocabulary.hpp"
+
+#if defined(__SSE2__)
+#define _FLAT_COUNTER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * @namespace flat
+ * @brief Provides flat, open-addressing containers for hot loops.
+ */
+namespace flat {
+
+    /**
+     * @class TermCounter
+     * @brief Counts occurrences of term IDs, iterated in order of first occurrence.
+     */
+    class TermCounter {
+
+        public:
+
+            static constexpr size_t GROUP_SIZE{16}; ///< Slots compared at once.
+
+            /**
+             * @brief Creates an empty counter.
+             * @param initial_capacity Slots allocated up front, rounded up to a power of two of at least one group.
+             */
+            explicit TermCounter(size_t initial_capacity = 256);
+
+            /**
+             * @brief Adds `amount` to the count of `id`, inserting it at 0 first if new.
+             * @param id Any term ID, including `vocab::UNKNOWN_TERM`.
+             * @param amount Added to the count.
+             */
+            void increment(vocab::term_id id, int amount = 1) {
+                if ((used_slots.size() + 1) * 8 > slot_count() * 7)
+                    grow(); // keeps the load factor at or below 7/8, a probe always finds an empty slot
+                counts[find_or_insert(id)] += amount;
+            }
+
+            /** @brief Returns the count of `id`, 0 if it was never incremented. */
+            int count(vocab::term_id id) const;
+
+            /** @brief Returns the number of distinct IDs counted. */
+            size_t size() const {
+                return used_slots.size();
+            }
+
+            /** @brief Returns true if nothing was counted since the last `clear()`. */
+            bool empty() const {
+                return used_slots.empty();
+            }
+
+            /** @brief Returns the number of slots. */
+            size_t slot_count() const {
+                return control.size();
+            }
+
+            /** @brief Forgets every count in O(size()), keeping the capacity. */
+            void clear() {
+                for (uint32_t slot : used_slots)
+                    control[slot] = EMPTY;
+                used_slots.clear();
+            }
+
+            /**
+             * @brief Calls `fn(id, count)` for every counted ID, in order of first occurrence.
+             */
+            template <typename Function>
+            void for_each(Function fn) const {
+                for (uint32_t slot : used_slots)
+                    fn(keys[slot], counts[slot]);
+            }
+
+        private:
+
+            static constexpr int8_t EMPTY{-128}; ///< Control byte of a free slot, tags are 0..127.
+
+            std::vector<int8_t> control;          ///< Tag or `EMPTY` of every slot.
+            std::vector<vocab::term_id> keys;     ///< Term ID of every used slot.
+            std::vector<int> counts;              ///< Count of every used slot.
+            std::vector<uint32_t> used_slots;     ///< Used slots in order of insertion.
+            size_t group_mask{0};                 ///< Number of groups minus one.
+
+            // Fibonacci hashing, IDs are dense so the multiply spreads neighbours apart
+            static uint64_t hash_id(vocab::term_id id) {
+                return static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull >> 20;
+            }
+
+            // bit i set when byte i of the group equals value
+            static uint32_t match_byte(const int8_t * group_control, int8_t value) {
+#ifdef _FLAT_COUNTER_SSE2
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group_control));
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value))));
+#else
+                uint32_t matches{0};
+                for (size_t i = 0; i < GROUP_SIZE; i++)
+                    matches |= static_cast<uint32_t>(group_control[i] == value) << i;
+                return matches;
+#endif
+            }
+
+            size_t find_or_insert(vocab::term_id id) {
+                uint64_t hash = hash_id(id);
+                int8_t tag = static_cast<int8_t>(hash & 0x7f);
+                size_t group = (hash >> 7) & group_mask;
+
+                while (true) {
+                    const int8_t * group_control = control.data() + group * GROUP_SIZE;
+                    for (uint32_t matches = match_byte(group_control, tag); matches != 0; matches &= matches - 1) {
+                        size_t slot = group * GROUP_SIZE + __builtin_ctz(matches);
+                        if (keys[slot] == id)
+                            return slot;
+                    }
+
+                    uint32_t empty_slots = match_byte(group_control, EMPTY);
+                    if (empty_slots != 0) {
+                        size_t slot = group * GROUP_SIZE + __builtin_ctz(empty_slots);
+                        control[slot] = tag;
+                        keys[slot] = id;
+                        counts[slot] = 0;
+                        used_slots.push_back(static_cast<uint32_t>(slot));
+                        return slot;
+                    }
+                    group = (group + 1) & group_mask;
+                }
+            }
+
+            /** @brief Replaces the slots by `capacity` empty ones. */
+            void allocate(size_t capacity);
+
+            /** @brief Doubles the slots and reinserts in order of first occurrence. */
+            void grow();
+    };
+
+} // namespace flat
+
+#endif // _FLAT_COUNTER_HPP
@@ -0,0 +1,121 @@
+/**
+ * @file incremental_model.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the IncrementalModel class, which keeps IDF and category centroids up to date
+ *        as batches of labeled documents arrive, without revisiting earlier documents.
+ *
+ * @details A centroid built by `cats::csr::get_all_centroids_csr()` folds every row of its
+ * category into `w[t] = (w[t] + tf * idf[t]) / row_size` in corpus order. The IDF of a term is
+ * a common factor of every step, so `w[t] = idf[t] * s[t]` where `s` follows the same
+ * recurrence on raw term frequencies. `s` does not depend on IDF, so it is the sufficient
+ * statistic of a category: appending a batch continues the recurrence for the batch's rows only.
+ * Together with the document-frequency counts and the number of documents, this reproduces a
+ * full retrain on the concatenated corpus.
+ *
+ * An update costs O(rows + non-zeros of the batch) for the document frequencies and running
+ * sums, plus one O(terms) pass that recomputes the IDF of the whole vocabulary, since every IDF
+ * depends on the number of documents. Producing centroids for classification costs
+ * O(terms × categories), the size of the model. Neither depends on the earlier documents.
+ */
+
+#ifndef _INCREMENTAL_MODEL_HPP
+#define _INCREMENTAL_MODEL_HPP
+
+#include <string>
+#include <vector>
+#include "categories.hpp"
+#include "document.hpp"
+
+
+namespace cats {
+
+    /**
+     * @class IncrementalModel
+     * @brief Document frequencies and per-category sufficient statistics of a growing training corpus.
+     */
+    class IncrementalModel {
+
+        public:
+
+            /**
+             * @brief Appends a batch of labeled documents.
+             *
+             * @details Rows are taken in order, after every earlier batch. Uncategorized rows
+             * count towards document frequencies only. New categories are appended in order
+             * of first appearance, like `FrozenCorpus`.
+             *
+             * @param batch A frozen corpus whose rows still hold term frequencies (before IDF weighting).
+             * @param thread_pool The pool that updates the categories, one task per category.
+             */
+            void add_documents(const corpus::FrozenCorpus& batch, tpool::ThreadPool& thread_pool);
+
+            /** @brief Returns the number of documents added so far. */
+            size_t num_docs() const {
+                return number_of_docs;
+            }
+
+            /** @brief Returns the category types, in order of first appearance. */
+            const std::vector<std::string>& get_category_types() const {
+                return category_types;
+            }
+
+            /** @brief Returns the number of documents added to every category. */
+            const std::vector<size_t>& get_category_docs() const {
+                return category_docs;
+            }
+
+            /** @brief Returns the number of documents containing each term, indexed by `vocab::term_id`. */
+            const std::vector<int>& get_document_frequency() const {
+                return document_frequency;
+            }
+
+            /**
+             * @brief Returns the current IDF table, `log(num_docs() / df)` and 0 for unseen terms.
+             * @details Recomputed by `add_documents()`, stays valid until the next call.
+             */
+            corpus::IdfTable idf() const {
+                return {inverse_document_frequency.data(), inverse_document_frequency.size()};
+            }
+
+            /**
+             * @brief Builds the centroid of every category from the current statistics.
+             * @param thread_pool The pool that builds the centroids, one task per category.
+             * @return The centroids, as `cats::csr::get_all_centroids_csr()` returns them.
+             */
+            centroids_s centroids(tpool::ThreadPool& thread_pool) const;
+
+        private:
+
+            size_t number_of_docs{0};                     ///< Documents added so far.
+            std::vector<int> document_frequency;          ///< Documents containing each term.
+            std::vector<double> inverse_document_frequency; ///< IDF from `document_frequency`.
+            std::vector<std::string> category_types;      ///< Category type of every statistic.
+            std::vector<size_t> category_docs;            ///< Documents of every category.
+            std::vector<std::vector<double>> term_sums;   ///< `s` of every category, indexed by term ID.
+    };
+
+} // namespace cats
+
+
+/**
+ * @namespace cats::incremental
+ * @brief Provides the exactness check of incremental training.
+ */
+namespace cats::incremental {
+
+    /**
+     * @brief Returns the largest difference between two sets of centroids, relative to the larger value.
+     *
+     * @details Compares category types, norms and every weight. Categories must be in the
+     * same order, a missing category or a type mismatch returns infinity.
+     *
+     * @param expected Centroids of a full retrain.
+     * @param actual Centroids of an incremental model.
+     */
+    extern double max_relative_difference(const centroids_s& expected, const centroids_s& actual);
+
+} // namespace cats::incremental
+
+#endif // _INCREMENTAL_MODEL_HPP
@@ -0,0 +1,107 @@
+/**
+ * @file mapped_file.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Read-only memory-mapped files and parallel record indexing for the corpus readers.
+ *
+ * @details `MappedFile` maps a whole input file into memory with `mmap()`, so reading it costs
+ * page faults rather than `getline()` copies. `index_records()` then splits the mapped bytes into
+ * records (lines) on a thread pool: the file is cut into chunks, every chunk is scanned from each
+ * state of the CSV quote automaton to know whether the next chunk starts inside a quoted field,
+ * and every chunk finds its own record ends. A quote only opens a quoted field as the first
+ * character of a field, so a stray quote in unquoted text (`12" woofer`) is plain text. Records are returned as views into the mapping, nothing is copied.
+ *
+ * @note Uses POSIX `mmap()`, like the rest of the build this targets Linux and macOS.
+ */
+
+#ifndef _MAPPED_FILE_HPP
+#define _MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "thread_pool.hpp"
+
+
+/**
+ * @namespace io
+ * @brief Provides zero-copy access to input files.
+ */
+namespace io {
+
+    /**
+     * @class MappedFile
+     * @brief Maps a file read-only for the lifetime of the object.
+     */
+    class MappedFile {
+
+        public:
+
+            /**
+             * @brief Maps `file_name` into memory.
+             * @param file_name The file to map.
+             * @throws std::runtime_error if the file cannot be opened or mapped.
+             */
+            explicit MappedFile(const std::string& file_name);
+
+            /** @brief Unmaps the file, every view into it becomes dangling. */
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            /** @brief Returns the mapped bytes. */
+            std::string_view view() const {
+                return {data, length};
+            }
+
+            /** @brief Returns the size of the file in bytes. */
+            size_t size() const {
+                return length;
+            }
+
+            /**
+             * @brief Drops the resident pages of `[begin, end)` once they have been consumed.
+             * 
+             * @details Views into the range stay valid, reading them again faults the pages 
+             * back in from the file. Only whole pages inside the range are released.
+             */
+            void release(size_t begin, size_t end) const;
+
+        private:
+
+            const char * data{nullptr}; ///< Start of the mapping, nullptr for an empty file.
+            size_t length{0};           ///< Size of the mapping.
+    };
+
+    /**
+     * @brief Splits text into newline terminated records, in parallel.
+     *
+     * @details A trailing `\r` is stripped from every record and a last record without a
+     * newline is kept, so the records match what `std::getline()` returns.
+     *
+     * @param text The text to split, usually `MappedFile::view()`.
+     * @param quote_aware If true, newlines inside double quoted CSV fields do not end a record.
+     * @param thread_pool The pool that scans the chunks.
+     * @return Views of every record, in order.
+     */
+    extern std::vector<std::string_view> index_records(std::string_view text, bool quote_aware, tpool::ThreadPool& thread_pool);
+
+    /**
+     * @brief Reads the record starting at `position` and moves `position` past it.
+     * 
+     * @details Sequential counterpart of `index_records()` with the same record rules, 
+     * used when the records are consumed as they are found.
+     * 
+     * @param text The text to read from.
+     * @param position Offset of the next record, updated.
+     * @param quote_aware If true, newlines inside double quoted CSV fields do not end a record.
+     * @param record Set to the record.
+     * @return False once `position` reached the end of `text`.
+     */
+    extern bool next_record(std::string_view text, size_t& position, bool quote_aware, std::string_view& record);
+
+} // namespace io
+
+#endif // _MAPPED_FILE_HPP
@@ -0,0 +1,106 @@
+/**
+ * @file numa.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the NUMA Topology of the machine, thread pinning and page placement, read from
+ *        sysfs and the Linux system calls directly (no libnuma).
+ *
+ * @details `Topology::detect()` reads the online nodes and their CPU lists from
+ * `/sys/devices/system/node` and keeps only the CPUs the process may run on. A `tpool::ThreadPool`
+ * built from a topology pins every worker to one CPU, spreads the workers over the nodes, and hands
+ * each node a contiguous slice of every `parallel_for()`, so the memory a node's workers first touch
+ * is on that node and the same documents go back to the same node stage after stage.
+ *
+ * Machines without the sysfs node directory, or with a single node, get a one-node topology. The
+ * pool then behaves like an unpinned pool except that its workers stay on their CPUs, and
+ * `move_to_node()` does nothing.
+ */
+
+#ifndef _NUMA_HPP
+#define _NUMA_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/**
+ * @namespace numa
+ * @brief Provides the NUMA topology and placement primitives of the thread pool.
+ */
+namespace numa {
+
+    /**
+     * @struct Node
+     * @brief One NUMA node and the CPUs of it the process may use.
+     */
+    struct Node {
+        int id;                     ///< Node number of the kernel.
+        std::vector<unsigned> cpus; ///< CPUs of the node, ascending.
+    };
+
+    /**
+     * @class Topology
+     * @brief The nodes a pool spreads its workers over, each with at least one CPU.
+     */
+    class Topology {
+
+        public:
+
+            /**
+             * @brief Reads the topology from `sysfs_root`.
+             * @details Falls back to `single_node()` when the directory is missing or lists no usable CPU.
+             */
+            static Topology detect(const std::string& sysfs_root = "/sys/devices/system/node");
+
+            /** @brief One node 0 holding every CPU the process may use. */
+            static Topology single_node();
+
+            /** @param nodes Nodes with at least one CPU each, at least one node. */
+            explicit Topology(std::vector<Node> nodes) : node_list{std::move(nodes)} {}
+
+            const std::vector<Node>& nodes() const {
+                return node_list;
+            }
+
+            size_t num_nodes() const {
+                return node_list.size();
+            }
+
+            /** @brief Returns the number of CPUs over every node. */
+            size_t num_cpus() const;
+
+        private:
+
+            std::vector<Node> node_list;
+    };
+
+    /**
+     * @brief Parses a kernel CPU or node list such as `0-3,8-11,16`.
+     * @throws std::invalid_argument if the list is malformed.
+     */
+    extern std::vector<unsigned> parse_cpu_list(const std::string& list);
+
+    /** @brief Returns the CPUs the calling thread may run on, ascending. */
+    extern std::vector<unsigned> allowed_cpus();
+
+    /**
+     * @brief Pins the calling thread to one CPU.
+     * @return False if the kernel refused, the thread is then left where it was.
+     */
+    extern bool pin_current_thread(unsigned cpu);
+
+    /**
+     * @brief Migrates the pages holding `[begin, begin + bytes)` to node `node`.
+     *
+     * @details The pages at both ends may be shared with neighbouring data and move too. Only
+     * pages already touched move, untouched ones are placed by their first touch.
+     *
+     * @return False if the system call is unavailable or failed, the pages then stay where they are.
+     */
+    extern bool move_to_node(const void * begin, size_t bytes, int node);
+
+} // namespace numa
+
+#endif // _NUMA_HPP
@@ -0,0 +1,119 @@
+/**
+ * @file online_classifier.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the OnlineClassifier class, which classifies one raw text at a time for serving.
+ *
+ * @details The batch drivers read whole files, intern every new term and record their results
+ * in `cats::u_classified`. `OnlineClassifier::classify()` instead takes a single text and returns
+ * its label, score and the terms that weighed most in the decision, with no writes to shared
+ * state: terms are looked up in the vocabulary without interning, the stem cache is bypassed
+ * for a per-thread token memo, and weights use the trained IDF (see `corpus::IdfTable`), so the
+ * result never depends on other documents.
+ *
+ * Per-thread scratch buffers (term counts, touched terms, dot products) are reused between
+ * calls, so a warm call does not allocate beyond the returned top terms.
+ */
+
+#ifndef _ONLINE_CLASSIFIER_HPP
+#define _ONLINE_CLASSIFIER_HPP
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "batch_classifier.hpp"
+#include "document.hpp"
+
+
+namespace cats {
+
+    /**
+     * @struct TermScore
+     * @brief A term of a classified text and its share of the winning score.
+     */
+    struct TermScore {
+        std::string_view term; ///< The stemmed term, valid while the vocabulary is not cleared.
+        double weight;         ///< Contribution to the cosine similarity of the label.
+    };
+
+    /**
+     * @struct Prediction
+     * @brief Result of classifying one text.
+     */
+    struct Prediction {
+        std::string_view label;           ///< Winning category type, empty when nothing matched.
+        double score{0.0};                ///< Cosine similarity to the winning category.
+        std::vector<TermScore> top_terms; ///< Highest contributions, best first.
+    };
+
+    /**
+     * @class OnlineClassifier
+     * @brief Thread-safe, reentrant single-text classifier over a frozen model.
+     *
+     * @details Holds only shared, immutable state, any number of threads may call `classify()`
+     * on the same object. Results match the batch path run with `use_training_idf`.
+     */
+    class OnlineClassifier {
+
+        public:
+
+            /**
+             * @brief Creates a classifier over trained centroids and IDF.
+             *
+             * @param centroids The frozen category centroids.
+             * @param idf The training IDF, indexed like the centroids.
+             * @param idf_owner Keeps `idf.values` alive (a model file or a copied table).
+             * @param num_top_terms Number of top terms returned with every prediction.
+             */
+            OnlineClassifier(std::shared_ptr<const CentroidMatrix> centroids, corpus::IdfTable idf,
+                             std::shared_ptr<const void> idf_owner, size_t num_top_terms = 5);
+
+            /**
+             * @brief Classifies one raw text.
+             * @param text The text, tokenized and stemmed like training documents.
+             * @param prediction Receives the result, its `top_terms` storage is reused.
+             */
+            void classify(std::string_view text, Prediction& prediction) const;
+
+            /** @brief Classifies one raw text, see `classify(std::string_view, Prediction&)`. */
+            Prediction classify(std::string_view text) const {
+                Prediction prediction;
+                classify(text, prediction);
+                return prediction;
+            }
+
+            /**
+             * @brief Turns one raw text into its TF-IDF row, for scoring in a batch.
+             * 
+             * @details Same weights `classify()` scores, with the same guarantees. Pass the 
+             * result to `BatchClassifier::score()` as a `sparse::RowView`.
+             * 
+             * @param text The raw text.
+             * @param term_ids Receives the sorted term IDs, cleared first.
+             * @param values Receives the matching TF-IDF values, cleared first.
+             */
+            void vectorize(std::string_view text, std::vector<vocab::term_id>& term_ids, std::vector<double>& values) const;
+
+            /** @brief Returns the centroid matrix. */
+            const CentroidMatrix& centroids() const {
+                return *centroid_matrix;
+            }
+
+            /** @brief Returns the shared centroid matrix, for a `BatchClassifier` over the same model. */
+            const std::shared_ptr<const CentroidMatrix>& shared_centroids() const {
+                return centroid_matrix;
+            }
+
+        private:
+
+            std::shared_ptr<const CentroidMatrix> centroid_matrix; ///< Shared, never modified.
+            corpus::IdfTable idf;                                  ///< Training IDF.
+            std::shared_ptr<const void> idf_owner;                 ///< Owner of `idf.values`.
+            size_t num_top_terms;                                  ///< Terms returned per prediction.
+            size_t instance_id;                                    ///< Tells the per-thread memos of two classifiers apart.
+    };
+
+} // namespace cats
+
+#endif // _ONLINE_CLASSIFIER_HPP
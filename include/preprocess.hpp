@@ -3,20 +3,72 @@
  * @ingroup HeaderFiles
  * 
  * @author Andrew Kelton
- * @brief Handles text preprocessing tasks such as stemming and text normalization.
+ * @brief Handles text preprocessing tasks such as tokenizing, stemming and text normalization.
  * 
  * @details This module provides functions for processing and normalizing text data 
  * in `Document` objects. It uses the Oleander Stemming Library to reduce words 
  * to their root forms (e.g., "enjoying" → "enjoy"). 
  * 
+ * @par Changelog:
+ * - Added `preprocess::Tokenizer`, a single pass tokenizer that lowercases and strips 
+ *   punctuation and digits while splitting, replacing `preprocess_text()` + `std::istringstream`.
+ * - Stemming reuses one stemmer and one wide buffer per thread, ASCII tokens are widened 
+ *   byte by byte and only non-ASCII tokens are decoded as UTF-8.
+ * 
  * @see https://github.com/Blake-Madden/OleanderStemmingLibrary
  */
 
 #ifndef _PREPROCESS_HPP
 #define _PREPROCESS_HPP
 
+#include <string_view>
 #include "document.hpp"
 
+
+/**
+ * @namespace preprocess
+ * @brief Provides the tokenizer used to split raw document text into normalized terms.
+ */
+namespace preprocess {
+
+    /**
+     * @class Tokenizer
+     * @brief Single pass, zero-copy tokenizer over raw document text.
+     * 
+     * @details Splits on whitespace and, in the same pass, lowercases ASCII letters and 
+     * drops ASCII punctuation and digits, exactly like `preprocess_text()` followed by 
+     * `std::istringstream`. Tokens that need no change are returned as views into the 
+     * text; the rest are rebuilt in an internal scratch buffer. Tokens left empty after 
+     * stripping (e.g. "2005") are skipped.
+     */
+    class Tokenizer {
+
+        public:
+
+            /**
+             * @brief Creates a tokenizer over `text`, which must outlive the tokenizer.
+             * @param text The raw text to tokenize.
+             */
+            explicit Tokenizer(std::string_view text) : text{text} {}
+
+            /**
+             * @brief Advances to the next token.
+             * 
+             * @param token Set to the next normalized token, valid until the next call.
+             * @return False once the text is exhausted.
+             */
+            bool next(std::string_view& token);
+
+        private:
+
+            std::string_view text; ///< Text being tokenized.
+            size_t position{0};    ///< Offset of the next unread byte.
+            std::string scratch;   ///< Buffer for tokens that had to be rewritten.
+    };
+
+} // namespace preprocess
+
+
 /**
  * @brief Reduces a given word to its root form using stemming.
  * 
@@ -39,14 +91,27 @@
  */
 extern std::string preprocess_prune_term(std::string str);
 
+/**
+ * @brief Stems a token into a caller owned buffer.
+ * 
+ * @details Same result as `preprocess_prune_term()`, but reuses the calling thread's 
+ * stemmer and `stemmed`'s capacity, so steady state stemming does not allocate. 
+ * Tokens that are not valid UTF-8 are copied unstemmed.
+ * 
+ * @param token The token to be stemmed.
+ * @param stemmed Receives the stemmed token.
+ */
+extern void preprocess_stem_term(std::string_view token, std::string& stemmed);
+
 /**
  * @brief Applies text preprocessing to a document.
  * 
- * @details This function processes all text in the given `Document` object, 
- * performing tasks such as stemming and text normalization.
+ * @details This function processes all text in the given `Document` object in place, 
+ * lowercasing it and removing punctuation and numbers. Vectorization no longer calls 
+ * it, `preprocess::Tokenizer` applies the same normalization while tokenizing.
  * 
  * @param doc Pointer to the `Document` object to preprocess.
  */
 extern void preprocess_text(docs::Document * doc);
 
-#endif // _PREPROCESS_HPP
\ No newline at end of file
+#endif // _PREPROCESS_HPP
@@ -0,0 +1,227 @@
+/**
+ * @file profiler.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the Profiler class, nanosecond scoped timers for pipeline stages and sub-stages
+ *        with per-thread totals and JSON/CSV export.
+ *
+ * @details Every timed place is a `Site` named by a `/`-separated path, such as
+ * `vectorization/tokenize/stem`, and the paths form the hierarchy of the report. A `Site` is
+ * registered once (function-local static) and then identified by its index, so timing a scope
+ * is two `steady_clock` reads and two relaxed stores into the calling thread's own counters, with
+ * no lock and no shared cache line.
+ *
+ * The four pipeline sections of `TFIDF_` are always timed with `SectionTimer`. Sub-stages inside
+ * the hot loops are timed with `PROF_SCOPE(path)`, which compiles to nothing unless
+ * `TFIDF_PROFILE` is defined (`make test PROFILE=1`).
+ *
+ * Totals are summed over every thread and kept per thread, scopes running on workers at once add
+ * up to more than the wall time of their parent. `write_json()` writes the hierarchy,
+ * `write_csv()` one row per site and thread.
+ */
+
+#ifndef _PROFILER_HPP
+#define _PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * @namespace prof
+ * @brief Provides the profiler every stage of the pipeline reports to.
+ */
+namespace prof {
+
+    constexpr size_t MAX_SITES{64}; ///< Distinct sites a profiler holds.
+
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Record
+     * @brief Time spent in one site by one thread, or by every thread.
+     */
+    struct Record {
+        std::string path;   ///< Site path, `/`-separated.
+        size_t thread;      ///< Index of the thread, in order of its first timed scope.
+        uint64_t calls;     ///< Scopes timed.
+        uint64_t ns;        ///< Nanoseconds spent in them.
+    };
+
+    /**
+     * @class Profiler
+     * @brief Registry of sites and per-thread totals.
+     *
+     * @details Thread-safe: a thread takes the registry lock once, when it first adds a time.
+     * `records()` is exact once no thread is timing, approximate otherwise.
+     */
+    class Profiler {
+
+        public:
+
+            Profiler() = default;
+            Profiler(const Profiler&) = delete;
+            Profiler& operator=(const Profiler&) = delete;
+
+            /**
+             * @brief Returns the index of a path, registering it on first use.
+             * @throws std::length_error if more than `MAX_SITES` paths are registered.
+             */
+            size_t register_site(std::string_view path);
+
+            /** @brief Adds one call of `ns` nanoseconds to a site, for the calling thread. */
+            void add(size_t site, uint64_t ns);
+
+            /** @brief Returns the totals of every site and thread that has calls, sorted by path then thread. */
+            std::vector<Record> records() const;
+
+            /** @brief Returns the totals of every site summed over threads, sorted by path, `thread` is 0. */
+            std::vector<Record> totals() const;
+
+            /** @brief Zeroes every total, keeps the sites. Not while any thread is timing. */
+            void reset();
+
+            /**
+             * @brief Writes the site hierarchy with totals and per-thread times.
+             * @throws std::runtime_error if the file cannot be written.
+             */
+            void write_json(const std::string& file_name) const;
+
+            /**
+             * @brief Writes `path,thread,calls,ns` rows, thread `all` for the totals.
+             * @throws std::runtime_error if the file cannot be written.
+             */
+            void write_csv(const std::string& file_name) const;
+
+        private:
+
+            /**
+             * @struct Counter
+             * @brief Totals of one site for one thread, only written by that thread.
+             */
+            struct Counter {
+                std::atomic<uint64_t> calls{0};
+                std::atomic<uint64_t> ns{0};
+            };
+
+            /**
+             * @struct ThreadTotals
+             * @brief Counters of one thread, kept after the thread exits.
+             */
+            struct alignas(64) ThreadTotals {
+                size_t index;
+                std::array<Counter, MAX_SITES> sites;
+            };
+
+            mutable std::mutex registry_mtx;                    ///< Guards `paths` and `threads`.
+            std::vector<std::string> paths;                     ///< Path of every site, by index.
+            std::vector<std::unique_ptr<ThreadTotals>> threads; ///< One per thread that added a time.
+
+            /** @brief Returns the calling thread's counters, created on first use. */
+            ThreadTotals& local_totals();
+    };
+
+    /** @brief Returns the profiler of the process. */
+    extern Profiler& profiler();
+
+    /**
+     * @class Site
+     * @brief A timed place of the code, registered once with `profiler()`.
+     */
+    class Site {
+
+        public:
+
+            /** @param path `/`-separated path, the parent path is the enclosing stage. */
+            explicit Site(std::string_view path) : site_id{profiler().register_site(path)} {}
+
+            size_t id() const {
+                return site_id;
+            }
+
+        private:
+
+            size_t site_id;
+    };
+
+    /**
+     * @class ScopedTimer
+     * @brief Adds the time from its construction to its destruction to a site.
+     */
+    class ScopedTimer {
+
+        public:
+
+            explicit ScopedTimer(const Site& site) : site{site}, start{clock::now()} {}
+
+            ~ScopedTimer() {
+                profiler().add(site.id(), static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count()));
+            }
+
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        private:
+
+            const Site& site;
+            clock::time_point start;
+    };
+
+    /**
+     * @class SectionTimer
+     * @brief Times one section after another and returns each duration, for stages that print it.
+     */
+    class SectionTimer {
+
+        public:
+
+            /** @brief Starts timing `site`. */
+            void start(const Site& site) {
+                current = &site;
+                begin = clock::now();
+            }
+
+            /**
+             * @brief Adds the time since `start()` to its site.
+             * @return The time in milliseconds, with nanosecond resolution.
+             */
+            double stop() {
+                uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count());
+                if (current != nullptr)
+                    profiler().add(current->id(), ns);
+                current = nullptr;
+                return static_cast<double>(ns) / 1e6;
+            }
+
+        private:
+
+            const Site * current{nullptr};
+            clock::time_point begin;
+    };
+
+} // namespace prof
+
+#define _PROF_CONCAT_(a, b) a##b
+#define _PROF_CONCAT(a, b) _PROF_CONCAT_(a, b)
+
+/**
+ * @def PROF_SCOPE
+ * @brief Times the rest of the enclosing scope under `path`, nothing unless `TFIDF_PROFILE` is defined.
+ */
+#ifdef TFIDF_PROFILE
+#define PROF_SCOPE(path) \
+    static const prof::Site _PROF_CONCAT(prof_site_, __LINE__){path}; \
+    prof::ScopedTimer _PROF_CONCAT(prof_timer_, __LINE__){_PROF_CONCAT(prof_site_, __LINE__)}
+#else
+#define PROF_SCOPE(path) do {} while (false)
+#endif
+
+#endif // _PROFILER_HPP
@@ -0,0 +1,75 @@
+/**
+ * @file sparse_kernels.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Dot product and norm kernels used by cosine classification.
+ *
+ * @details Cosine similarity used to do a hash `find()` plus `at()` for every shared word and
+ * recompute both norms on every call. These kernels work on flat arrays instead:
+ * - `dot_sorted()` intersects two term ID sorted vectors with a linear merge, or gallops
+ *   through the longer one when their sizes are far apart;
+ * - `dot_dense()` gathers the weights of a sparse vector out of a dense, term ID indexed
+ *   array, 4 (AVX2) or 8 (AVX-512) terms at a time;
+ * - `squared_norm()` sums squares with the same vector widths.
+ *
+ * The instruction set is detected once at runtime, so a single binary runs the AVX-512,
+ * AVX2 or scalar path depending on the CPU. `set_kernel_level()` can force a lower level,
+ * e.g. to compare paths in a benchmark.
+ */
+
+#ifndef _SPARSE_KERNELS_HPP
+#define _SPARSE_KERNELS_HPP
+
+#include "csr_matrix.hpp"
+
+
+namespace sparse {
+
+    /**
+     * @enum KernelLevel
+     * @brief Instruction sets the kernels can run with, ordered from slowest to fastest.
+     */
+    enum class KernelLevel {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    /** @brief Returns the best level supported by the CPU and the compiler. */
+    extern KernelLevel detected_kernel_level();
+
+    /** @brief Returns the level the kernels currently run with. */
+    extern KernelLevel kernel_level();
+
+    /**
+     * @brief Selects the level the kernels run with.
+     * @param level The requested level, lowered to `detected_kernel_level()` if unsupported.
+     */
+    extern void set_kernel_level(KernelLevel level);
+
+    /** @brief Returns a printable name for `level`. */
+    extern const char * kernel_name(KernelLevel level);
+
+    /**
+     * @brief Dot product of two sparse vectors sorted by term ID.
+     *
+     * @details Linear merge when the sizes are comparable, galloping (exponential) search
+     * through the longer vector when it is at least 32x longer than the other.
+     */
+    extern double dot_sorted(const RowView& a, const RowView& b);
+
+    /**
+     * @brief Dot product of a sparse vector with a dense, term ID indexed vector.
+     *
+     * @details Term IDs at or past `dense_size` count as 0, so a vector may hold terms
+     * interned after the dense vector was built. The sparse vector need not be sorted.
+     */
+    extern double dot_dense(const RowView& row, const double * dense, size_t dense_size);
+
+    /** @brief Sum of squares of `size` values. */
+    extern double squared_norm(const double * values, size_t size);
+
+} // namespace sparse
+
+#endif // _SPARSE_KERNELS_HPP
@@ -0,0 +1,161 @@
+/**
+ * @file stem_cache.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the StemCache class, which memoizes raw token to term ID lookups.
+ *
+ * @details The same surface words ("said", "government", "markets") appear thousands of times
+ * in a corpus, and each of them used to go through the stemmer and the vocabulary every time.
+ * `StemCache` remembers the result per raw token in two levels:
+ * - a small per-thread L1 map, no locking at all;
+ * - a shared table split into shards, each behind a `std::shared_mutex`, so the read-mostly
+ *   steady state only ever takes shared locks.
+ *
+ * The cache can be warmed from and persisted to a `token<TAB>stem` text file, so repeat runs
+ * and the testing corpus skip stemming almost completely. Stems are stored rather than IDs
+ * since IDs are only valid for the vocabulary of a single run; warmed entries are resolved to
+ * an ID the first time they are looked up.
+ */
+
+#ifndef _STEM_CACHE_HPP
+#define _STEM_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "vocabulary.hpp"
+
+
+/**
+ * @namespace stem
+ * @brief Provides the concurrent token to term ID cache used during vectorization.
+ */
+namespace stem {
+
+    /**
+     * @struct CacheStats
+     * @brief Snapshot of the cache counters, used to size the cache.
+     */
+    struct CacheStats {
+        size_t l1_hits;     ///< Lookups answered by the calling thread's L1.
+        size_t shared_hits; ///< Lookups answered by the shared table.
+        size_t misses;      ///< Lookups that had to run the stemmer.
+        size_t entries;     ///< Tokens in the shared table.
+
+        /** @brief Returns the fraction of lookups that skipped the stemmer. */
+        double hit_rate() const {
+            size_t lookups = l1_hits + shared_hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(l1_hits + shared_hits) / lookups;
+        }
+    };
+
+    /**
+     * @class StemCache
+     * @brief Thread-safe memo of raw token → stem → term ID.
+     *
+     * @details What a token resolves to is decided by the `Resolver` passed to `lookup()`,
+     * which receives the stem and returns its ID, or `vocab::UNKNOWN_TERM` for stems that are
+     * dropped (stopwords). A cache must always be used with the same resolver.
+     *
+     * @note IDs come from `vocab::vocabulary`; clearing the vocabulary requires `clear()`ing
+     * the cache as well.
+     */
+    class StemCache {
+
+        public:
+
+            using Resolver = vocab::term_id (*)(const std::string& stem); ///< Maps a stem to its ID.
+
+            /**
+             * @brief Returns the term ID of a raw token, stemming and resolving it on a miss.
+             *
+             * @param token A normalized token from `preprocess::Tokenizer`.
+             * @param resolve Called with the stem when the token has no ID yet.
+             * @return The ID of the token's stem, or `vocab::UNKNOWN_TERM` if it is dropped.
+             */
+            vocab::term_id lookup(std::string_view token, Resolver resolve);
+
+            /**
+             * @brief Warms the cache from a file written by `save()`.
+             *
+             * @param file_name The `token<TAB>stem` file.
+             * @return Number of new tokens added.
+             * @throws std::runtime_error if the file cannot be opened.
+             */
+            size_t load(const std::string& file_name);
+
+            /**
+             * @brief Writes every cached token and its stem to a file, sorted by token.
+             *
+             * @param file_name The output file.
+             * @throws std::runtime_error if the file cannot be written.
+             */
+            void save(const std::string& file_name) const;
+
+            /** @brief Returns the current counters and number of entries. */
+            CacheStats stats() const;
+
+            /** @brief Resets the hit and miss counters, keeps the entries. */
+            void reset_counters();
+
+            /** @brief Removes every entry from the shared table and every thread's L1. */
+            void clear();
+
+        private:
+
+            static constexpr size_t NUM_SHARDS{64};       ///< Shared table shards, a power of two.
+            static constexpr size_t L1_CAPACITY{1 << 15}; ///< Per-thread L1 is dropped when it grows past this.
+
+            /** @brief Set for warmed entries until their stem is first resolved. */
+            static constexpr vocab::term_id UNRESOLVED{vocab::UNKNOWN_TERM - 1};
+
+            /**
+             * @struct Entry
+             * @brief Cached stem of a token and its ID once resolved.
+             */
+            struct Entry {
+                std::string stem;
+                std::atomic<vocab::term_id> id{UNRESOLVED};
+            };
+
+            /**
+             * @struct Shard
+             * @brief One slice of the shared table, on its own cache line.
+             */
+            struct alignas(64) Shard {
+                mutable std::shared_mutex shard_mtx;
+                std::unordered_map<std::string, Entry> entries;
+            };
+
+            /**
+             * @struct Counters
+             * @brief One stripe of the counters, threads are spread across stripes.
+             */
+            struct alignas(64) Counters {
+                std::atomic<size_t> l1_hits{0};
+                std::atomic<size_t> shared_hits{0};
+                std::atomic<size_t> misses{0};
+            };
+
+            std::array<Shard, NUM_SHARDS> shards;
+            std::array<Counters, NUM_SHARDS> counters;
+            std::atomic<size_t> generation{0}; ///< Bumped by `clear()` so threads drop stale L1s.
+
+            /** @brief Returns the shard holding `key`. */
+            Shard& shard_for(const std::string& key) {
+                return shards[std::hash<std::string>{}(key) & (NUM_SHARDS - 1)];
+            }
+
+            /** @brief Returns the calling thread's counter stripe. */
+            Counters& local_counters();
+    };
+
+    extern StemCache stem_cache; ///< Cache used by vectorization.
+
+} // namespace stem
+
+#endif // _STEM_CACHE_HPP
@@ -0,0 +1,146 @@
+/**
+ * @file stopwords.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the StopwordSet class, a perfect hash set of the stems vectorization drops.
+ *
+ * @details A set is a power-of-two table of word indices plus a hash seed chosen so that no
+ * two of its words share a slot. Checking a stem is then one hash of its few characters, one
+ * table load and at most one string compare, with no probing and no allocation. Stems longer
+ * than the longest stopword are rejected before hashing.
+ *
+ * The built-in English list is turned into such a table at compile time: the seed search runs
+ * in a `constexpr` function, so the table is plain read-only data. Lists loaded at startup
+ * (`load()`) go through the same search at runtime and end up in the same layout, so another
+ * domain's stopwords cost exactly as much per token as the English ones.
+ *
+ * Vectorization checks the stopwords of the `active()` set. Since the stem cache remembers
+ * that a token was dropped, the set must be chosen before any document is vectorized, or the
+ * cache `clear()`ed after switching.
+ */
+
+#ifndef _STOPWORDS_HPP
+#define _STOPWORDS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * @namespace stopwords
+ * @brief Provides the stopword sets vectorization filters stems with.
+ */
+namespace stopwords {
+
+    using word_index = uint16_t;                ///< Index of a word in a set, stored per slot.
+    constexpr word_index NO_WORD{0xFFFF};       ///< Slot holding no word.
+    constexpr size_t MAX_WORDS{NO_WORD};        ///< Words a set holds at most.
+
+    /**
+     * @brief Hashes a word with a seed, the top bits of the result pick its slot.
+     * @details FNV-1a over the characters, then a multiplicative mix so the top bits depend on every character.
+     */
+    constexpr uint64_t hash_word(std::string_view word, uint64_t seed) {
+        uint64_t hash = seed;
+        for (char c : word)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+        return (hash ^ word.size()) * 0x9E3779B97F4A7C15ull;
+    }
+
+    /**
+     * @class StopwordSet
+     * @brief Immutable perfect hash set of stopwords.
+     *
+     * @details Either views the compile-time tables of a built-in list or owns the tables of a
+     * list built at runtime. Movable, not copyable.
+     */
+    class StopwordSet {
+
+        public:
+
+            /** @brief Creates an empty set, nothing is a stopword. */
+            StopwordSet();
+
+            /**
+             * @brief Builds the perfect hash of a list at runtime.
+             *
+             * @param words The stopwords, compared as given. Duplicates and empty words are dropped.
+             * @throws std::length_error if there are more than `MAX_WORDS` distinct words.
+             */
+            explicit StopwordSet(std::vector<std::string> words);
+
+            StopwordSet(StopwordSet&&) = default;
+            StopwordSet& operator=(StopwordSet&&) = default;
+            StopwordSet(const StopwordSet&) = delete;
+            StopwordSet& operator=(const StopwordSet&) = delete;
+
+            /** @brief Returns true if `word` is one of the stopwords. */
+            bool contains(std::string_view word) const {
+                if (word.size() > max_length)
+                    return false;
+                word_index index = slots[hash_word(word, seed) >> shift];
+                return index != NO_WORD && words[index] == word;
+            }
+
+            /** @brief Returns the number of stopwords. */
+            size_t size() const {
+                return count;
+            }
+
+            /** @brief Returns the number of slots of the hash table. */
+            size_t slot_count() const {
+                return size_t{1} << (64 - shift);
+            }
+
+        private:
+
+            std::vector<std::string> owned_words;      ///< Storage of a runtime list, empty for a built-in one.
+            std::vector<std::string_view> owned_views; ///< Views of `owned_words`.
+            std::vector<word_index> owned_slots;       ///< Slots of a runtime list.
+
+            const std::string_view * words; ///< Every stopword, indexed by the slots.
+            const word_index * slots;       ///< Word index or `NO_WORD` of every slot.
+            uint64_t seed;                  ///< Seed of `hash_word()` that places every word in its own slot.
+            unsigned shift;                 ///< 64 minus the log2 of the number of slots.
+            size_t max_length;              ///< Length of the longest stopword.
+            size_t count;                   ///< Number of stopwords.
+
+            /** @brief Views tables built at compile time. */
+            StopwordSet(const std::string_view * words, size_t count, const word_index * slots,
+                        unsigned shift, uint64_t seed, size_t max_length);
+
+            friend const StopwordSet& english();
+    };
+
+    /** @brief Returns the built-in English stopwords, whose hash table is generated at compile time. */
+    extern const StopwordSet& english();
+
+    /**
+     * @brief Builds a set from a stopword file.
+     *
+     * @details One word per line, lowercased and trimmed. Blank lines and lines starting with
+     * `#` are skipped. Words are compared to stems, so a list should hold the stemmed forms.
+     *
+     * @param file_name The stopword file.
+     * @return The set of the file's words.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    extern StopwordSet load(const std::string& file_name);
+
+    /** @brief Returns the set vectorization drops stems of, `english()` unless changed. */
+    extern const StopwordSet& active();
+
+    /**
+     * @brief Makes vectorization drop the stems of `set`.
+     *
+     * @details Not synchronized: call it before any vectorization starts. `set` must outlive
+     * every use of the stopwords.
+     */
+    extern void set_active(const StopwordSet& set);
+
+} // namespace stopwords
+
+#endif // _STOPWORDS_HPP
@@ -0,0 +1,71 @@
+/**
+ * @file streaming.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Streaming vectorization of corpora that do not fit in memory.
+ *
+ * @details The regular path keeps every `docs::Document`, its raw text and its three maps in
+ * `Corpus::documents` at once. `stream_corpus()` instead runs three pipelined stages over
+ * bounded queues of document batches:
+ * - a reader thread walks the memory-mapped file and cuts it into batches of record views;
+ * - the calling thread tokenizes, stems and counts each batch on the thread pool and packs
+ *   the term frequencies into a small CSR block, after which the batch's documents (and
+ *   their text) are dropped;
+ * - a collector thread appends each block to the output `corpus::FrozenCorpus`, updates
+ *   the global document frequencies and releases the consumed pages of the file.
+ *
+ * Only the compact sparse rows and the document frequencies are kept, so memory holds at
+ * most `queue_capacity` raw batches in each queue no matter how large the input is.
+ *
+ * @note The reader and collector are dedicated threads rather than pool tasks: they block
+ * on the queues for the whole run, which would tie up pool workers (or never run at all on
+ * the worker-less pool used by sequential runs).
+ */
+
+#ifndef _STREAMING_HPP
+#define _STREAMING_HPP
+
+#include <string>
+#include "document.hpp"
+
+
+namespace stream {
+
+    /**
+     * @enum InputFormat
+     * @brief Layout of a streamed input file.
+     */
+    enum class InputFormat {
+        csv,  ///< Header line, then 'category,text' records, quoted fields allowed.
+        lines ///< One uncategorized document per line.
+    };
+
+    /**
+     * @struct StreamSettings
+     * @brief Sizes of the streaming pipeline.
+     */
+    struct StreamSettings {
+        size_t batch_size{256};    ///< Documents per batch.
+        size_t queue_capacity{4};  ///< Batches each queue may hold.
+    };
+
+    /**
+     * @brief Vectorizes a file into a frozen corpus without keeping documents resident.
+     *
+     * @details Rows keep the file's order. On return `matrix` holds term frequencies and
+     * `document_frequency` is complete, so the corpus only needs
+     * `FrozenCorpus::apply_inverse_document_frequency()` for TF-IDF weights.
+     *
+     * @param file_name The input file.
+     * @param format The layout of the input file.
+     * @param thread_pool The pool that vectorizes each batch.
+     * @param settings Batch and queue sizes.
+     * @return The vectorized corpus.
+     * @throws std::runtime_error if the file cannot be opened, or any error of a stage.
+     */
+    extern corpus::FrozenCorpus stream_corpus(const std::string& file_name, InputFormat format, tpool::ThreadPool& thread_pool, const StreamSettings& settings = StreamSettings{});
+
+} // namespace stream
+
+#endif // _STREAMING_HPP
@@ -0,0 +1,350 @@
+/**
+ * @file thread_pool.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the persistent work-stealing ThreadPool used by every parallel stage.
+ *
+ * @details Instead of spawning a fresh batch of `std::thread`s per stage, `TFIDF::TFIDF_` owns
+ * one `ThreadPool` and every stage (vectorization, TF-IDF, categories, classification) submits
+ * small tasks to it. Each worker owns a deque of tasks, pops its own work from the back, and
+ * steals from the front of other workers' deques when it runs dry, so a few slow documents no
+ * longer hold an entire static chunk hostage.
+ *
+ * The thread waiting on a `TaskGroup` also runs queued tasks, so nested `parallel_for()` calls
+ * cannot deadlock and a pool of 0 workers simply runs everything on the calling thread.
+ *
+ * A pool built from a `numa::Topology` pins each worker to one CPU and spreads the workers over
+ * the nodes. `parallel_for()` then gives every node a contiguous share of the range, queued on its
+ * own workers, and workers steal from their own node before any other. The same range goes to
+ * the same nodes stage after stage, so documents are processed where their memory was first
+ * touched. `NodeReplicas` copies read-only tables (IDF, centroids) once per node.
+ */
+
+#ifndef _THREAD_POOL_HPP
+#define _THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "numa.hpp"
+#include "utils.hpp"
+
+
+/**
+ * @namespace tpool
+ * @brief Provides the work-stealing thread pool and its task groups.
+ */
+namespace tpool {
+
+    /**
+     * @class TaskGroup
+     * @brief Tracks a batch of submitted tasks so the submitter can wait for all of them.
+     *
+     * @details The first exception thrown by a task in the group is captured and rethrown
+     * by `ThreadPool::wait()`.
+     */
+    class TaskGroup {
+
+        friend class ThreadPool;
+
+        private:
+
+            std::atomic<size_t> remaining{0}; ///< Tasks submitted but not finished.
+            std::mutex group_mtx;             ///< Guards `error` and the completion signal.
+            std::condition_variable done_cv;  ///< Signaled when `remaining` reaches 0.
+            std::exception_ptr error;         ///< First exception thrown by a task.
+    };
+
+    /**
+     * @struct NodeStats
+     * @brief Work the threads of one node ran through `parallel_for()`.
+     */
+    struct NodeStats {
+        int node{0};            ///< Node number of the kernel.
+        unsigned workers{0};    ///< Workers pinned to the node.
+        uint64_t items{0};      ///< Items of the tasks run on the node.
+        uint64_t tasks{0};      ///< Tasks run on the node.
+        uint64_t busy_ns{0};    ///< Time spent in those tasks, summed over the node's threads.
+
+        /** @brief Returns the items processed per second of busy time, 0 when idle. */
+        double items_per_second() const {
+            return busy_ns == 0 ? 0.0 : static_cast<double>(items) * 1e9 / static_cast<double>(busy_ns);
+        }
+    };
+
+    /**
+     * @class ThreadPool
+     * @brief Persistent pool of workers with per-worker deques and work stealing.
+     *
+     * @details The thread waiting in `wait()` (or `parallel_for()`) runs queued tasks as well,
+     * so a pool of N workers runs a loop on N + 1 threads. `workers_for()` accounts for it.
+     */
+    class ThreadPool {
+
+        public:
+
+            /**
+             * @brief Starts the workers.
+             * @param num_workers Number of worker threads, 0 runs every task on the waiting thread.
+             */
+            explicit ThreadPool(unsigned num_workers);
+
+            /**
+             * @brief Starts the workers pinned over a NUMA topology.
+             *
+             * @details Worker `i` is pinned to CPU `i * num_cpus / num_workers` of the topology's
+             * CPUs in node order, so the workers are spread evenly over the nodes. Nodes left
+             * without a worker are not part of the pool.
+             *
+             * @param num_workers Number of worker threads, 0 runs every task on the waiting thread.
+             * @param topology The nodes and CPUs to pin the workers to.
+             */
+            ThreadPool(unsigned num_workers, const numa::Topology& topology);
+
+            /** @brief Finishes queued tasks and joins every worker. */
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            /** @brief Returns the number of worker threads. */
+            unsigned size() const {
+                return static_cast<unsigned>(workers.size());
+            }
+
+            /** @brief Returns the number of nodes the workers are spread over, 1 for an unpinned pool. */
+            unsigned num_nodes() const {
+                return static_cast<unsigned>(node_ids.size());
+            }
+
+            /** @brief Returns the kernel's number of pool node `node`. */
+            int node_id(unsigned node) const {
+                return node_ids[node];
+            }
+
+            /** @brief Returns the pool node of the calling worker, 0 for threads outside the pool. */
+            unsigned current_node() const;
+
+            /**
+             * @brief Runs `fn(node)` once on a worker of every node and waits.
+             * @details Runs `fn(0)` on the calling thread when the pool has a single node.
+             */
+            void run_on_nodes(const std::function<void(unsigned)>& fn);
+
+            /**
+             * @brief Moves the pages of `items` to the nodes `parallel_for(count, fn, grain)` hands them to.
+             * @details For arrays touched before the parallel stages, does nothing on a single node.
+             */
+            template<typename T>
+            void place_on_nodes(const T * items, size_t count, size_t grain = 0) const {
+                if (num_nodes() < 2 || count == 0)
+                    return;
+
+                if (grain == 0)
+                    grain = default_grain(count);
+
+                size_t number_of_tasks = (count + grain - 1) / grain;
+                for (unsigned node = 0; node < num_nodes(); node++) {
+                    size_t begin = std::min(count, first_task_of_node(node, number_of_tasks) * grain);
+                    size_t end = std::min(count, first_task_of_node(node + 1, number_of_tasks) * grain);
+                    numa::move_to_node(items + begin, (end - begin) * sizeof(T), node_ids[node]);
+                }
+            }
+
+            /** @brief Returns what every node ran through `parallel_for()` since the last reset, by pool node. */
+            std::vector<NodeStats> node_stats() const;
+
+            /** @brief Zeroes the node counters. Not while tasks are running. */
+            void reset_node_stats();
+
+            /**
+             * @brief Queues a task as part of `group`.
+             *
+             * @details Tasks submitted from a worker go to that worker's own deque, tasks
+             * submitted from outside the pool are spread round-robin across the deques.
+             */
+            void submit(TaskGroup& group, std::function<void()> task);
+
+            /**
+             * @brief Blocks until every task of `group` has finished, running queued tasks meanwhile.
+             * @throws The first exception thrown by a task in the group.
+             */
+            void wait(TaskGroup& group);
+
+            /**
+             * @brief Runs `fn(begin, end)` over `[0, count)` split into tasks of `grain` items.
+             *
+             * @tparam Function Callable taking `(size_t begin, size_t end)`.
+             * @param count Number of items.
+             * @param fn Function called once per task.
+             * @param grain Items per task, 0 picks a grain giving every worker several tasks.
+             */
+            template<typename Function>
+            void parallel_for(size_t count, Function fn, size_t grain = 0) {
+                if (count == 0)
+                    return;
+
+                if (grain == 0)
+                    grain = default_grain(count);
+
+                TaskGroup group;
+                size_t number_of_tasks = (count + grain - 1) / grain;
+                for (size_t task = 0; task < number_of_tasks; task++) {
+                    size_t begin = task * grain;
+                    size_t end = begin + grain < count ? begin + grain : count;
+                    auto run = [this, &fn, begin, end]() {
+                        auto start = std::chrono::steady_clock::now();
+                        fn(begin, end);
+                        record_task(end - begin, start);
+                    };
+
+                    // pinned over several nodes, each node queues its own share of the range
+                    if (num_nodes() > 1)
+                        submit_to(queue_of_task(task, number_of_tasks), group, std::move(run));
+                    else
+                        submit(group, std::move(run));
+                }
+
+                wait(group);
+            }
+
+            /**
+             * @brief Returns a grain that splits `count` items into roughly 8 tasks per worker.
+             */
+            size_t default_grain(size_t count) const;
+
+        private:
+
+            /**
+             * @struct WorkerQueue
+             * @brief Deque of tasks owned by one worker.
+             */
+            struct WorkerQueue {
+                std::mutex queue_mtx;
+                std::deque<std::function<void()>> tasks;
+                std::deque<std::function<void()>> own_tasks; ///< Only run by the queue's worker, never stolen.
+                std::atomic<size_t> own_pending{0};          ///< Own tasks queued but not yet started.
+            };
+
+            /**
+             * @struct WorkerStats
+             * @brief `parallel_for()` counters of one worker.
+             */
+            struct alignas(64) WorkerStats {
+                std::atomic<uint64_t> items{0};
+                std::atomic<uint64_t> tasks{0};
+                std::atomic<uint64_t> busy_ns{0};
+            };
+
+            std::vector<std::unique_ptr<WorkerQueue>> queues; ///< One queue per worker (at least one).
+            std::vector<std::vector<unsigned>> steal_order;   ///< Queues every queue's worker steals from, own node first.
+            std::vector<unsigned> worker_cpus;                ///< CPU of every worker, empty when unpinned.
+            std::vector<unsigned> worker_nodes;               ///< Pool node of every worker.
+            std::vector<int> node_ids;                        ///< Kernel's number of every pool node.
+            std::vector<std::vector<unsigned>> node_workers;  ///< Workers of every pool node.
+            std::unique_ptr<WorkerStats[]> worker_stats;      ///< One per worker, then one for threads outside the pool.
+            std::vector<std::thread> workers;                 ///< Worker threads.
+            std::atomic<bool> stopping{false};                ///< Set by the destructor.
+            std::atomic<size_t> pending{0};                   ///< Stealable tasks queued but not yet started.
+            std::atomic<unsigned> next_queue{0};              ///< Round-robin cursor for outside submissions.
+            std::mutex sleep_mtx;                             ///< Guards worker sleep.
+            std::condition_variable sleep_cv;                 ///< Wakes idle workers.
+
+            /** @brief Sets up the queues, nodes and counters, then starts the workers. */
+            void start(unsigned num_workers, const numa::Topology * topology);
+
+            /**
+             * @brief Pops a task from queue `home` or steals one from another queue and runs it.
+             * @param owner Whether the caller is the worker of `home`, the only one running its own tasks.
+             * @return True if a task was run.
+             */
+            bool try_run_one(unsigned home, bool owner);
+
+            /** @brief Queues a task on queue `queue` as part of `group`, stealable unless `own`. */
+            void submit_to(unsigned queue, TaskGroup& group, std::function<void()> task, bool own = false);
+
+            /** @brief Returns the first of `number_of_tasks` tasks that goes to pool node `node`. */
+            size_t first_task_of_node(unsigned node, size_t number_of_tasks) const;
+
+            /** @brief Returns the queue of task `task` of a node-partitioned `parallel_for()`. */
+            unsigned queue_of_task(size_t task, size_t number_of_tasks) const;
+
+            /** @brief Adds a finished `parallel_for()` task to the calling thread's counters. */
+            void record_task(size_t items, std::chrono::steady_clock::time_point start);
+
+            /** @brief Main loop of worker `index`. */
+            void worker_loop(unsigned index);
+    };
+
+    /**
+     * @brief Returns the number of workers to start for a requested thread count.
+     *
+     * @details The calling thread runs tasks while it waits, so it is one of the threads and
+     * gets no worker. Requests above `NUMBER_OF_THREADS_MAX` only add oversubscription, since
+     * the work is split into tasks rather than per-thread chunks, so they are capped.
+     *
+     * @param num_threads Requested threads including the caller, -1 for `NUMBER_OF_THREADS_MAX`.
+     * @return Number of worker threads, 0 when a single thread is requested.
+     */
+    inline unsigned workers_for(int num_threads) {
+        unsigned hardware_threads = std::max(1u, NUMBER_OF_THREADS_MAX);
+        unsigned threads = num_threads < 0 ? hardware_threads : std::max(1u, std::min(static_cast<unsigned>(num_threads), hardware_threads));
+
+        return threads - 1;
+    }
+
+    /**
+     * @class NodeReplicas
+     * @brief One copy of a read-only array per node of a pool, each first touched by a worker of its node.
+     *
+     * @details Tasks read `local()`, the copy on their own node. Pools with a single node keep no
+     * copy and `local()` returns the source, which must outlive the replicas.
+     *
+     * @tparam T Element type, trivially copyable.
+     */
+    template<typename T>
+    class NodeReplicas {
+
+        public:
+
+            NodeReplicas(const T * values, size_t size, ThreadPool& thread_pool) : source{values}, pool{&thread_pool} {
+                if (thread_pool.num_nodes() < 2)
+                    return;
+
+                copies.resize(thread_pool.num_nodes());
+                thread_pool.run_on_nodes([this, values, size](unsigned node) {
+                    copies[node].assign(values, values + size);
+                });
+            }
+
+            /** @brief Returns the copy on the calling thread's node. */
+            const T * local() const {
+                return copies.empty() ? source : copies[pool->current_node()].data();
+            }
+
+            /** @brief Returns the copy on pool node `node`. */
+            const T * of_node(unsigned node) const {
+                return copies.empty() ? source : copies[node].data();
+            }
+
+        private:
+
+            const T * source;
+            const ThreadPool * pool;
+            std::vector<std::vector<T>> copies; ///< One per pool node, empty on a single node.
+    };
+
+} // namespace tpool
+
+#endif // _THREAD_POOL_HPP
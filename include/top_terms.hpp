@@ -0,0 +1,118 @@
+/**
+ * @file top_terms.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Top-k term extraction with bounded min-heaps, for the most important terms of
+ *        documents and categories.
+ *
+ * @details A `BoundedHeap` keeps the k best terms seen so far with the worst of them on top,
+ * so a term that does not beat it is rejected in O(1) and one that does replaces it in
+ * O(log k). Extracting the top k of n terms is O(n log k), and heaps filled by different
+ * threads are combined with `BoundedHeap::merge()`.
+ *
+ * Terms are ranked by descending TF-IDF, ties by ascending term ID, so results do not depend
+ * on hash map iteration order.
+ */
+
+#ifndef _TOP_TERMS_HPP
+#define _TOP_TERMS_HPP
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vocabulary.hpp"
+
+namespace corpus {
+    class Corpus; // forward declaration
+}
+
+namespace tpool {
+    class ThreadPool; // forward declaration
+}
+
+
+/**
+ * @namespace topk
+ * @brief Provides bounded top-k selection of scored terms.
+ */
+namespace topk {
+
+    using scored_term = std::pair<vocab::term_id, double>; ///< A term and its TF-IDF.
+
+    /** @brief Number of important terms kept per document and per category unless configured. */
+    constexpr size_t DEFAULT_IMPORTANT_TERMS{5};
+
+    /**
+     * @brief Returns true if `a` ranks before `b`: higher score, then lower term ID.
+     */
+    inline bool ranks_before(const scored_term& a, const scored_term& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    }
+
+    /**
+     * @class BoundedHeap
+     * @brief Keeps the `capacity()` best distinct scored terms pushed into it.
+     */
+    class BoundedHeap {
+
+        public:
+
+            /**
+             * @brief Creates an empty heap.
+             * @param k Number of terms kept, 0 keeps none.
+             */
+            explicit BoundedHeap(size_t k = DEFAULT_IMPORTANT_TERMS) : k{k} {
+                heap.reserve(k);
+            }
+
+            /**
+             * @brief Offers a term, O(log k) if kept, O(1) otherwise.
+             * @details A term equal to a kept one (same ID and score) is kept once.
+             */
+            void push(const scored_term& term);
+
+            /** @brief Offers every term of `other`, whose capacity may differ. */
+            void merge(const BoundedHeap& other);
+
+            /** @brief Returns the kept terms, best first. */
+            std::vector<scored_term> sorted() const;
+
+            /** @brief Returns the number of kept terms. */
+            size_t size() const {
+                return heap.size();
+            }
+
+            /** @brief Returns the number of terms the heap keeps at most. */
+            size_t capacity() const {
+                return k;
+            }
+
+        private:
+
+            size_t k;                       ///< Terms kept at most.
+            std::vector<scored_term> heap;  ///< Min-heap by rank, the worst kept term first.
+    };
+
+    /**
+     * @brief Extracts the top `k` terms of one document, O(n log k).
+     *
+     * @param tf_idf The TF-IDF terms of the document.
+     * @param k Number of terms returned at most.
+     * @param top Receives the terms, best first, cleared first.
+     */
+    extern void top_terms(const vocab::term_map<double>& tf_idf, size_t k, std::vector<scored_term>& top);
+
+    /**
+     * @brief Extracts the top `k` terms of every document of a corpus, in parallel.
+     *
+     * @param corpus A corpus whose TF-IDF has been calculated.
+     * @param k Number of terms returned per document at most.
+     * @param thread_pool The pool documents are split over.
+     * @return The top terms of every document, in corpus order, best first.
+     */
+    extern std::vector<std::vector<scored_term>> document_top_terms(const corpus::Corpus& corpus, size_t k, tpool::ThreadPool& thread_pool);
+
+} // namespace topk
+
+#endif // _TOP_TERMS_HPP
@@ -0,0 +1,139 @@
+/**
+ * @file trained_model.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Versioned binary model files, so a classifier can start without retraining.
+ *
+ * @details A model file holds everything classification needs: the vocabulary (term IDs are
+ * positions in it), the training IDF table, every category's type and centroid norm, and the
+ * term-major, pre-normalized centroid matrix of `cats::CentroidMatrix`. Column `c` times
+ * `norm(c)` gives back the centroid of category `c`.
+ *
+ * Layout, every section 8-byte aligned and in host byte order:
+ * | section            | contents                                              |
+ * |--------------------|-------------------------------------------------------|
+ * | header             | magic, version, byte order mark, counts, offsets      |
+ * | vocabulary         | `num_terms + 1` uint64 string offsets, then the bytes |
+ * | IDF                | `num_terms` doubles                                   |
+ * | categories         | `num_categories + 1` uint64 string offsets, bytes     |
+ * | norms              | `num_categories` doubles                              |
+ * | centroid matrix    | `num_matrix_terms * num_categories` doubles           |
+ *
+ * Loading maps the file and validates the header and section bounds; the IDF table and the
+ * centroid matrix are then used in place, only the vocabulary is interned. A file with
+ * another version or byte order is rejected rather than misread.
+ */
+
+#ifndef _TRAINED_MODEL_HPP
+#define _TRAINED_MODEL_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "batch_classifier.hpp"
+#include "document.hpp"
+#include "mapped_file.hpp"
+#include "vocabulary.hpp"
+
+
+/**
+ * @namespace model
+ * @brief Provides saving and loading of trained classification models.
+ */
+namespace model {
+
+    inline constexpr char MODEL_MAGIC[8]{'T', 'F', 'I', 'D', 'F', 'M', 'D', 'L'}; ///< First bytes of every model file.
+    inline constexpr uint32_t MODEL_VERSION{1};                                      ///< Bumped on any layout change.
+    inline constexpr uint32_t BYTE_ORDER_MARK{0x01020304};                           ///< Reads differently on the other endianness.
+
+    /**
+     * @struct ModelHeader
+     * @brief Fixed-size header at offset 0 of a model file, offsets are from the start of the file.
+     */
+    struct ModelHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t num_terms;         ///< Vocabulary size, also the length of the IDF table.
+        uint64_t num_categories;
+        uint64_t num_matrix_terms;  ///< Rows of the centroid matrix, at most `num_terms`.
+        uint64_t vocabulary_offset;
+        uint64_t idf_offset;
+        uint64_t categories_offset;
+        uint64_t norms_offset;
+        uint64_t matrix_offset;
+        uint64_t file_size;
+    };
+
+    /**
+     * @class TrainedModel
+     * @brief A model file mapped read-only, its tables are views into the mapping.
+     */
+    class TrainedModel {
+
+        public:
+
+            /**
+             * @brief Maps and validates a model file.
+             * @param file_name The model file.
+             * @throws std::runtime_error if the file cannot be mapped, has another version or byte order, or is truncated.
+             */
+            static std::shared_ptr<const TrainedModel> load(const std::string& file_name);
+
+            /** @brief Returns the number of vocabulary terms. */
+            size_t num_terms() const {
+                return header->num_terms;
+            }
+
+            /** @brief Returns term `id` of the saved vocabulary. */
+            std::string_view term(vocab::term_id id) const;
+
+            /** @brief Returns the training IDF of every term, `num_terms()` values. */
+            const double * inverse_document_frequency() const {
+                return idf;
+            }
+
+            /** @brief Returns the centroid matrix, its weights stay in the mapping. */
+            const std::shared_ptr<const cats::CentroidMatrix>& centroids() const {
+                return centroid_matrix;
+            }
+
+            /**
+             * @brief Interns the saved vocabulary so every term gets its saved ID.
+             *
+             * @details Terms already interned must sit at the same IDs, which always holds for
+             * an empty vocabulary or the one the model was saved from.
+             *
+             * @param vocabulary The vocabulary to fill, usually `vocab::vocabulary`.
+             * @throws std::runtime_error if a term would get another ID.
+             */
+            void register_vocabulary(vocab::Vocabulary& vocabulary) const;
+
+        private:
+
+            std::shared_ptr<const io::MappedFile> file;                ///< Owns the mapping.
+            const ModelHeader * header{nullptr};                       ///< Start of the mapping.
+            const uint64_t * vocabulary_offsets{nullptr};              ///< `num_terms + 1` string offsets.
+            const char * vocabulary_bytes{nullptr};                    ///< Concatenated terms.
+            const double * idf{nullptr};                               ///< `num_terms` IDF values.
+            std::shared_ptr<const cats::CentroidMatrix> centroid_matrix; ///< Weights point into `file`.
+    };
+
+    /**
+     * @brief Writes a model file.
+     *
+     * @param file_name The model file, overwritten.
+     * @param vocabulary The vocabulary the IDF and centroids are indexed by.
+     * @param inverse_document_frequency Training IDF, terms past its end are saved with 0.
+     * @param centroids The trained centroid matrix.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    extern void save_model(const std::string& file_name, const vocab::Vocabulary& vocabulary,
+                           const corpus::IdfTable& inverse_document_frequency, const cats::CentroidMatrix& centroids);
+
+} // namespace model
+
+#endif // _TRAINED_MODEL_HPP
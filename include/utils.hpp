@@ -113,14 +113,11 @@ using _time_point_ = std::chrono::_V2::system_clock::time_point;
  * 
  * @param start The start time.
  * @param end The end time.
- * @return Elapsed time in milliseconds.
+ * @return Elapsed time in milliseconds, fractional down to the clock's resolution.
  */
 inline double elapsed_time_ms(_time_point_ start, _time_point_ end) {
-    return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+    return std::chrono::duration<double, std::milli>(end - start).count();
 }
-// inline double elapsed_time_ms(std::chrono::_V2::system_clock::time_point start, std::chrono::_V2::system_clock::time_point end) {
-//     return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
-// }
 
 /**
  * @brief Prints elapsed time in milliseconds.
@@ -0,0 +1,95 @@
+/**
+ * @file vocabulary.hpp
+ * @ingroup HeaderFiles
+ *
+ * @author Andrew Kelton
+ * @brief Defines the Vocabulary class, which interns stemmed terms as dense integer IDs.
+ *
+ * @details Every stemmed term is mapped to a dense `vocab::term_id` the first time it is seen.
+ * Documents, the Corpus, and Categories store their vectors keyed by these IDs instead of
+ * `std::string`, so the hot loops hash and compare integers. Strings are only rebuilt from
+ * the vocabulary when writing human readable output.
+ *
+ * A single vocabulary, `vocab::vocabulary`, is shared by the trained and untrained corpora
+ * so the same term always has the same ID on both sides of classification.
+ */
+
+#ifndef _VOCABULARY_HPP
+#define _VOCABULARY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory_resource>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+
+/**
+ * @namespace vocab
+ * @brief Provides the shared term dictionary used to intern terms as integer IDs.
+ */
+namespace vocab {
+
+    using term_id = uint32_t; ///< Dense identifier of an interned term.
+
+    /** @brief Returned by `Vocabulary::find()` when a term was never interned. */
+    inline constexpr term_id UNKNOWN_TERM{std::numeric_limits<term_id>::max()};
+
+    /** @brief Per-document map keyed by term ID, allocated from the owning corpus's resource (see `arena::ThreadArenas`). */
+    template <typename T>
+    using term_map = std::pmr::unordered_map<term_id, T>;
+
+    /**
+     * @class Vocabulary
+     * @brief Thread-safe bidirectional mapping between terms and dense IDs.
+     *
+     * @details IDs are assigned in order of first appearance starting at 0, so they can be
+     * used directly as indices into dense arrays of size `size()`. Lookups take a shared
+     * lock and only the insertion of a new term takes the exclusive lock.
+     */
+    class Vocabulary {
+
+        public:
+
+            /**
+             * @brief Returns the ID of a term, interning it if it is new.
+             * @param term The stemmed term.
+             * @return The ID of the term.
+             */
+            term_id intern(const std::string& term);
+
+            /**
+             * @brief Returns the ID of a term without interning it.
+             * @param term The stemmed term.
+             * @return The ID of the term, or `UNKNOWN_TERM` if it was never interned.
+             */
+            term_id find(const std::string& term) const;
+
+            /**
+             * @brief Returns the term string for an ID.
+             * @param id A previously interned ID.
+             * @return Reference to the term, stays valid until `clear()`.
+             * @throws std::out_of_range if the ID was never assigned.
+             */
+            const std::string& term(term_id id) const;
+
+            /** @brief Returns the number of interned terms. */
+            size_t size() const;
+
+            /** @brief Removes every term, invalidates all previously returned IDs. */
+            void clear();
+
+        private:
+
+            mutable std::shared_mutex vocab_mtx;          ///< Guards `ids` and `terms`.
+            std::unordered_map<std::string, term_id> ids; ///< Term to ID.
+            std::deque<std::string> terms;                ///< ID to term, deque keeps references stable.
+    };
+
+    extern Vocabulary vocabulary; ///< Vocabulary shared by every corpus and category.
+
+} // namespace vocab
+
+#endif // _VOCABULARY_HPP
@@ -1,12 +1,6 @@
 # !/bin/bash
 
-make 4-test
-make 8-test
-make 16-test
-make 32-test
-make 64-test
-make 128-test
-make 256-test
-make 512-test
-make 1024-test
-
+# Strong and weak scaling of every stage, measured in one process
+# report: tests/output/results/scaling-<dataset>.csv
+make test
+./test scaling 2 --threads=1,2,4,8,16,32,64 --repetitions=5
@@ -1,33 +1,49 @@
 #include "TFIDF.hpp"
 
+/* profiler sites of the sections, sub-stages are timed under these paths */
+static const prof::Site& section_site(section_type_ type) {
+    static const prof::Site sites[4]{
+        prof::Site{"vectorization"}, prof::Site{"tfidf"}, prof::Site{"categories"}, prof::Site{"classification"}
+    };
+    return sites[type];
+}
+
+void TFIDF::TFIDF_::start_section(section_type_ type) {
+    thread_pool->reset_node_stats();
+    timer.start(section_site(type));
+}
+
+void TFIDF::TFIDF_::end_section(section_type_ type) {
+    section_durations[type] = timer.stop();
+    section_node_stats[type] = thread_pool->node_stats();
+    if (task_settings.output_performance)
+        print_duration_code(section_durations[type], type);
+}
+
 void TFIDF::TFIDF_::process_training_data() {
 
+    if (task_settings.use_streaming) {
+        process_training_data_streaming();
+        return;
+    }
+
     /* Read in trained data from CSV file */
     try {
-        read_csv_to_corpus(std::ref(trained_corpus), input_files.trained_input_file);
+        read_csv_to_corpus(std::ref(trained_corpus), input_files.trained_input_file, *thread_pool);
     } catch (std::runtime_error e) {
         handle_err("Error reading: " + input_files.trained_input_file + " " + std::string(e.what()));
         return;
     }
 
     /* -- Vectorize Documents Section -- */
-    timer.start_timer();
+    start_section(vectorization_);
 
     if (task_settings.is_parallel) {
-        if (task_settings.num_threads == -1) {
-            try {
-                vectorize_corpus_threaded(&trained_corpus);
-            } catch (std::exception e) {
-                handle_err("Error in vectorize_corpus_parallel: " + std::string(e.what()));
-                return;
-            }
-        } else {
-            try {
-                vectorize_corpus_threaded(&trained_corpus, task_settings.num_threads);
-            } catch (std::exception e) {
-                handle_err("Error in vectorize_corpus_parallel: " + std::string(e.what()));
-                return;
-            }
+        try {
+            vectorize_corpus_threaded(&trained_corpus, *thread_pool);
+        } catch (std::exception e) {
+            handle_err("Error in vectorize_corpus_parallel: " + std::string(e.what()));
+            return;
         }
     } else {
         try {
@@ -38,30 +54,60 @@ void TFIDF::TFIDF_::process_training_data() {
         }
     }
 
-    timer.end_timer();
-    if (task_settings.output_performance)
-        print_duration_code(timer.duration, vectorization_);
+    end_section(vectorization_);
+    /* -- Vectorize Documents Section END -- */
+
+
+    process_training_tfidf_and_categories();
+}
+
+void TFIDF::TFIDF_::process_training_data_streaming() {
+
+    /* -- Vectorize Documents Section -- */
+    start_section(vectorization_);
+
+    try {
+        trained_frozen_corpus = std::make_unique<corpus::FrozenCorpus>(
+            stream::stream_corpus(input_files.trained_input_file, stream::InputFormat::csv, *thread_pool));
+    } catch (std::exception &e) {
+        handle_err("Error in stream_corpus: " + input_files.trained_input_file + " " + std::string(e.what()));
+        return;
+    }
+
+    end_section(vectorization_);
     /* -- Vectorize Documents Section END -- */
 
+    process_training_tfidf_and_categories();
+}
+
+void TFIDF::TFIDF_::process_training_tfidf_and_categories() {
 
     /* -- Calculate TF-IDF Section -- */
-    timer.start_timer();
+    start_section(tfidf_);
 
-    if (task_settings.is_parallel) {
-        if (task_settings.num_threads == -1) {
-            try {
-                trained_corpus.tfidf_documents();
-            } catch (std::exception &e) {
-                handle_err("Error in tfidf_documents: " + std::string(e.what()));
-                return;
-            }
-        } else {
-            try {
-                trained_corpus.tfidf_documents(task_settings.num_threads);
-            } catch (std::exception &e) {
-                handle_err("Error in tfidf_documents: " + std::string(e.what()));
-                return;
-            }
+    if (task_settings.use_streaming) {
+        try {
+            incremental_model.add_documents(*trained_frozen_corpus, *thread_pool); // rows still hold term frequencies
+            trained_frozen_corpus->apply_inverse_document_frequency(*thread_pool); // frequencies counted while streaming
+        } catch (std::exception &e) {
+            handle_err("Error in FrozenCorpus::apply_inverse_document_frequency: " + std::string(e.what()));
+            return;
+        }
+    } else if (task_settings.use_csr) {
+        try {
+            trained_frozen_corpus = std::make_unique<corpus::FrozenCorpus>(trained_corpus, *thread_pool);
+            incremental_model.add_documents(*trained_frozen_corpus, *thread_pool);
+            trained_frozen_corpus->tfidf_documents(*thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in FrozenCorpus::tfidf_documents: " + std::string(e.what()));
+            return;
+        }
+    } else if (task_settings.is_parallel) {
+        try {
+            trained_corpus.tfidf_documents(*thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in tfidf_documents: " + std::string(e.what()));
+            return;
         }
     } else {
         try {
@@ -72,97 +118,79 @@ void TFIDF::TFIDF_::process_training_data() {
         }
     }
     
-    timer.end_timer();
-    if (task_settings.output_performance)
-        print_duration_code(timer.duration, tfidf_);
+    end_section(tfidf_);
     /* -- Calculate TF-IDF Section END -- */
 
 
     /* -- Category Section -- */
-    timer.start_timer();
+    start_section(categories_);
 
-    if (task_settings.is_parallel) {
+    if (task_settings.use_csr) {
+        try {
+            trained_centroids = cats::csr::get_all_centroids_csr(*trained_frozen_corpus, *thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in get_all_centroids_csr: " + std::string(e.what()));
+            return;
+        }
+    } else if (task_settings.is_parallel) {
         try {
-            trained_cat_vect = cats::par::get_all_cat_par(trained_corpus);
+            trained_cat_vect = cats::par::get_all_cat_par(trained_corpus, *thread_pool, task_settings.num_important_terms);
         } catch (std::exception &e) {
             handle_err("Error in get_all_cat_par: " + std::string(e.what()));
             return;
         }
     } else {
         try {
-            trained_cat_vect = cats::seq::get_all_cat_seq(trained_corpus);
+            trained_cat_vect = cats::seq::get_all_cat_seq(trained_corpus, task_settings.num_important_terms);
         } catch (std::exception &e) {
             handle_err("Error in get_all_cat_seq: " + std::string(e.what()));
             return;
         }
     }
 
-    timer.end_timer();
-    if (task_settings.output_performance)
-        print_duration_code(timer.duration, categories_);
+    /* freeze the categories for batch and online classification */
+    try {
+        trained_centroid_matrix = task_settings.use_csr ? cats::CentroidMatrix::from_centroids(trained_centroids)
+                                                        : cats::CentroidMatrix::from_categories(trained_cat_vect);
+        build_online_classifier();
+    } catch (std::exception &e) {
+        handle_err("Error in CentroidMatrix: " + std::string(e.what()));
+        return;
+    }
+
+    end_section(categories_);
     /* -- Category Section END -- */
 }
 
 void TFIDF::TFIDF_::process_testing_data() {
 
-    /* Read in the untrained/unknown text */
-    try {
-        read_unknown_text(std::ref(un_trained_corpus), input_files.un_trained_input_file);
-    } catch (std::runtime_error &e) {
-        handle_err("Error in read_unknown_text: " + std::string(e.what()));
-        return;
-    }
-
-    timer.start_timer();
+    if (task_settings.use_streaming) {
+        start_section(unknown_);
 
-    if (task_settings.is_parallel) {
-        if (task_settings.num_threads == -1) {
-            try {
-                vectorize_corpus_threaded(&un_trained_corpus);
-            } catch (std::exception &e) {
-                handle_err("Error in vectorize_corpus_threaded: " + std::string(e.what()));
-                return;
-            }
-        } else {
-            try {
-                vectorize_corpus_threaded(&un_trained_corpus, task_settings.num_threads);
-            } catch (std::exception &e) {
-                handle_err("Error in vectorize_corpus_threaded: " + std::string(e.what()));
-                return;
-            }
-        }
-    } else {
         try {
-            vectorize_corpus_sequential(&un_trained_corpus); // sequential vectorization
+            un_trained_frozen_corpus = std::make_unique<corpus::FrozenCorpus>(
+                stream::stream_corpus(input_files.un_trained_input_file, stream::InputFormat::lines, *thread_pool));
+            if (task_settings.use_training_idf)
+                un_trained_frozen_corpus->apply_inverse_document_frequency(training_idf(), *thread_pool);
+            else
+                un_trained_frozen_corpus->apply_inverse_document_frequency(*thread_pool);
         } catch (std::exception &e) {
-            handle_err("Error in vectorize_corpus_sequential: " + std::string(e.what()));
+            handle_err("Error in stream_corpus: " + std::string(e.what()));
             return;
         }
-    }
-
-    if (task_settings.is_parallel) {
-        if (task_settings.num_threads == -1) {
-            try {
-                un_trained_corpus.tfidf_documents();
-            } catch (std::exception &e) {
-                handle_err("Error in tfidf_documents: " + std::string(e.what()));
-                return;
-            }
-        } else {
-            try {
-                un_trained_corpus.tfidf_documents(task_settings.num_threads);
-            } catch (std::exception &e) {
-                handle_err("Error in tfidf_documents: " + std::string(e.what()));
-                return;
-            }
-        }
     } else {
+        /* Read in the untrained/unknown text */
         try {
-            un_trained_corpus.tfidf_documents_seq();
-        } catch (std::exception &e) {
-            handle_err("Error in tfidf_documents: " + std::string(e.what()));
+            read_unknown_text(std::ref(un_trained_corpus), input_files.un_trained_input_file, *thread_pool);
+        } catch (std::runtime_error &e) {
+            handle_err("Error in read_unknown_text: " + std::string(e.what()));
             return;
         }
+
+        start_section(unknown_);
+
+        if (!process_testing_corpus())
+            return;
     }
 
     if (task_settings.classify_unknown) {
@@ -173,52 +201,219 @@ void TFIDF::TFIDF_::process_testing_data() {
             return;
         }
 
-        if (task_settings.is_parallel) {
-            try {
-                cats::par::init_classification_par(std::ref(un_trained_corpus), std::ref(trained_cat_vect), un_trained_cats_correct);
-            } catch (std::exception &e) {
-                handle_err("Error in init_classification_par: " + std::string(e.what()));
-                return;
-            }
-        } else {
-            try {
-                cats::seq::init_classification_seq(std::ref(un_trained_corpus), trained_cat_vect, std::ref(un_trained_cats_correct));
-            } catch (std::exception &e) {
-                handle_err("Error in init_classification_par: " + std::string(e.what()));
-                return;
-            }
+        if (!trained_centroid_matrix) {
+            handle_err("Error in classification: no trained categories");
+            return;
         }
 
-        timer.end_timer();
+        /* score blocks of documents against every category at once, 
+         * the pool has no workers when running sequentially 
+         */
+        try {
+            cats::BatchClassifier classifier{trained_centroid_matrix};
+            cats::BatchScores scores = task_settings.use_csr ? classifier.classify(*un_trained_frozen_corpus, *thread_pool)
+                                                             : classifier.classify(un_trained_corpus, *thread_pool);
+            cats::batch::commit_classifications(scores, *trained_centroid_matrix, un_trained_cats_correct);
+        } catch (std::exception &e) {
+            handle_err("Error in BatchClassifier: " + std::string(e.what()));
+            return;
+        }
 
-        if (task_settings.output_performance)
-            print_duration_code(timer.duration, unknown_);
+        end_section(unknown_);
 
         if (task_settings.output_classification)
             cats::print_classifications();
 
         if (task_settings.convert_output_to_csv) {
             try {
-                convert_results_txt_to_csv(input_files.output_results_file, input_files.processed_data_csv_file);
+                write_processed_csv(input_files.processed_data_csv_file, section_durations, cats::u_classified.correct_db);
             } catch (std::runtime_error &e) {
                 std::cerr << "Error writing to CSV" << std::endl;
-                handle_err("Error in convert_results_txt_to_csv: " + std::string(e.what()));
+                handle_err("Error in write_processed_csv: " + std::string(e.what()));
                 return;
             }
         }
 
     } else {
-        timer.end_timer();
-        if (task_settings.output_performance)
-            print_duration_code(timer.duration, unknown_);
+        end_section(unknown_);
     }
 }   
 
+bool TFIDF::TFIDF_::process_testing_corpus() {
+    if (task_settings.is_parallel) {
+        try {
+            vectorize_corpus_threaded(&un_trained_corpus, *thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in vectorize_corpus_threaded: " + std::string(e.what()));
+            return false;
+        }
+    } else {
+        try {
+            vectorize_corpus_sequential(&un_trained_corpus); // sequential vectorization
+        } catch (std::exception &e) {
+            handle_err("Error in vectorize_corpus_sequential: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    if (task_settings.use_csr && task_settings.use_training_idf) {
+        try {
+            un_trained_frozen_corpus = std::make_unique<corpus::FrozenCorpus>(un_trained_corpus, *thread_pool);
+            un_trained_frozen_corpus->apply_inverse_document_frequency(training_idf(), *thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in FrozenCorpus::apply_inverse_document_frequency: " + std::string(e.what()));
+            return false;
+        }
+    } else if (task_settings.use_csr) {
+        try {
+            un_trained_frozen_corpus = std::make_unique<corpus::FrozenCorpus>(un_trained_corpus, *thread_pool);
+            un_trained_frozen_corpus->tfidf_documents(*thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in FrozenCorpus::tfidf_documents: " + std::string(e.what()));
+            return false;
+        }
+    } else if (task_settings.use_training_idf) {
+        try {
+            un_trained_corpus.tfidf_documents(training_idf(), *thread_pool); // no workers when sequential
+        } catch (std::exception &e) {
+            handle_err("Error in tfidf_documents: " + std::string(e.what()));
+            return false;
+        }
+    } else if (task_settings.is_parallel) {
+        try {
+            un_trained_corpus.tfidf_documents(*thread_pool);
+        } catch (std::exception &e) {
+            handle_err("Error in tfidf_documents: " + std::string(e.what()));
+            return false;
+        }
+    } else {
+        try {
+            un_trained_corpus.tfidf_documents_seq();
+        } catch (std::exception &e) {
+            handle_err("Error in tfidf_documents: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void TFIDF::TFIDF_::process_all_data() {
     process_training_data();
     process_testing_data();
 }
 
+bool TFIDF::TFIDF_::add_training_data(const std::string& csv_file) {
+    if (!task_settings.use_csr) {
+        handle_err("Error in add_training_data: requires use_csr");
+        return false;
+    }
+    if (incremental_model.num_docs() == 0) {
+        handle_err("Error in add_training_data: no trained data");
+        return false;
+    }
+
+    /* its own site, the training sections keep their durations and node stats */
+    static const prof::Site add_training_site{"add-training-data"};
+    prof::ScopedTimer add_training_timer{add_training_site};
+
+    try {
+        corpus::Corpus batch;
+        read_csv_to_corpus(batch, csv_file, *thread_pool);
+        if (task_settings.is_parallel)
+            vectorize_corpus_threaded(&batch, *thread_pool);
+        else
+            vectorize_corpus_sequential(&batch);
+
+        incremental_model.add_documents(corpus::FrozenCorpus{batch, *thread_pool}, *thread_pool);
+    } catch (std::exception &e) {
+        handle_err("Error in add_training_data: " + csv_file + " " + std::string(e.what()));
+        return false;
+    }
+
+    /* centroids only depend on the model's statistics, not on the number of documents */
+    try {
+        trained_centroids = incremental_model.centroids(*thread_pool);
+        trained_centroid_matrix = cats::CentroidMatrix::from_centroids(trained_centroids);
+        build_online_classifier();
+    } catch (std::exception &e) {
+        handle_err("Error in IncrementalModel::centroids: " + std::string(e.what()));
+        return false;
+    }
+
+    return true;
+}
+
+bool TFIDF::TFIDF_::save_model(const std::string& model_file) {
+    if (!trained_centroid_matrix) {
+        handle_err("Error in save_model: no trained categories");
+        return false;
+    }
+
+    try {
+        model::save_model(model_file, vocab::vocabulary, training_idf(), *trained_centroid_matrix);
+    } catch (std::exception &e) {
+        handle_err("Error in save_model: " + std::string(e.what()));
+        return false;
+    }
+
+    return true;
+}
+
+bool TFIDF::TFIDF_::load_model(const std::string& model_file) {
+    try {
+        std::shared_ptr<const model::TrainedModel> loaded = model::TrainedModel::load(model_file);
+        loaded->register_vocabulary(vocab::vocabulary);
+        trained_model = std::move(loaded);
+        trained_centroid_matrix = trained_model->centroids();
+        build_online_classifier();
+    } catch (std::exception &e) {
+        handle_err("Error in load_model: " + std::string(e.what()));
+        return false;
+    }
+
+    return true;
+}
+
+cats::Prediction TFIDF::TFIDF_::classify(std::string_view text) const {
+    if (!online_classifier)
+        throw std::runtime_error("classify: no model was trained or loaded");
+
+    return online_classifier->classify(text);
+}
+
+std::unique_ptr<serve::ClassifyServer> TFIDF::TFIDF_::make_server(const serve::ServerSettings& settings) {
+    if (!online_classifier)
+        throw std::runtime_error("make_server: no model was trained or loaded");
+
+    return std::make_unique<serve::ClassifyServer>(online_classifier, *thread_pool, settings);
+}
+
+void TFIDF::TFIDF_::build_online_classifier() {
+    corpus::IdfTable idf = training_idf();
+    std::shared_ptr<const void> idf_owner = trained_model;
+
+    // a trained corpus may be retrained or destroyed, keep a copy
+    if (!trained_model) {
+        auto idf_copy = std::make_shared<const std::vector<double>>(idf.values, idf.values + idf.size);
+        idf = {idf_copy->data(), idf_copy->size()};
+        idf_owner = std::move(idf_copy);
+    }
+
+    online_classifier = std::make_shared<const cats::OnlineClassifier>(trained_centroid_matrix, idf, std::move(idf_owner));
+}
+
+corpus::IdfTable TFIDF::TFIDF_::training_idf() const {
+    if (trained_model)
+        return {trained_model->inverse_document_frequency(), trained_model->num_terms()};
+
+    if (task_settings.use_csr)
+        return incremental_model.idf(); // covers batches added after training
+
+    const std::vector<double>& idf = trained_corpus.inverse_document_frequency;
+    return {idf.data(), idf.size()};
+}
+
 void TFIDF::TFIDF_::handle_err(std::string to_cerr) {
     if (task_settings.is_base_lvl_logging) 
         std::cerr << to_cerr << std::endl;
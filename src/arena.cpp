@@ -0,0 +1,165 @@
+/* arena.cpp
+ * source file for arena.hpp
+ */
+
+#include "arena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+
+namespace arena {
+
+    static std::atomic<uint64_t> next_instance_id{1};
+
+    /* counters have a single writer at a time, relaxed atomics
+     * let stats() read them while their thread keeps counting
+     */
+    static void add(std::atomic<size_t>& counter, size_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static void subtract(std::atomic<size_t>& counter, size_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+    }
+
+    /* upstream of a thread's arena, counts the blocks it hands out */
+    class BlockCounter : public std::pmr::memory_resource {
+
+        public:
+
+            std::atomic<size_t> reserved{0};
+            std::atomic<size_t> blocks{0};
+
+        private:
+
+            void * do_allocate(size_t bytes, size_t alignment) override {
+                add(reserved, bytes);
+                add(blocks, 1);
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void * p, size_t bytes, size_t alignment) override {
+                subtract(reserved, bytes);
+                subtract(blocks, 1);
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+    };
+
+    /* only written by its own thread, except by release(), stats() only reads */
+    struct ThreadArenas::Slot {
+        BlockCounter upstream;                       // declared first, outlives the arena
+        std::pmr::monotonic_buffer_resource arena;
+        std::thread::id owner;                       // the thread allocating from it
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> deallocations{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<size_t> freed_bytes{0};
+
+        Slot(size_t block_size, std::thread::id owner) : arena{block_size, &upstream}, owner{owner} {}
+    };
+
+    // the few resources a thread allocated from last, checked before the registry
+    static constexpr size_t CACHE_ENTRIES{4};
+    struct CacheEntry {
+        uint64_t instance_id{0};
+        void * slot{nullptr};
+    };
+    static thread_local CacheEntry slot_cache[CACHE_ENTRIES];
+    static thread_local size_t next_cache_entry{0};
+
+    ThreadArenas::ThreadArenas(Mode mode, size_t block_size)
+        : allocation_mode{mode},
+          block_size{block_size},
+          instance_id{next_instance_id.fetch_add(1, std::memory_order_relaxed)}
+    {}
+
+    ThreadArenas::~ThreadArenas() = default;
+
+    ThreadArenas::Slot& ThreadArenas::local_slot() {
+        for (const auto& entry : slot_cache)
+            if (entry.instance_id == instance_id)
+                return *static_cast<Slot *>(entry.slot);
+
+        /* a thread alternating between more resources than the cache
+         * holds finds its slot again, one slot per thread and resource
+         */
+        Slot * slot{nullptr};
+        {
+            std::lock_guard<std::mutex> lock(registry_mtx);
+            std::thread::id self = std::this_thread::get_id();
+            for (const auto& registered : slots)
+                if (registered->owner == self)
+                    slot = registered.get();
+
+            if (slot == nullptr) {
+                slots.push_back(std::make_unique<Slot>(block_size, self));
+                slot = slots.back().get();
+            }
+        }
+
+        slot_cache[next_cache_entry] = {instance_id, slot};
+        next_cache_entry = (next_cache_entry + 1) % CACHE_ENTRIES;
+        return *slot;
+    }
+
+    void * ThreadArenas::do_allocate(size_t bytes, size_t alignment) {
+        Slot& slot = local_slot();
+        add(slot.allocations, 1);
+        add(slot.bytes, bytes);
+
+        if (allocation_mode == Mode::arena)
+            return slot.arena.allocate(bytes, alignment);
+        return ::operator new(bytes, std::align_val_t{alignment});
+    }
+
+    void ThreadArenas::do_deallocate(void * p, size_t bytes, size_t alignment) {
+        Slot& slot = local_slot();
+        add(slot.deallocations, 1);
+        add(slot.freed_bytes, bytes);
+
+        if (allocation_mode == Mode::heap)
+            ::operator delete(p, bytes, std::align_val_t{alignment});
+        // arena memory is only returned by release()
+    }
+
+    bool ThreadArenas::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+
+    AllocatorStats ThreadArenas::stats() const {
+        AllocatorStats stats;
+        size_t freed_bytes{0};
+        std::lock_guard<std::mutex> lock(registry_mtx);
+
+        for (const auto& slot : slots) {
+            stats.allocations += slot->allocations.load(std::memory_order_relaxed);
+            stats.deallocations += slot->deallocations.load(std::memory_order_relaxed);
+            stats.bytes += slot->bytes.load(std::memory_order_relaxed);
+            freed_bytes += slot->freed_bytes.load(std::memory_order_relaxed); // possibly freed by another thread than the allocating one
+            stats.reserved += slot->upstream.reserved.load(std::memory_order_relaxed);
+            stats.blocks += slot->upstream.blocks.load(std::memory_order_relaxed);
+        }
+        stats.threads = slots.size();
+
+        stats.live_bytes = allocation_mode == Mode::arena ? stats.bytes : stats.bytes - std::min(freed_bytes, stats.bytes);
+        return stats;
+    }
+
+    void ThreadArenas::release() {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+
+        for (auto& slot : slots) {
+            slot->arena.release();
+            slot->allocations.store(0, std::memory_order_relaxed);
+            slot->deallocations.store(0, std::memory_order_relaxed);
+            slot->bytes.store(0, std::memory_order_relaxed);
+            slot->freed_bytes.store(0, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace arena
@@ -0,0 +1,231 @@
+/* batch_classifier.cpp
+ * source file for batch_classifier.hpp
+ */
+
+#include "batch_classifier.hpp"
+#include "document.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace cats {
+
+    std::shared_ptr<const CentroidMatrix> CentroidMatrix::from_categories(const std::vector<Category>& cat_vect) {
+        auto matrix = std::make_shared<CentroidMatrix>();
+        size_t number_of_categories = cat_vect.size();
+
+        for (const auto& category : cat_vect) {
+            matrix->category_types.push_back(category.get_type());
+            matrix->category_norms.push_back(category.centroid_norm);
+            if (!category.centroid_term_ids.empty())
+                matrix->num_of_terms = std::max(matrix->num_of_terms, static_cast<size_t>(category.centroid_term_ids.back()) + 1);
+        }
+
+        matrix->weights.assign(matrix->num_of_terms * number_of_categories, 0.0);
+        for (size_t c = 0; c < number_of_categories; c++) {
+            const Category& category = cat_vect[c];
+            if (category.centroid_norm < 1e-9)
+                continue; // never matches, like classify_text
+
+            for (size_t k = 0; k < category.centroid_term_ids.size(); k++)
+                matrix->weights[category.centroid_term_ids[k] * number_of_categories + c] = category.centroid_values[k] / category.centroid_norm;
+        }
+
+        matrix->weight_data = matrix->weights.data();
+        return matrix;
+    }
+
+    std::shared_ptr<const CentroidMatrix> CentroidMatrix::from_centroids(const centroids_s& centroids) {
+        auto matrix = std::make_shared<CentroidMatrix>();
+        size_t number_of_categories = centroids.category_types.size();
+
+        matrix->category_types = centroids.category_types;
+        matrix->category_norms = centroids.norms;
+        for (const auto& weights : centroids.weights)
+            matrix->num_of_terms = std::max(matrix->num_of_terms, weights.size());
+
+        matrix->weights.assign(matrix->num_of_terms * number_of_categories, 0.0);
+        for (size_t c = 0; c < number_of_categories; c++) {
+            if (centroids.norms[c] < 1e-9)
+                continue;
+
+            const std::vector<double>& weights = centroids.weights[c];
+            for (size_t t = 0; t < weights.size(); t++)
+                matrix->weights[t * number_of_categories + c] = weights[t] / centroids.norms[c];
+        }
+
+        matrix->weight_data = matrix->weights.data();
+        return matrix;
+    }
+
+    std::shared_ptr<const CentroidMatrix> CentroidMatrix::from_weights(std::vector<std::string> category_types, std::vector<double> norms, 
+                                                                       const double * weights, size_t num_terms, std::shared_ptr<const void> storage) {
+        auto matrix = std::make_shared<CentroidMatrix>();
+        matrix->category_types = std::move(category_types);
+        matrix->category_norms = std::move(norms);
+        matrix->storage = std::move(storage);
+        matrix->weight_data = weights;
+        matrix->num_of_terms = num_terms;
+
+        return matrix;
+    }
+
+    BatchClassifier::BatchClassifier(std::shared_ptr<const CentroidMatrix> centroids, size_t top_k)
+        : centroid_matrix{std::move(centroids)},
+          top_k{std::max<size_t>(1, top_k)} {}
+
+    size_t BatchClassifier::select_top_k(const double * dot_products, double doc_norm, ScoredLabel * labels) const {
+        if (doc_norm < 1e-9)
+            return 0; // avoids division by zero
+
+        // insertion into a k-slot list, ties keep the earlier category like classify_text
+        size_t count{0};
+        for (size_t c = 0; c < centroid_matrix->num_categories(); c++) {
+            double similarity = dot_products[c] / doc_norm;
+            if (similarity <= 0.0)
+                continue;
+
+            size_t slot = count;
+            while (slot > 0 && labels[slot - 1].score < similarity) {
+                if (slot < top_k)
+                    labels[slot] = labels[slot - 1];
+                slot--;
+            }
+
+            if (slot < top_k) {
+                labels[slot] = {c, similarity};
+                count = std::min(count + 1, top_k);
+            }
+        }
+
+        return count;
+    }
+
+    size_t BatchClassifier::score(const vocab::term_map<double>& tf_idf, ScoredLabel * labels) const {
+        size_t number_of_categories = centroid_matrix->num_categories();
+        static thread_local std::vector<double> dot_products;
+        dot_products.assign(number_of_categories, 0.0);
+        double doc_norm{0.0};
+
+        for (const auto& [term, value] : tf_idf) {
+            doc_norm += value * value;
+
+            const double * row = centroid_matrix->term_row(term);
+            if (row == nullptr)
+                continue;
+            for (size_t c = 0; c < number_of_categories; c++)
+                dot_products[c] += value * row[c];
+        }
+
+        return select_top_k(dot_products.data(), sqrt(doc_norm), labels);
+    }
+
+    size_t BatchClassifier::score(const sparse::RowView& doc, ScoredLabel * labels) const {
+        size_t number_of_categories = centroid_matrix->num_categories();
+        static thread_local std::vector<double> dot_products;
+        dot_products.assign(number_of_categories, 0.0);
+        double doc_norm{0.0};
+
+        for (size_t k = 0; k < doc.size; k++) {
+            doc_norm += doc.values[k] * doc.values[k];
+
+            const double * row = centroid_matrix->term_row(doc.term_ids[k]);
+            if (row == nullptr)
+                continue;
+            for (size_t c = 0; c < number_of_categories; c++)
+                dot_products[c] += doc.values[k] * row[c];
+        }
+
+        return select_top_k(dot_products.data(), sqrt(doc_norm), labels);
+    }
+
+    // allocate the flat result, every block writes its own slice
+    static BatchScores make_scores(size_t number_of_docs, size_t top_k) {
+        BatchScores scores;
+        scores.top_k = top_k;
+        scores.labels.resize(number_of_docs * top_k);
+        scores.counts.resize(number_of_docs, 0);
+
+        return scores;
+    }
+
+    /* one classifier per NUMA node of the pool, each scoring against
+     * its node's copy of the weights, none on a single node
+     */
+    static std::vector<BatchClassifier> classifiers_per_node(const BatchClassifier& classifier, const tpool::NodeReplicas<double>& weights, 
+                                                             const tpool::ThreadPool& thread_pool) {
+        std::vector<BatchClassifier> classifiers;
+        if (thread_pool.num_nodes() < 2)
+            return classifiers;
+
+        const CentroidMatrix& centroids = classifier.centroids();
+        std::vector<std::string> category_types;
+        std::vector<double> norms;
+        for (size_t c = 0; c < centroids.num_categories(); c++) {
+            category_types.push_back(centroids.category_type(c));
+            norms.push_back(centroids.norm(c));
+        }
+
+        for (unsigned node = 0; node < thread_pool.num_nodes(); node++)
+            classifiers.emplace_back(CentroidMatrix::from_weights(category_types, norms, weights.of_node(node), centroids.num_terms(), nullptr), 
+                                     classifier.get_top_k());
+        return classifiers;
+    }
+
+    BatchScores BatchClassifier::classify(const corpus::Corpus& corpus, tpool::ThreadPool& thread_pool) const {
+        BatchScores scores = make_scores(corpus.documents.size(), top_k);
+        tpool::NodeReplicas<double> weights{centroid_matrix->data(), centroid_matrix->num_terms() * centroid_matrix->num_categories(), thread_pool};
+        std::vector<BatchClassifier> node_classifiers = classifiers_per_node(*this, weights, thread_pool);
+
+        thread_pool.parallel_for(corpus.documents.size(), [&](size_t begin, size_t end) {
+            PROF_SCOPE("classification/score");
+            const BatchClassifier& local = node_classifiers.empty() ? *this : node_classifiers[thread_pool.current_node()];
+            for (size_t i = begin; i < end; i++)
+                scores.counts[i] = local.score(corpus.documents[i].tf_idf, scores.labels.data() + i * top_k);
+        }, batch::BLOCK_SIZE);
+
+        return scores;
+    }
+
+    BatchScores BatchClassifier::classify(const corpus::FrozenCorpus& corpus, tpool::ThreadPool& thread_pool) const {
+        BatchScores scores = make_scores(corpus.matrix.num_rows(), top_k);
+        tpool::NodeReplicas<double> weights{centroid_matrix->data(), centroid_matrix->num_terms() * centroid_matrix->num_categories(), thread_pool};
+        std::vector<BatchClassifier> node_classifiers = classifiers_per_node(*this, weights, thread_pool);
+
+        thread_pool.parallel_for(corpus.matrix.num_rows(), [&](size_t begin, size_t end) {
+            PROF_SCOPE("classification/score");
+            const BatchClassifier& local = node_classifiers.empty() ? *this : node_classifiers[thread_pool.current_node()];
+            for (size_t r = begin; r < end; r++)
+                scores.counts[r] = local.score(corpus.matrix.row(r), scores.labels.data() + r * top_k);
+        }, batch::BLOCK_SIZE);
+
+        return scores;
+    }
+}
+
+/* Batch Functions */
+namespace cats::batch { // namespace cats::batch
+
+    extern void commit_classifications(const BatchScores& scores, const CentroidMatrix& centroids, const std::vector<std::string>& correct_types) {
+        size_t number_of_docs = std::min(scores.size(), correct_types.size());
+
+        // replaces the results of an earlier run, like the counts
+        u_classified.unknown_doc.clear();
+        u_classified.correct_count = 0;
+        u_classified.total_count = static_cast<int>(number_of_docs);
+        u_classified.unknown_doc.reserve(number_of_docs);
+
+        for (size_t i = 0; i < number_of_docs; i++) {
+            unknown_class result;
+            result.correct_type = correct_types[i];
+            result.classified_type = scores.count(i) == 0 ? "" : centroids.category_type(scores.labels_of(i)[0].category);
+            result.correct = result.correct_type == result.classified_type;
+
+            if (result.correct)
+                u_classified.correct_count++;
+            u_classified.unknown_doc.emplace_back(std::move(result));
+        }
+
+        u_classified.correct_db = number_of_docs == 0 ? 0.0 : static_cast<double>(u_classified.correct_count) / u_classified.total_count * 100;
+    }
+}
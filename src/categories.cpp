@@ -4,74 +4,32 @@
 
 #include "categories.hpp"
 #include "document.hpp"
+#include "sparse_kernels.hpp"
 #include "utils.hpp"
+#include "profiler.hpp"
 #include <mutex>
 #include <algorithm>
 #include <exception>
 #include <sstream>
 #include <fstream>
+#include <optional>
 #include <queue>
+#include <string_view>
 
-std::mutex mtx; // global mtx for emplacing Category to thread
-std::mutex tf_idf_mutex;
 
 namespace cats { // namespace cats
     unknown_classification_s u_classified = Unknown_Classification_Corp_S();
     
-    // return sorted std::vector of tfidf terms
-    std::vector<std::pair<std::string, double>> Category::sort_unordered_umap(std::unordered_map<std::string, double> terms) {
-        if (terms.empty())
-            throw_runtime_error("no terms or terms are empty in ", this->category_type);
-
-        std::vector<std::pair<std::string, double>> vectored_umap(terms.begin(), terms.end());
-
-        std::sort(vectored_umap.begin(), vectored_umap.end(), [](const auto&a, const auto&b) {
-            return a.second > b.second;
-        });
-
-        return vectored_umap;
-    }
-
-    // return std::pair for nth important tfidf term in category
-    std::pair<std::string, double> Category::search_nth_important_term(std::vector<std::vector<std::pair<std::string, double>>> all_tfidf_terms, std::vector<std::pair<std::string, double>> used) {
-
-        if (all_tfidf_terms.empty()){
-            throw_runtime_error("empty tfidf in ", this->category_type);
-        }
-        if (all_tfidf_terms[0].empty()) {
-            throw_runtime_error("empty tfidf in ", this->category_type);
-        }
-        
-        std::pair<std::string, double> current_high = all_tfidf_terms[0][0];
-
-        for (auto& row : all_tfidf_terms) {
-
-            /* only checking first 5 terms in a row, 
-            * since only need 5 important terms
-            */
-            for (int i = 0; i < std::min(5, static_cast<int>(row.size())); i++) {
-                std::pair<std::string, double> current_pair = row[i];
-
-                if ((current_high.second < current_pair.second && find(used.begin(), used.end(), current_pair) == used.end()) || find(used.begin(), used.end(), current_high) != used.end())
-                    current_high = current_pair;
-            }
-        }
-
-        return current_high;
-    }
-
     void Category::print_all() const {
         for (auto& [term, tf_idf] : this->tf_idf_all) {
-            std::cout << term << ": " << tf_idf << std::endl;
+            std::cout << vocab::vocabulary.term(term) << ": " << tf_idf << std::endl;
         }
     }
 
-    void Category::put_tf_idf_all(std::unordered_map<std::string, double> doc_tf_idf) {
-        std::unordered_map<std::string, int> word_count;
+    void Category::put_tf_idf_all(const vocab::term_map<double>& doc_tf_idf) {
+        std::unordered_map<vocab::term_id, int> word_count;
         int i{0};
 
-        // std::lock_guard<std::mutex> lock(tf_idf_mutex);  // Protects tf_idf_all
-
         for (auto& tf_idf : doc_tf_idf) {
             i++;
             // cout << tf_idf.first << " " << tf_idf.second << std::endl;
@@ -92,39 +50,64 @@ namespace cats { // namespace cats
         }
     }
 
+    void Category::build_centroid() {
+        std::vector<std::pair<vocab::term_id, double>> sorted_terms(tf_idf_all.begin(), tf_idf_all.end());
+        std::sort(sorted_terms.begin(), sorted_terms.end());
+
+        centroid_term_ids.clear();
+        centroid_values.clear();
+        centroid_term_ids.reserve(sorted_terms.size());
+        centroid_values.reserve(sorted_terms.size());
+        for (const auto& [term, tf_idf] : sorted_terms) {
+            centroid_term_ids.push_back(term);
+            centroid_values.push_back(tf_idf);
+        }
+
+        // dense view only when it is at most 8x the sparse arrays
+        centroid_dense.clear();
+        size_t dense_size = centroid_term_ids.empty() ? 0 : static_cast<size_t>(centroid_term_ids.back()) + 1;
+        if (dense_size > 0 && dense_size <= centroid_term_ids.size() * 8) {
+            centroid_dense.assign(dense_size, 0.0);
+            for (size_t k = 0; k < centroid_term_ids.size(); k++)
+                centroid_dense[centroid_term_ids[k]] = centroid_values[k];
+        }
+
+        centroid_norm = sqrt(sparse::squared_norm(centroid_values.data(), centroid_values.size()));
+    }
+
     void Category::get_important_terms(const corpus::Corpus& corpus) {
-        this->most_important_terms.reserve(5);                                       // reserve 5 slots of memory
-        std::vector<std::vector<std::pair<std::string, double>>> vectored_all_umaps; // std::vectorized sorted tfidf mapping
-        
-        // sort all the terms for each Document in the Category
+        topk::BoundedHeap important_terms{num_important_terms};
+        std::vector<topk::scored_term> document_terms;
+
+        // the best terms of the category are among the best terms of its documents
         for (auto& document : corpus.documents) {
             if (document.category != category_type)
                 continue;
 
-            try {
-                vectored_all_umaps.emplace_back(sort_unordered_umap(document.tf_idf));
-                put_tf_idf_all(document.tf_idf);
-            } catch (const std::runtime_error& e) {
-                std::cerr << "RuntimeError in Category::sort_unordered_umap: " << e.what() << std::endl;
-                throw std::runtime_error("RuntimeError in Category::get_important_terms");
-            } catch (const std::exception& e) {
-                std::cerr << "Exception in Category::sort_unordered_umap: " << e.what() << std::endl;
-                throw std::runtime_error("Exception in Category::get_important_terms"); 
-            } 
-        }
+            if (document.tf_idf.empty())
+                throw_runtime_error("no terms or terms are empty in ", this->category_type);
 
-        // get the 5 most important terms 
-        for (int i = 0; i < 5; i++) {
-            try {
-                most_important_terms.emplace_back(search_nth_important_term(vectored_all_umaps, most_important_terms));
-            } catch (const std::runtime_error& e) {
-                std::cerr << "RuntimeError in Category::search_nth_important_term: " << e.what() << std::endl;
-                throw std::runtime_error("RuntimeError in Category::get_important_terms");
-            } catch (const std::exception& e) {
-                std::cerr << "Exception in Category::search_nth_important_term: " << e.what() << std::endl;
-                throw std::runtime_error("Exception in Category::get_important_terms"); 
-            }
+            put_tf_idf_all(document.tf_idf);
+            topk::top_terms(document.tf_idf, num_important_terms, document_terms);
+            for (const auto& term : document_terms)
+                important_terms.push(term);
         }
+
+        set_important_terms(important_terms);
+    }
+
+    void Category::set_important_terms(const topk::BoundedHeap& important_terms) {
+        if (important_terms.size() == 0 && num_important_terms > 0)
+            throw_runtime_error("empty tfidf in ", this->category_type);
+
+        most_important_terms = important_terms.sorted();
+        build_centroid();
+    }
+
+    void Category::build_from_aggregate(std::unordered_map<vocab::term_id, double> aggregated_tf_idf,
+                                        const topk::BoundedHeap& important_terms) {
+        tf_idf_all = std::move(aggregated_tf_idf);
+        set_important_terms(important_terms);
     }
 
     void Category::print_all_info() const {
@@ -138,41 +121,55 @@ namespace cats { // namespace cats
         file << "Category: " << category_type << "\n";
         
         for (auto& term : most_important_terms) {
-            file << term.first << ": " << term.second << "\n";
+            file << vocab::vocabulary.term(term.first) << ": " << term.second << "\n";
         }
         file << "\n";
         file.close();
     }
 
 
-    static double cosine_similarity(const std::unordered_map<std::string, double>& doc1, const std::unordered_map<std::string, double>& doc2) {
-        double dotProduct = 0.0, norm1 = 0.0, norm2 = 0.0;
+    /* cosine similarity of a flattened document against a 
+     * category centroid, both norms are precomputed.
+     */
+    static double cosine_similarity(const sparse::RowView& doc, double doc_norm, const Category& category) {
+        if (doc_norm < 1e-9 || category.centroid_norm < 1e-9) return 0.0; // avoids division by zero
 
-        for (const auto& [word, tfidf1] : doc1) {
-            if (doc2.find(word) != doc2.end()) {
-                dotProduct += tfidf1 * doc2.at(word);
-            }
-            norm1 += tfidf1 * tfidf1;
-        }
-        
-        for (const auto& [word, tfidf2] : doc2) {
-            norm2 += tfidf2 * tfidf2;
+        double dotProduct;
+        if (!category.centroid_dense.empty()) {
+            dotProduct = sparse::dot_dense(doc, category.centroid_dense.data(), category.centroid_dense.size());
+        } else {
+            sparse::RowView centroid{category.centroid_term_ids.data(), category.centroid_values.data(), category.centroid_term_ids.size()};
+            dotProduct = sparse::dot_sorted(doc, centroid);
         }
 
-        if (fabs(norm1) < 1e-9 || fabs(norm2) < 1e-9) return 0.0; // avoids division by zero
-
-        return dotProduct / (sqrt(norm1) * sqrt(norm2));
+        return dotProduct / (doc_norm * category.centroid_norm);
     }
 
-    extern unknown_class classify_text(const std::unordered_map<std::string, double>& unknownText, std::vector<Category> cat_vect, std::string correct_type) {
+    extern unknown_class classify_text(const vocab::term_map<double>& unknownText, const std::vector<Category>& cat_vect, std::string correct_type) {
         unknown_class unknown_classification;
         unknown_classification.correct_type = correct_type;
         std::string best_category_type{""};
         double maxSimilarity = 0.0;
 
+        // flatten the document once, sorted for the merge kernel
+        static thread_local std::vector<std::pair<vocab::term_id, double>> sorted_terms;
+        static thread_local std::vector<vocab::term_id> term_ids;
+        static thread_local std::vector<double> values;
+        sorted_terms.assign(unknownText.begin(), unknownText.end());
+        std::sort(sorted_terms.begin(), sorted_terms.end());
+        term_ids.clear();
+        values.clear();
+        for (const auto& [term, tf_idf] : sorted_terms) {
+            term_ids.push_back(term);
+            values.push_back(tf_idf);
+        }
+
+        sparse::RowView doc{term_ids.data(), values.data(), term_ids.size()};
+        double doc_norm = sqrt(sparse::squared_norm(values.data(), values.size()));
+
         for (const auto& cat_tf_idf : cat_vect) {
 
-            double similarity = cosine_similarity(unknownText, cat_tf_idf.tf_idf_all);
+            double similarity = cosine_similarity(doc, doc_norm, cat_tf_idf);
             if (similarity > maxSimilarity) {
                 maxSimilarity = similarity;
                 best_category_type = cat_tf_idf.get_type();
@@ -259,94 +256,153 @@ namespace cats::par { // namespace cats::par
 
     }
 
-    extern void get_single_cat_par(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category) {
-        std::lock_guard<std::mutex> lock(mtx); /* MOVING LOCK HERE INCREASED ACCURACY BY ABOUT 60% */
-        Category cat(category);
+    extern void get_single_cat_par(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category, size_t num_important_terms) {
+        Category cat(category, num_important_terms);
 
         try {
             cat.get_important_terms(corpus);
-            cats.emplace_back(std::move(cat));
         } catch (const std::runtime_error &e) {
             std::cerr << "RuntimeError in get_single_cat_par, getting " << category <<  ": " << e.what() << std::endl;
+            return;
         } catch (const std::exception &e) {
             std::cerr << "Exception in get_single_cat_par, getting " << category <<  ": " << e.what() << std::endl;
+            return;
         }
-        
-      /*{
-            std::lock_guard<std::mutex> lock(mtx); ** HAVING LOCK HERE DECREASED ACCURACY BY ABOUT 60% **
-            cats.emplace_back(std::move(cat));
-        }*/
-    }
 
-    extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus) {
-        std::vector<std::thread> cat_threads;
-        std::vector<cats::Category> cat_vect;
+        std::lock_guard<std::mutex> lock(c_mtx); // categories are built independently, only the append is shared
+        cats.emplace_back(std::move(cat));
+    }
 
-        try {
-            for (auto& cat : corpus.category_types_set) {
-                cat_threads.emplace_back([&, cat]() {
-                    cats::par::get_single_cat_par(std::ref(corpus), std::ref(cat_vect), cat);
-                });
-            }
-        } catch (std::exception e) {
-            std::cerr << "Error in get_single_cat_par: " << e.what() << std::endl;
-        }
+    static constexpr size_t CHUNKS_PER_THREAD{4}; // chunks of documents per pool thread, balances uneven documents
 
-        for (auto& cat : cat_threads)
-            cat.join();
+    /* w = scale * w + offset, the composition of 
+     * w = (w + v) / n over the documents of a chunk
+     */
+    struct AffineTerm {
+        double scale{1.0};
+        double offset{0.0};
+    };
 
-        return cat_vect;
-    }
+    // per-category state of a contiguous chunk of documents
+    struct CategoryPartial {
+        std::unordered_map<vocab::term_id, AffineTerm> terms; ///< Folded `tf_idf_all` updates.
+        topk::BoundedHeap important_terms;                    ///< Best terms of the chunk's documents.
+        bool has_empty_document{false};                       ///< `get_important_terms()` fails on these.
+    };
 
-    struct DocIdxQueue {
-        public:
-            std::queue<int> doc_idx_queue;
-            std::mutex queue_mtx; // queue mutex
+    // fold one document into a chunk, mirrors Category::put_tf_idf_all
+    static void fold_document(const docs::Document& document, CategoryPartial& partial) {
+        if (document.tf_idf.empty()) {
+            partial.has_empty_document = true;
+            return;
+        }
 
-    };
+        double number_of_terms = static_cast<double>(document.tf_idf.size());
+        for (const auto& [word, tf_idf] : document.tf_idf) {
+            AffineTerm& term = partial.terms[word];
+            term.scale /= number_of_terms;
+            term.offset = (term.offset + tf_idf) / number_of_terms;
+        }
 
-    static void worker_thread(const corpus::Corpus& corpus, std::queue<int> doc_idx_queue, std::vector<cats::Category> cat_vect) {
-        int current_cat_type{0};
-
-        while (!doc_idx_queue.empty()) {
-            int current_doc_idx{-1};
-            std::vector<std::vector<std::pair<std::string, double>>> vectored_all_umaps;
-            // {
-            //     std::lock_guard<std::mutex> lock(queue_mtx);
-            //     if (!doc_idx_queue.empty()) {
-            //         current_doc_idx = doc_idx_queue.front();
-            //         task_queue.pop();
-            //     }
-            // }
-            
+        static thread_local std::vector<topk::scored_term> document_terms;
+        topk::top_terms(document.tf_idf, partial.important_terms.capacity(), document_terms);
+        for (const auto& term : document_terms)
+            partial.important_terms.push(term);
+    }
 
+    // append the chunk right after left, in corpus order
+    static void merge_partials(CategoryPartial& left, CategoryPartial& right) {
+        for (const auto& [word, right_term] : right.terms) {
+            auto [found, inserted] = left.terms.try_emplace(word, right_term);
+            if (!inserted) {
+                found->second.offset = right_term.scale * found->second.offset + right_term.offset;
+                found->second.scale *= right_term.scale;
+            }
         }
+
+        left.important_terms.merge(right.important_terms);
+        left.has_empty_document = left.has_empty_document || right.has_empty_document;
+        right.terms = {}; // release the merged chunk early
     }
 
-    static std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus, int num_threads) {
-        std::vector<std::thread> cat_threads;
-        std::vector<cats::Category> cat_vect;
-        std::queue<int> doc_idx_queue;
+    extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus, tpool::ThreadPool& thread_pool, size_t num_important_terms) {
+        PROF_SCOPE("categories/centroid");
+        std::vector<std::string> category_types(corpus.category_types_set.begin(), corpus.category_types_set.end());
+        std::unordered_map<std::string_view, size_t> category_index;
+        for (size_t c = 0; c < category_types.size(); c++)
+            category_index.emplace(category_types[c], c);
+
+        size_t number_of_docs = corpus.documents.size();
+        size_t number_of_chunks = std::clamp<size_t>((thread_pool.size() + 1) * CHUNKS_PER_THREAD, 1, std::max<size_t>(1, number_of_docs));
+        std::vector<std::vector<CategoryPartial>> chunks(number_of_chunks, std::vector<CategoryPartial>(category_types.size(),
+                                                         CategoryPartial{{}, topk::BoundedHeap{num_important_terms}, false}));
+
+        // every task folds its own contiguous chunk, no shared writes
+        thread_pool.parallel_for(number_of_chunks, [&](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++) {
+                size_t first_doc = number_of_docs * chunk / number_of_chunks;
+                size_t last_doc = number_of_docs * (chunk + 1) / number_of_chunks;
+
+                for (size_t d = first_doc; d < last_doc; d++) {
+                    auto found = category_index.find(corpus.documents[d].category);
+                    if (found != category_index.end())
+                        fold_document(corpus.documents[d], chunks[chunk][found->second]);
+                }
+            }
+        }, 1);
+
+        // merge neighbouring chunks pairwise, log2(chunks) parallel rounds
+        for (size_t stride = 1; stride < number_of_chunks; stride *= 2) {
+            size_t number_of_pairs = (number_of_chunks + 2 * stride - 1) / (2 * stride);
+            thread_pool.parallel_for(number_of_pairs * category_types.size(), [&](size_t begin, size_t end) {
+                for (size_t task = begin; task < end; task++) {
+                    size_t left = (task / category_types.size()) * 2 * stride;
+                    size_t category = task % category_types.size();
+                    if (left + stride < number_of_chunks)
+                        merge_partials(chunks[left][category], chunks[left + stride][category]);
+                }
+            }, 1);
+        }
 
-        int num_docs = corpus.num_of_docs;
-        for (int i = 0; i < num_docs; i++) 
-            doc_idx_queue.push(i);
+        std::vector<std::optional<cats::Category>> built(category_types.size());
+        thread_pool.parallel_for(category_types.size(), [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                CategoryPartial& partial = chunks[0][c];
+                if (partial.has_empty_document) {
+                    std::cerr << "RuntimeError in get_all_cat_par, getting " << category_types[c] << ": no terms or terms are empty" << std::endl;
+                    continue;
+                }
 
-        for (const auto& cat : corpus.category_types_set)
-            cat_vect.emplace_back(cat);
+                // every chunk starts from an empty centroid, so w = offset
+                std::unordered_map<vocab::term_id, double> aggregated_tf_idf;
+                aggregated_tf_idf.reserve(partial.terms.size());
+                for (const auto& [word, term] : partial.terms)
+                    aggregated_tf_idf.emplace(word, term.offset);
 
-        for (int i = 0; i < num_threads; i++) {
-            cat_threads.emplace_back([&corpus, doc_idx_queue, cat_vect]() {
-                worker_thread(corpus, doc_idx_queue, cat_vect);
-            });
-        }
+                try {
+                    Category cat(category_types[c], num_important_terms);
+                    cat.build_from_aggregate(std::move(aggregated_tf_idf), partial.important_terms);
+                    built[c].emplace(std::move(cat));
+                } catch (const std::exception &e) {
+                    std::cerr << "Exception in get_all_cat_par, getting " << category_types[c] << ": " << e.what() << std::endl;
+                }
+            }
+        }, 1);
 
-        for (auto& t : cat_threads)
-            t.join();
+        std::vector<cats::Category> cat_vect;
+        cat_vect.reserve(category_types.size());
+        for (auto& cat : built)
+            if (cat)
+                cat_vect.emplace_back(std::move(*cat));
 
         return cat_vect;
     }
 
+    extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus) {
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        return get_all_cat_par(corpus, thread_pool);
+    }
+
 //     extern std::vector<cats::Category> get_all_cat_par(const corpus::Corpus& corpus, int num_threads) {
 //         std::vector<std::thread> cat_threads;
 //         std::vector<cats::Category> cat_vect;
@@ -422,7 +478,7 @@ namespace cats::par { // namespace cats::par
 //     }
 
     // commit classification changes to the unknown_classification_par_s structure
-    static void commit_classification_changes(std::unordered_map<std::string, double> tf_idf, std::vector<Category> cat_vect, std::string correct_type) {
+    static void commit_classification_changes(const vocab::term_map<double>& tf_idf, const std::vector<Category>& cat_vect, std::string correct_type) {
         try {    
             unknown_class result = classify_text(tf_idf, cat_vect, correct_type);
             if (result.correct)
@@ -437,57 +493,38 @@ namespace cats::par { // namespace cats::par
         }
     }
     
-    extern void init_classification_par(const corpus::Corpus& unknown_corpus, std::vector<Category> cat_vect, std::vector<std::string> correct_types) {
-        unsigned int number_of_docs_in_thread{unknown_corpus.get_number_of_docs_per_thread()};
-        int num_of_docs{unknown_corpus.num_of_docs};
-        unsigned number_of_docs_in_last_thread = num_of_docs % number_of_docs_in_thread;
-        std::vector<std::thread> threads;
-
-        // load balanced threads accordingly
-        for (int i = 0; i < num_of_docs; i+=number_of_docs_in_thread) {
-            threads.emplace_back([num_of_docs, i, number_of_docs_in_thread, number_of_docs_in_last_thread, &unknown_corpus, &cat_vect, &correct_types]() mutable {
-                int x{0};
+    extern void init_classification_par(const corpus::Corpus& unknown_corpus, std::vector<Category> cat_vect, std::vector<std::string> correct_types, tpool::ThreadPool& thread_pool) {
+        size_t num_of_docs{unknown_corpus.documents.size()};
+
+        // small batches of documents are queued on the pool
+        thread_pool.parallel_for(num_of_docs, [&unknown_corpus, &cat_vect, &correct_types](size_t begin, size_t end) {
+            for (size_t x = begin; x < end; x++) {
                 try {
-                    if (i >= num_of_docs - number_of_docs_in_thread && number_of_docs_in_last_thread > 0) {
-                        for ( x = 0; x < number_of_docs_in_last_thread; x++) 
-                            try {
-                                commit_classification_changes(unknown_corpus.documents.at(x+i).tf_idf, cat_vect, correct_types.at(x+i));
-                            } catch (std::out_of_range &e) {
-                                std::cerr << "Error: " << " in init_classification_par last thread, i=" << i << ", x=" << x << std::endl << e.what() << std::endl;
-                                exit(EXIT_FAILURE);
-                            }
-                    } else {
-                        for ( x = 0; x < number_of_docs_in_thread; x++) {
-                            try {
-                                commit_classification_changes(unknown_corpus.documents.at(x+i).tf_idf, cat_vect, correct_types.at(x+i));
-                            } catch (std::out_of_range &e) {
-                                std::cerr << "Error: " << " in init_classification_par, i=" << i << ", x=" << x << std::endl << e.what() << std::endl;
-                                exit(EXIT_FAILURE);
-                            }
-                        }
-                    }   
+                    commit_classification_changes(unknown_corpus.documents.at(x).tf_idf, cat_vect, correct_types.at(x));
                 } catch (std::out_of_range &e) {
-                    std::cerr << "Error: " << " in init_classification_par, i=" << i << ", x=" << x << std::endl << e.what() << std::endl;
+                    std::cerr << "Error: " << " in init_classification_par, x=" << x << std::endl << e.what() << std::endl;
                     exit(EXIT_FAILURE);
                 }
-            });
-        }
-
-        for (auto& t : threads)
-            t.join();
+            }
+        });
 
         u_classified.correct_count = correct_count.load();
         u_classified.total_count = total_count.load();
 
         u_classified.correct_db = static_cast<double>(u_classified.correct_count) / u_classified.total_count * 100;
     }
+
+    extern void init_classification_par(const corpus::Corpus& unknown_corpus, std::vector<Category> cat_vect, std::vector<std::string> correct_types) {
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        init_classification_par(unknown_corpus, std::move(cat_vect), std::move(correct_types), thread_pool);
+    }
 }
 
 /* Sequential Functions */
 namespace cats::seq { // namespace cats::seq
 
-    extern void get_single_cat_seq(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category) {
-        Category cat(category);
+    extern void get_single_cat_seq(const corpus::Corpus& corpus, std::vector<Category>& cats, std::string category, size_t num_important_terms) {
+        Category cat(category, num_important_terms);
         try {
             cat.get_important_terms(corpus);
         } catch (const std::runtime_error &e) {
@@ -500,11 +537,12 @@ namespace cats::seq { // namespace cats::seq
         cats.emplace_back(std::move(cat));
     }
 
-    extern std::vector<cats::Category> get_all_cat_seq(const corpus::Corpus& corpus) {
+    extern std::vector<cats::Category> get_all_cat_seq(const corpus::Corpus& corpus, size_t num_important_terms) {
+        PROF_SCOPE("categories/centroid");
         std::vector<cats::Category> cat_vect;
         try {
             for (const auto& cat : corpus.category_types_set) {
-                cats::seq::get_single_cat_seq(corpus, cat_vect, cat);
+                cats::seq::get_single_cat_seq(corpus, cat_vect, cat, num_important_terms);
             }
         } catch (std::exception e) {
             std::cerr << "Error in get_single_cat_seq: " << e.what() << std::endl;
@@ -523,7 +561,7 @@ namespace cats::seq { // namespace cats::seq
                 std::cerr << "Index out of range: " << i << std::endl;
             } else {
                 try {
-                    auto doc = unknown_corpus.documents.at(i);
+                    const auto& doc = unknown_corpus.documents.at(i);
                     auto correct_type = correct_types.at(i);
                     auto result = classify_text(doc.tf_idf, cat_vect, correct_type);
             
@@ -541,4 +579,92 @@ namespace cats::seq { // namespace cats::seq
 
         u_classified.correct_db = static_cast<double>(u_classified.correct_count) / u_classified.total_count * 100;
     }
-}
\ No newline at end of file
+}
+
+
+/* CSR Functions */
+namespace cats::csr { // namespace cats::csr
+
+    // sweep the rows of one category, mirrors Category::put_tf_idf_all
+    static void build_centroid(const corpus::FrozenCorpus& corpus, int category, std::vector<double>& weights, double& norm) {
+        weights.assign(vocab::vocabulary.size(), 0.0);
+
+        for (size_t r = 0; r < corpus.matrix.num_rows(); r++) {
+            if (corpus.row_category[r] != category)
+                continue;
+
+            sparse::RowView row = corpus.matrix.row(r);
+            for (size_t k = 0; k < row.size; k++)
+                weights[row.term_ids[k]] += row.values[k];
+            for (size_t k = 0; k < row.size; k++)
+                weights[row.term_ids[k]] /= row.size;
+        }
+
+        norm = sqrt(sparse::squared_norm(weights.data(), weights.size()));
+    }
+
+    extern centroids_s get_all_centroids_csr(const corpus::FrozenCorpus& corpus, tpool::ThreadPool& thread_pool) {
+        PROF_SCOPE("categories/centroid");
+        centroids_s centroids;
+        size_t number_of_categories = corpus.category_types.size();
+
+        centroids.category_types = corpus.category_types;
+        centroids.weights.resize(number_of_categories);
+        centroids.norms.resize(number_of_categories);
+
+        thread_pool.parallel_for(number_of_categories, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++)
+                build_centroid(corpus, static_cast<int>(c), centroids.weights[c], centroids.norms[c]);
+        }, 1);
+
+        return centroids;
+    }
+
+    // cosine similarity of a row against every centroid, returns the best centroid or -1
+    static int classify_row(const sparse::RowView& row, const centroids_s& centroids) {
+        double row_norm = sqrt(sparse::squared_norm(row.values, row.size));
+
+        int best_category{-1};
+        double max_similarity{0.0};
+
+        for (size_t c = 0; c < centroids.weights.size(); c++) {
+            if (row_norm < 1e-9 || centroids.norms[c] < 1e-9)
+                continue; // avoids division by zero
+
+            double dot_product = sparse::dot_dense(row, centroids.weights[c].data(), centroids.weights[c].size());
+
+            double similarity = dot_product / (row_norm * centroids.norms[c]);
+            if (similarity > max_similarity) {
+                max_similarity = similarity;
+                best_category = static_cast<int>(c);
+            }
+        }
+
+        return best_category;
+    }
+
+    extern void init_classification_csr(const corpus::FrozenCorpus& unknown_corpus, const centroids_s& centroids, const std::vector<std::string>& correct_types, tpool::ThreadPool& thread_pool) {
+        size_t number_of_rows = std::min(unknown_corpus.matrix.num_rows(), correct_types.size());
+        std::vector<unknown_class> results(number_of_rows);
+
+        thread_pool.parallel_for(number_of_rows, [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++) {
+                int best_category = classify_row(unknown_corpus.matrix.row(r), centroids);
+
+                results[r].correct_type = correct_types[r];
+                results[r].classified_type = best_category < 0 ? "" : centroids.category_types[best_category];
+                results[r].correct = results[r].correct_type == results[r].classified_type;
+            }
+        });
+
+        u_classified.correct_count = 0;
+        u_classified.total_count = static_cast<int>(number_of_rows);
+        for (auto& result : results) {
+            if (result.correct)
+                u_classified.correct_count++;
+            u_classified.unknown_doc.emplace_back(std::move(result));
+        }
+
+        u_classified.correct_db = static_cast<double>(u_classified.correct_count) / u_classified.total_count * 100;
+    }
+}
@@ -0,0 +1,348 @@
+/* classify_server.cpp
+ * source file for classify_server.hpp
+ */
+
+#include "classify_server.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace serve {
+
+    static constexpr size_t READ_CHUNK{1 << 16}; // bytes read from a connection at once
+
+    ClassifyServer::ClassifyServer(std::shared_ptr<const cats::OnlineClassifier> classifier, tpool::ThreadPool& thread_pool,
+                                   ServerSettings settings)
+        : classifier{std::move(classifier)},
+          batch_classifier{this->classifier->shared_centroids(), settings.top_k},
+          thread_pool{thread_pool},
+          settings{settings}
+    {
+        this->settings.max_batch = std::max<size_t>(1, settings.max_batch);
+        this->settings.top_k = batch_classifier.get_top_k();
+        batcher = std::thread([this]() { batch_loop(); });
+    }
+
+    ClassifyServer::~ClassifyServer() {
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(queue_mtx);
+            shutting_down = true;
+        }
+        queue_not_empty.notify_all();
+        batcher.join();
+    }
+
+    ServerStats ClassifyServer::stats() const {
+        std::lock_guard<std::mutex> lock(queue_mtx);
+        return counters;
+    }
+
+    void ClassifyServer::submit_and_wait(Submission& submission) {
+        if (submission.requests.empty())
+            return;
+
+        std::unique_lock<std::mutex> lock(queue_mtx);
+        submission.remaining = submission.requests.size();
+        for (size_t i = 0; i < submission.requests.size(); i++)
+            queue.emplace_back(&submission, i);
+        queue_not_empty.notify_one();
+
+        submission.done.wait(lock, [&submission]() { return submission.remaining == 0; });
+    }
+
+    void ClassifyServer::batch_loop() {
+        std::vector<std::pair<Submission *, size_t>> batch;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queue_mtx);
+                queue_not_empty.wait(lock, [this]() { return !queue.empty() || shutting_down; });
+                if (queue.empty())
+                    return; // only once every serving loop has returned
+
+                // give concurrent connections a moment to fill the batch
+                if (queue.size() < settings.max_batch)
+                    queue_not_empty.wait_for(lock, settings.max_wait, [this]() { return queue.size() >= settings.max_batch; });
+
+                size_t batch_size = std::min(queue.size(), settings.max_batch);
+                batch.assign(queue.begin(), queue.begin() + batch_size);
+                queue.erase(queue.begin(), queue.begin() + batch_size);
+            }
+
+            // a failed batch is answered with its error, the batcher keeps serving
+            std::string error;
+            auto start = std::chrono::steady_clock::now();
+            try {
+                score_batch(batch);
+            } catch (std::exception &e) {
+                error = e.what();
+            } catch (...) {
+                error = "unknown error";
+            }
+            double busy_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (!error.empty())
+                for (auto& [submission, index] : batch)
+                    submission->requests[index].error = error;
+
+            std::lock_guard<std::mutex> lock(queue_mtx);
+            counters.documents += batch.size();
+            counters.batches++;
+            counters.errors += error.empty() ? 0 : batch.size();
+            counters.busy_ms += busy_ms;
+            for (auto& [submission, index] : batch)
+                if (--submission->remaining == 0)
+                    submission->done.notify_one();
+        }
+    }
+
+    void ClassifyServer::score_batch(std::vector<std::pair<Submission *, size_t>>& batch) {
+        thread_pool.parallel_for(batch.size(), [this, &batch](size_t begin, size_t end) {
+            static thread_local std::vector<vocab::term_id> term_ids;
+            static thread_local std::vector<double> values;
+
+            for (size_t i = begin; i < end; i++) {
+                Request& request = batch[i].first->requests[batch[i].second];
+                classifier->vectorize(request.text, term_ids, values);
+                request.labels.resize(settings.top_k);
+                request.count = batch_classifier.score(sparse::RowView{term_ids.data(), values.data(), term_ids.size()}, request.labels.data());
+            }
+        }, cats::batch::BLOCK_SIZE / 4);
+    }
+
+    // one line, whatever the message holds
+    static void append_error(const std::string& message, std::string& reply) {
+        reply += "ERROR\t";
+        for (char c : message)
+            reply += c == '\n' || c == '\r' ? ' ' : c;
+        reply += '\n';
+    }
+
+    void ClassifyServer::format_reply(const Request& request, std::string& reply) const {
+        if (!request.error.empty()) {
+            append_error(request.error, reply);
+            return;
+        }
+
+        const cats::CentroidMatrix& centroids = classifier->centroids();
+        for (size_t k = 0; k < request.count; k++) {
+            if (k > 0)
+                reply += '\t';
+            reply += centroids.category_type(request.labels[k].category);
+            reply += '\t';
+            reply += std::to_string(request.labels[k].score);
+        }
+        reply += '\n';
+    }
+
+    // std::getline keeping at most max_bytes, the rest of a longer line is read and dropped
+    static bool read_line(std::istream& in, std::string& line, size_t max_bytes, bool& too_long) {
+        std::streambuf *buffer = in.rdbuf();
+        line.clear();
+        too_long = false;
+
+        for (int c = buffer->sbumpc(); c != std::char_traits<char>::eof(); c = buffer->sbumpc()) {
+            if (c == '\n')
+                return true;
+            if (line.size() < max_bytes)
+                line += static_cast<char>(c);
+            else
+                too_long = true;
+        }
+
+        in.setstate(std::ios::eofbit);
+        if (line.empty() && !too_long) {
+            in.setstate(std::ios::failbit);
+            return false;
+        }
+        return true;
+    }
+
+    void ClassifyServer::serve_stream(std::istream& in, std::ostream& out) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mtx);
+            counters.connections++;
+        }
+
+        Submission submission;
+        std::string line;
+        std::string reply;
+        bool too_long{false};
+        size_t rejected{0};
+
+        while (!stopping.load(std::memory_order_relaxed) && read_line(in, line, settings.max_line_bytes, too_long)) {
+            // take every line already buffered, a pipelining client gets one batch
+            submission.requests.clear();
+            rejected = 0;
+            do {
+                submission.requests.emplace_back();
+                Request& request = submission.requests.back();
+                if (too_long) {
+                    // scored as an empty document, the reply is the error
+                    request.error = "line longer than " + std::to_string(settings.max_line_bytes) + " bytes";
+                    rejected++;
+                    continue;
+                }
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                request.text = std::move(line);
+            } while (submission.requests.size() < settings.max_batch && in.rdbuf()->in_avail() > 0 &&
+                     read_line(in, line, settings.max_line_bytes, too_long));
+
+            if (rejected > 0) {
+                std::lock_guard<std::mutex> lock(queue_mtx);
+                counters.errors += rejected;
+            }
+
+            submit_and_wait(submission);
+
+            reply.clear();
+            for (const auto& request : submission.requests)
+                format_reply(request, reply);
+            out << reply;
+            out.flush();
+        }
+    }
+
+    // write all of data, false if the peer is gone
+    static bool write_all(int fd, const std::string& data) {
+        size_t written{0};
+        while (written < data.size()) {
+            ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void ClassifyServer::serve_connection(int client_fd) {
+        Submission submission;
+        std::string buffer;
+        std::string reply;
+        std::vector<char> chunk(READ_CHUNK);
+        bool open{true};
+
+        while (open && !stopping.load(std::memory_order_relaxed)) {
+            pollfd readable{client_fd, POLLIN, 0};
+            int ready = poll(&readable, 1, static_cast<int>(POLL_INTERVAL.count()));
+            if (ready < 0 && errno != EINTR)
+                break;
+            if (ready <= 0)
+                continue;
+
+            ssize_t n = read(client_fd, chunk.data(), chunk.size());
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                open = false; // answer a last unterminated line below
+                if (buffer.empty())
+                    break;
+                buffer += '\n';
+            } else {
+                buffer.append(chunk.data(), static_cast<size_t>(n));
+            }
+
+            // every complete line in the buffer is one request
+            size_t begin{0};
+            size_t newline;
+            while ((newline = buffer.find('\n', begin)) != std::string::npos) {
+                submission.requests.clear();
+                while (newline != std::string::npos && submission.requests.size() < settings.max_batch) {
+                    size_t end = newline > begin && buffer[newline - 1] == '\r' ? newline - 1 : newline;
+                    submission.requests.emplace_back();
+                    submission.requests.back().text.assign(buffer, begin, end - begin);
+                    begin = newline + 1;
+                    newline = buffer.find('\n', begin);
+                }
+
+                submit_and_wait(submission);
+
+                reply.clear();
+                for (const auto& request : submission.requests)
+                    format_reply(request, reply);
+                if (!write_all(client_fd, reply)) {
+                    open = false;
+                    break;
+                }
+            }
+            buffer.erase(0, begin);
+
+            // a client that never sends a newline must not grow the buffer forever
+            if (open && buffer.size() > settings.max_line_bytes) {
+                reply.clear();
+                append_error("line longer than " + std::to_string(settings.max_line_bytes) + " bytes", reply);
+                write_all(client_fd, reply);
+                break;
+            }
+        }
+
+        close(client_fd);
+    }
+
+    void ClassifyServer::serve_socket(const std::string& socket_path) {
+        sockaddr_un address{};
+        if (socket_path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("socket path is too long: " + socket_path);
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0)
+            throw std::runtime_error("socket cannot be created: " + std::string(strerror(errno)));
+
+        unlink(socket_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0) {
+            std::string error{strerror(errno)};
+            close(listen_fd);
+            throw std::runtime_error("socket cannot listen on " + socket_path + ": " + error);
+        }
+
+        // connection threads and their finished flags, finished ones are joined on the next accept
+        std::vector<std::pair<std::thread, std::shared_ptr<std::atomic<bool>>>> connections;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            pollfd acceptable{listen_fd, POLLIN, 0};
+            if (poll(&acceptable, 1, static_cast<int>(POLL_INTERVAL.count())) <= 0)
+                continue;
+
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd < 0)
+                continue;
+
+            {
+                std::lock_guard<std::mutex> lock(queue_mtx);
+                counters.connections++;
+            }
+
+            auto finished = std::make_shared<std::atomic<bool>>(false);
+            connections.emplace_back(std::thread([this, client_fd, finished]() {
+                serve_connection(client_fd);
+                finished->store(true, std::memory_order_release);
+            }), finished);
+
+            for (auto connection = connections.begin(); connection != connections.end();) {
+                if (connection->second->load(std::memory_order_acquire)) {
+                    connection->first.join();
+                    connection = connections.erase(connection);
+                } else {
+                    connection++;
+                }
+            }
+        }
+
+        // connections notice the stop within one poll interval
+        for (auto& connection : connections)
+            connection.first.join();
+
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+
+} // namespace serve
@@ -0,0 +1,262 @@
+/* corpus_generator.cpp
+ * source file for corpus_generator.hpp
+ */
+
+#include "corpus_generator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace gen {
+
+    /* syllables are a consonant then a vowel, no 'e', 'i' or 'y'
+     * so no stemmer suffix rule ever matches the end of a word
+     */
+    static constexpr char CONSONANTS[]{"bdfghjklmnprstvz"};
+    static constexpr char VOWELS[]{"aou"};
+    static constexpr uint64_t NUM_CONSONANTS{sizeof(CONSONANTS) - 1};
+    static constexpr uint64_t NUM_SYLLABLES{NUM_CONSONANTS * (sizeof(VOWELS) - 1)};
+    static constexpr size_t MIN_SYLLABLES{2}; // single syllables would include "do", "no", "so", "to"
+
+    static constexpr size_t BATCH_DOCS{16384}; // documents generated between two writes
+
+    static constexpr double PI{3.14159265358979323846};
+
+    extern LengthDistribution parse_length_distribution(const std::string& name) {
+        if (name == "fixed")
+            return LengthDistribution::fixed;
+        if (name == "uniform")
+            return LengthDistribution::uniform;
+        if (name == "lognormal")
+            return LengthDistribution::lognormal;
+        throw std::invalid_argument("Unknown length distribution: " + name);
+    }
+
+    static uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    Rng::Rng(uint64_t seed, uint64_t stream) {
+        uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+        for (uint64_t& word : state)
+            word = splitmix64(x);
+    }
+
+    ZipfSampler::ZipfSampler(size_t n, double exponent) : probability(n), alias(n) {
+        std::vector<double> scaled(n);
+        double total{0.0};
+        for (size_t rank = 0; rank < n; rank++) {
+            scaled[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+            total += scaled[rank];
+        }
+
+        // Vose: pair every column under the average with one over it
+        std::vector<uint32_t> small;
+        std::vector<uint32_t> large;
+        for (size_t rank = 0; rank < n; rank++) {
+            scaled[rank] *= static_cast<double>(n) / total;
+            (scaled[rank] < 1.0 ? small : large).push_back(static_cast<uint32_t>(rank));
+        }
+
+        while (!small.empty() && !large.empty()) {
+            uint32_t less = small.back();
+            uint32_t more = large.back();
+            small.pop_back();
+            large.pop_back();
+
+            probability[less] = scaled[less];
+            alias[less] = more;
+            scaled[more] -= 1.0 - scaled[less];
+            (scaled[more] < 1.0 ? small : large).push_back(more);
+        }
+
+        // what is left is 1 up to rounding
+        for (uint32_t rank : large) {
+            probability[rank] = 1.0;
+            alias[rank] = rank;
+        }
+        for (uint32_t rank : small) {
+            probability[rank] = 1.0;
+            alias[rank] = rank;
+        }
+    }
+
+    /* ranks are numbered through all 2 syllable words,
+     * then all 3 syllable words, and so on
+     */
+    static void append_word(std::string& text, uint64_t rank) {
+        size_t syllables{MIN_SYLLABLES};
+        uint64_t words_of_length{NUM_SYLLABLES * NUM_SYLLABLES};
+        while (rank >= words_of_length) {
+            rank -= words_of_length;
+            words_of_length *= NUM_SYLLABLES;
+            syllables++;
+        }
+
+        size_t end = text.size() + 2 * syllables;
+        text.resize(end);
+        for (size_t i = 0; i < syllables; i++) {
+            uint64_t syllable = rank % NUM_SYLLABLES;
+            rank /= NUM_SYLLABLES;
+            text[end - 2 * i - 2] = CONSONANTS[syllable % NUM_CONSONANTS];
+            text[end - 2 * i - 1] = VOWELS[syllable / NUM_CONSONANTS];
+        }
+    }
+
+    extern std::string vocabulary_word(uint64_t rank) {
+        std::string word;
+        append_word(word, rank);
+        return word;
+    }
+
+    extern std::string category_name(size_t index) {
+        return "category-" + std::to_string(index);
+    }
+
+    static void validate(const CorpusConfig& config) {
+        if (config.num_docs == 0)
+            throw std::invalid_argument("Corpus generator: no documents requested");
+        if (config.vocabulary_size == 0 || config.vocabulary_size > std::numeric_limits<uint32_t>::max())
+            throw std::invalid_argument("Corpus generator: vocabulary size must be in [1, 2^32)");
+        if (config.num_categories == 0)
+            throw std::invalid_argument("Corpus generator: at least one category is needed");
+        if (!(config.testing_fraction >= 0.0 && config.testing_fraction <= 1.0))
+            throw std::invalid_argument("Corpus generator: testing fraction must be in [0, 1]");
+        if (!(config.category_skew >= 0.0 && config.category_skew <= 1.0))
+            throw std::invalid_argument("Corpus generator: category skew must be in [0, 1]");
+        if (!(config.zipf_exponent >= 0.0))
+            throw std::invalid_argument("Corpus generator: Zipf exponent must be >= 0");
+        if (config.min_length == 0 || config.min_length > config.max_length)
+            throw std::invalid_argument("Corpus generator: document lengths must satisfy 1 <= min <= max");
+        if (config.mean_length == 0)
+            throw std::invalid_argument("Corpus generator: mean document length must be >= 1");
+    }
+
+    static size_t document_length(const CorpusConfig& config, Rng& rng) {
+        switch (config.length_distribution) {
+            case LengthDistribution::fixed:
+                return config.mean_length;
+
+            case LengthDistribution::uniform:
+                return config.min_length + rng.below(config.max_length - config.min_length + 1);
+
+            case LengthDistribution::lognormal: {
+                // Box-Muller, mu chosen so the mean is mean_length
+                double mu = std::log(static_cast<double>(config.mean_length)) - config.length_sigma * config.length_sigma / 2.0;
+                double u1 = 1.0 - rng.uniform();
+                double u2 = rng.uniform();
+                double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+                double length = std::round(std::exp(mu + config.length_sigma * z));
+                return static_cast<size_t>(std::clamp(length, static_cast<double>(config.min_length), static_cast<double>(config.max_length)));
+            }
+        }
+        return config.mean_length;
+    }
+
+    /* Appends the text of document index to text
+     * and returns its category, the same for any
+     * thread and any batch the document falls in.
+     */
+    static size_t generate_document(const CorpusConfig& config, const ZipfSampler& zipf, size_t index, std::string& text, size_t& tokens) {
+        Rng rng{config.seed, index};
+        size_t category = rng.below(config.num_categories);
+        tokens = document_length(config, rng);
+
+        // the category's distribution is the same curve, its head moved into the tail of the others
+        uint64_t offset = (category + 1) * config.vocabulary_size / (config.num_categories + 1);
+
+        text.reserve(tokens * 8);
+        for (size_t i = 0; i < tokens; i++) {
+            uint64_t rank = zipf.sample(rng);
+            if (config.category_skew > 0.0 && rng.uniform() < config.category_skew)
+                rank = (rank + offset) % config.vocabulary_size;
+
+            if (i != 0)
+                text.push_back(' ');
+            append_word(text, rank);
+        }
+
+        return category;
+    }
+
+    static std::ofstream open_output(const std::string& file_name) {
+        std::ofstream file{file_name, std::ios::binary};
+        if (!file)
+            throw std::runtime_error("File cannot be written: " + file_name);
+        return file;
+    }
+
+    extern CorpusSummary write_corpus(const CorpusConfig& config, const std::string& folder, tpool::ThreadPool& thread_pool) {
+        validate(config);
+
+        std::string prefix{folder.empty() || folder.back() == '/' ? folder : folder + "/"};
+        if (!prefix.empty())
+            std::filesystem::create_directories(prefix);
+
+        std::ofstream training = open_output(prefix + "training-data.csv");
+        std::ofstream testing = open_output(prefix + "testing-data.txt");
+        std::ofstream correct = open_output(prefix + "testing-correct-data.txt");
+
+        std::vector<std::string> names(config.num_categories);
+        for (size_t c = 0; c < names.size(); c++)
+            names[c] = category_name(c);
+
+        CorpusSummary summary;
+        summary.testing_docs = static_cast<size_t>(std::llround(static_cast<double>(config.num_docs) * config.testing_fraction));
+        summary.training_docs = config.num_docs - summary.testing_docs;
+
+        const std::string header{"category,text\n"};
+        training << header;
+        summary.bytes += header.size();
+
+        ZipfSampler zipf{config.vocabulary_size, config.zipf_exponent};
+
+        std::vector<std::string> texts(std::min(BATCH_DOCS, config.num_docs));
+        std::vector<size_t> categories(texts.size());
+        std::vector<size_t> lengths(texts.size());
+
+        for (size_t first = 0; first < config.num_docs; first += BATCH_DOCS) {
+            size_t count = std::min(BATCH_DOCS, config.num_docs - first);
+
+            thread_pool.parallel_for(count, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    texts[i] = std::string{}; // a slot must not keep the capacity of the longest document it held
+                    categories[i] = generate_document(config, zipf, first + i, texts[i], lengths[i]);
+                }
+            });
+
+            for (size_t i = 0; i < count; i++) {
+                const std::string& name = names[categories[i]];
+                if (first + i < summary.training_docs) {
+                    training << name << ',' << texts[i] << '\n';
+                    summary.bytes += name.size() + texts[i].size() + 2;
+                } else {
+                    testing << texts[i] << '\n';
+                    correct << name << '\n';
+                    summary.bytes += texts[i].size() + name.size() + 2;
+                }
+                summary.tokens += lengths[i];
+            }
+        }
+
+        training.flush();
+        testing.flush();
+        correct.flush();
+        if (!training || !testing || !correct)
+            throw std::runtime_error("Error writing generated corpus to: " + prefix);
+
+        return summary;
+    }
+
+    extern CorpusSummary write_corpus(const CorpusConfig& config, const std::string& folder) {
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        return write_corpus(config, folder, thread_pool);
+    }
+
+} // namespace gen
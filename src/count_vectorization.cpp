@@ -5,51 +5,65 @@
 #include "count_vectorization.hpp"
 #include "preprocess.hpp"
 #include "categories.hpp"
-#include <set>
+#include "stem_cache.hpp"
+#include "flat_counter.hpp"
+#include "stopwords.hpp"
+#include "profiler.hpp"
 
 std::atomic<int> doc_id_count{0}; // document id 
 
-/* words that carry no value and are voided 
- * used from https://towardsdatascience.com/building-a-cross-platform-tfidf-text-summarizer-in-rust-7b05938f4507
-*/
-static const std::set<std::string> STOPWORDS{
-    "me", "my", "myself", "we", "our", "ours", "ourselves", "you", "your", 
-    "yours", "yourself", "yourselves", "he", "him", "his", "himself", "she", 
-    "her", "hers", "herself", "it", "its", "itself", "they", "them", "their", 
-    "theirs", "themselves", "what", "which", "who", "whom", "this", "that", 
-    "these", "those", "am", "is", "are", "was", "were", "be", "been", "being", 
-    "have", "has", "had", "having", "do", "does", "did", "doing", "an", "the", 
-    "and", "but", "if", "or", "because", "as", "until", "while", "of", "at", 
-    "by", "for", "with", "about", "against", "between", "into", "through", 
-    "during", "before", "after", "above", "below", "to", "from", "up", "down", 
-    "in", "out", "on", "off", "over", "under", "again", "further", "then", "oh",
-    "once", "here", "there", "when", "where", "why", "how", "all", "any", 
-    "both", "each", "few", "more", "most", "other", "some", "such", "no", 
-    "nor", "not", "only", "own", "same", "so", "than", "too", "very", "can", 
-    "will", "just", "don", "should", "now", "a", "b", "c", "d", "e", "f", 
-    "g", "h", "i", "j", "k", "l", "m", "n", "o", "p", "q", "r", "s", "t", "u",
-    "v", "w", "x", "y", "z"
-};
+extern bool is_stopword(const std::string& stem) {
+    return stopwords::active().contains(stem);
+}
+
+/* Maps a stemmed term to its vocabulary id,
+ * stopwords map to UNKNOWN_TERM and are 
+ * skipped. Only called by the stem cache 
+ * on the first sighting of a token.
+ */
+static vocab::term_id resolve_stem(const std::string& word) {
+    if (is_stopword(word))
+        return vocab::UNKNOWN_TERM;
+
+    return vocab::vocabulary.intern(word);
+}
 
 /* Increments term count in a Document.
- * Ignores words in STOPWORDS, does NOT 
- * remove them from the text. 
+ * Ignores stopwords, does NOT remove 
+ * them from the text. 
  * Also, prunes the text before checking 
- * against STOPWORDS. Pruning must be done
- * AFTER tokenizing a term.
+ * against the stopwords. Pruning must be done
+ * AFTER tokenizing a term. The tokenizer
+ * lowercases and strips punctuation/digits
+ * in the same pass. Terms are counted by
+ * their id in the shared vocabulary, tokens
+ * seen before skip the stemmer entirely.
  */
-static void count_words_doc(docs::Document * doc) {
-    std::istringstream iss(doc->text);
-    std::string word;
-
-    while (iss >> word) {
-        word = preprocess_prune_term(word);
-        if (STOPWORDS.count(word) == 0) {
-            doc->term_count[word]++;
-            doc->total_terms++;
-        } else 
-            doc->term_count.erase(word);
+extern void count_words_doc(docs::Document * doc) {
+    // reused by every document of the thread, allocates only to outgrow the largest one
+    static thread_local flat::TermCounter counter;
+    counter.clear();
+
+    {
+        PROF_SCOPE("vectorization/tokenize");
+        preprocess::Tokenizer tokenizer{doc->raw_text()};
+        std::string_view token;
+
+        while (tokenizer.next(token)) {
+            vocab::term_id id = stem::stem_cache.lookup(token, resolve_stem);
+            if (id != vocab::UNKNOWN_TERM) {
+                counter.increment(id);
+                doc->total_terms++;
+            }
+        }
     }
+
+    // one node per distinct term, into a table sized once
+    PROF_SCOPE("vectorization/count");
+    doc->term_count.reserve(doc->term_count.size() + counter.size());
+    counter.for_each([doc](vocab::term_id id, int count) {
+        doc->term_count[id] += count;
+    });
 }
 
 // preprocess and vectorize a document (helper for threaded)
@@ -57,7 +71,6 @@ static void vectorize_doc_parallel(docs::Document * doc) {
     doc->document_id = doc_id_count.load(std::memory_order_acquire);
     doc_id_count.fetch_add(1, std::memory_order_release);
 
-    preprocess_text(doc);
     count_words_doc(doc);
     (*doc).calculate_term_frequency_doc();
 }
@@ -65,49 +78,31 @@ static void vectorize_doc_parallel(docs::Document * doc) {
 
 // preprocess and vectorize a document sequenitally
 static void vectorize_doc_sequenital(docs::Document * doc) {
-    preprocess_text(doc);
     count_words_doc(doc);
     (*doc).calculate_term_frequency_doc();
 }
 
 
-// main vectorization function for parallel execution
-extern void vectorize_corpus_threaded(corpus::Corpus * corpus) {
-    std::vector<std::thread> threads;
-
-    for (auto& document : (*corpus).documents) {
-        threads.emplace_back(std::thread(vectorize_doc_parallel, &document));
-    }
+// main vectorization function for parallel execution, one task per few documents
+extern void vectorize_corpus_threaded(corpus::Corpus * corpus, tpool::ThreadPool& thread_pool) {
+    thread_pool.parallel_for(corpus->documents.size(), [corpus](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            vectorize_doc_parallel(&(corpus->documents[i]));
+    });
+}
 
-    for (auto& t : threads)
-        t.join();
-    // corpus->num_of_docs.store(doc_id_count.load(memory_order_acquire));
+extern void vectorize_corpus_threaded(corpus::Corpus * corpus) {
+    tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+    vectorize_corpus_threaded(corpus, thread_pool);
 }
 
-// main vectorization function for parallel execution
 extern void vectorize_corpus_threaded(corpus::Corpus * corpus, int num_threads) {
-    std::vector<std::thread> threads;
-
-    unsigned number_of_docs_in_thread = corpus->get_number_of_docs_per_thread(num_threads);
-    unsigned number_of_docs_in_last_thread = corpus->num_of_docs % number_of_docs_in_thread;
-
-    for (int i = 0; i < corpus->num_of_docs; i+=number_of_docs_in_thread) {
-        threads.emplace_back([&corpus, i, number_of_docs_in_thread, number_of_docs_in_last_thread]() {
-            if (i == corpus->num_of_docs - number_of_docs_in_thread && number_of_docs_in_last_thread > 0) {
-                for (unsigned x = 0; x < number_of_docs_in_last_thread; x++) 
-                    if (i + x < corpus->num_of_docs)
-                        vectorize_doc_parallel(&(corpus->documents[x+i]));
-            } else {
-                for (unsigned x = 0; x < number_of_docs_in_thread; x++) 
-                    if (i + x < corpus->num_of_docs)
-                        vectorize_doc_parallel(&(corpus->documents[x+i]));
-            }
-        });
-    }
+    tpool::ThreadPool thread_pool{tpool::workers_for(num_threads)};
+    vectorize_corpus_threaded(corpus, thread_pool);
+}
 
-    for (auto& t : threads)
-        t.join();
-    // corpus->num_of_docs.store(doc_id_count.load(memory_order_acquire));
+extern void vectorize_document(docs::Document * doc) {
+    vectorize_doc_sequenital(doc);
 }
 
 // main vectorization function for sequential execution
@@ -4,15 +4,21 @@
 
 #include "document.hpp"
 #include "categories.hpp"
+#include "profiler.hpp"
+#include <algorithm>
 #include <fstream>
 
 namespace docs {
 
     bool Document::is_term(std::string str) {
-        return term_count.find(str) != term_count.end();
+        return is_term(vocab::vocabulary.find(str));
     }
 
-    double Document::calculate_term_frequency(std::string term) {
+    bool Document::is_term(vocab::term_id id) const {
+        return term_count.find(id) != term_count.end();
+    }
+
+    double Document::calculate_term_frequency(vocab::term_id term) {
         if (total_terms == 0) 
             return 0.0;
 
@@ -20,6 +26,8 @@ namespace docs {
     }
 
     void Document::calculate_term_frequency_doc() {
+        PROF_SCOPE("vectorization/term_frequency");
+        term_frequency.reserve(term_count.size()); // no rehash, arenas never reuse old buckets
         for (auto& [word, count] : term_count) 
             term_frequency[word] = calculate_term_frequency(word);
     }
@@ -42,7 +50,7 @@ namespace docs {
     }
 
     std::string Document::print_text() const {
-        return "Text: " + text + "\n";
+        return "Text: " + std::string{raw_text()} + "\n";
     }
     std::string Document::print_number_terms() const {
         return "Number of Terms: " + std::to_string(total_terms) + "\n";
@@ -59,7 +67,7 @@ namespace docs {
                 tf_idf_str += "\n";
             else if (i != 0)
                 tf_idf_str += "\t";
-            tf_idf_str += pair.first + ": " + std::to_string(pair.second) + "\n";
+            tf_idf_str += vocab::vocabulary.term(pair.first) + ": " + std::to_string(pair.second) + "\n";
         }
         tf_idf_str += "\n";
 
@@ -74,7 +82,7 @@ namespace docs {
                 term_count_str += "\n";
             else if (i != 0)
                 term_count_str += "\t";
-            term_count_str += pair.first +" :" + std::to_string(pair.second);
+            term_count_str += vocab::vocabulary.term(pair.first) +" :" + std::to_string(pair.second);
             i++;
         }
         term_count_str += "\n";
@@ -90,128 +98,170 @@ namespace corpus {
         return log(static_cast<double>(num_of_docs) / static_cast<double>(docs_with_term));
     }
 
-    int Corpus::num_doc_term(const std::string& str) {
+    int Corpus::num_doc_term(vocab::term_id id) {
         int count{0};
 
         for (auto& d : documents) 
-            if (d.is_term(str))
+            if (d.is_term(id))
                 count++;
 
         return count;
     }
 
-    void Corpus::tfidf_documents() {
-        std::vector<std::thread> threads;
-        threads.reserve(NUMBER_OF_THREADS_MAX);
+    void Corpus::build_document_frequency(tpool::ThreadPool& thread_pool) {
+        PROF_SCOPE("tfidf/df");
+        size_t number_of_docs{documents.size()};
+        size_t grain = thread_pool.default_grain(number_of_docs);
+        size_t number_of_batches = (number_of_docs + grain - 1) / grain;
+
+        /* each task counts its own batch of documents 
+         * into a local map, no locking needed until merge.
+         */
+        std::vector<std::unordered_map<vocab::term_id, int>> partial_frequency(number_of_batches);
 
-        unsigned number_of_docs_in_thread = get_number_of_docs_per_thread();
-        num_doc_per_thread = number_of_docs_in_thread;
-        unsigned number_of_docs_in_last_thread = num_of_docs % number_of_docs_in_thread;
+        thread_pool.parallel_for(number_of_docs, [this, grain, &partial_frequency](size_t begin, size_t end) {
+            auto& partial = partial_frequency[begin / grain];
+            for (size_t i = begin; i < end; i++)
+                for (const auto& [word, count] : documents[i].term_count)
+                    partial[word]++;
+        }, grain);
 
-        if (num_doc_per_thread == 1) {
-            num_threads_used = num_of_docs;
-        } else {
-            num_threads_used = NUMBER_OF_THREADS_MAX;
-        }
+        document_frequency.assign(vocab::vocabulary.size(), 0);
+        for (auto& partial : partial_frequency)
+            for (const auto& [word, count] : partial)
+                document_frequency[word] += count;
 
-        /* every num_doc_per_thread documents gets their own thread!!
-         * done to reduce contention and resource waste.
-         */
-        for (int i = 0; i < num_of_docs; i+=number_of_docs_in_thread) {
-            threads.emplace_back([this, i, number_of_docs_in_thread, number_of_docs_in_last_thread]() {
-                if (i == num_of_docs - number_of_docs_in_thread && number_of_docs_in_last_thread > 0) {
-                    for (unsigned x = 0; x < number_of_docs_in_last_thread; x++) 
-                        emplace_tfidf_document(&documents[x+i]);
-                } else {
-                    for (unsigned x = 0; x < number_of_docs_in_thread; x++) 
-                        emplace_tfidf_document(&documents[x+i]);
-                }
-            });
+        compute_inverse_document_frequency();
+    }
+
+    void Corpus::build_document_frequency_seq() {
+        PROF_SCOPE("tfidf/df");
+        document_frequency.assign(vocab::vocabulary.size(), 0);
+
+        for (const auto& document : documents)
+            for (const auto& [word, count] : document.term_count)
+                document_frequency[word]++;
+
+        compute_inverse_document_frequency();
+    }
+
+    void Corpus::compute_inverse_document_frequency() {
+        inverse_document_frequency.assign(document_frequency.size(), 0.0);
+        num_unique_terms = 0;
+
+        // terms only seen by other corpora sharing the vocabulary keep an idf of 0
+        for (size_t word = 0; word < document_frequency.size(); word++) {
+            if (document_frequency[word] == 0)
+                continue;
+
+            inverse_document_frequency[word] = idf_corpus(document_frequency[word]);
+            num_unique_terms++;
         }
+    }
 
-        for (auto& t : threads)
-            t.join();
+    void Corpus::tfidf_documents() {
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        tfidf_documents(thread_pool);
     }
 
     void Corpus::tfidf_documents(int num_threads) {
-        std::vector<std::thread> threads;
+        tpool::ThreadPool thread_pool{tpool::workers_for(num_threads)};
+        tfidf_documents(thread_pool);
+    }
 
-        unsigned number_of_docs_in_thread = get_number_of_docs_per_thread(num_threads);
-        num_doc_per_thread = number_of_docs_in_thread;
-        unsigned number_of_docs_in_last_thread = num_of_docs % number_of_docs_in_thread + number_of_docs_in_thread;
+    void Corpus::tfidf_documents(tpool::ThreadPool& thread_pool) {
+        build_document_frequency(thread_pool);
 
-        if (num_doc_per_thread == 1) {
-            num_threads_used = num_of_docs;
-        } else {
-            num_threads_used = num_threads;
-        }
-        
-        /* every num_doc_per_thread documents gets their own thread!!
-         * done to reduce contention and resource waste.
+        PROF_SCOPE("tfidf/weight");
+        num_threads_used = thread_pool.size() + 1; // the waiting thread runs tasks too
+        num_doc_per_thread = thread_pool.default_grain(documents.size());
+
+        /* small batches of documents are queued on the pool, 
+         * idle workers steal batches from busy ones, and 
+         * read the IDF copy of their own NUMA node.
          */
-        for (int i = 0; i < num_of_docs; i+=number_of_docs_in_thread) {
-            threads.emplace_back([this, i, number_of_docs_in_thread, number_of_docs_in_last_thread]() {
-                if (i == num_of_docs - number_of_docs_in_thread && number_of_docs_in_last_thread > 0) {
-                    for (unsigned x = 0; x < number_of_docs_in_last_thread; x++) 
-                        if (x + i < num_of_docs)
-                            emplace_tfidf_document(&documents[x+i]);
-                } else {
-                    for (unsigned x = 0; x < number_of_docs_in_thread; x++) 
-                        if (x + i < num_of_docs)
-                            emplace_tfidf_document(&documents[x+i]);
-                }
-            });
-        }
-        
-        /* TEST */
-        // for (int i = 0; i < num_of_docs; i+=number_of_docs_in_thread) {
-        //     if (i == num_of_docs - number_of_docs_in_thread && number_of_docs_in_last_thread > 0) {
-        //         threads.emplace_back([this, i, number_of_docs_in_last_thread] {
-        //             for (unsigned x = 0; x < number_of_docs_in_last_thread; x++) 
-        //                 if (x + i < num_of_docs)
-        //                     emplace_tfidf_document(&documents[x+i]);
-        //         });
-        //     } else {
-        //         threads.emplace_back([this, i, number_of_docs_in_thread] {
-        //             for (unsigned x = 0; x < number_of_docs_in_thread; x++) 
-        //                 if (x + i < num_of_docs)
-        //                     emplace_tfidf_document(&documents[x+i]);
-        //         });
-        //     }
-        // }
-
-        for (auto& t : threads)
-            t.join();
+        tpool::NodeReplicas<double> idf{inverse_document_frequency.data(), inverse_document_frequency.size(), thread_pool};
+        thread_pool.parallel_for(documents.size(), [this, &idf](size_t begin, size_t end) {
+            IdfTable local_idf{idf.local(), inverse_document_frequency.size()};
+            for (size_t i = begin; i < end; i++)
+                tfidf_document(&documents[i], local_idf);
+        }, num_doc_per_thread);
+    }
+
+    void Corpus::tfidf_documents(const IdfTable& idf, tpool::ThreadPool& thread_pool) {
+        PROF_SCOPE("tfidf/weight");
+        num_threads_used = thread_pool.size() + 1; // the waiting thread runs tasks too
+        num_doc_per_thread = thread_pool.default_grain(documents.size());
+
+        tpool::NodeReplicas<double> replicas{idf.values, idf.size, thread_pool};
+        thread_pool.parallel_for(documents.size(), [this, &idf, &replicas](size_t begin, size_t end) {
+            IdfTable local_idf{replicas.local(), idf.size};
+            for (size_t i = begin; i < end; i++)
+                tfidf_document(&documents[i], local_idf);
+        }, num_doc_per_thread);
+    }
+
+    extern void tfidf_document(docs::Document * document, const IdfTable& idf) {
+        document->tf_idf.reserve(document->term_frequency.size());
+        for (const auto& [word, freq] : document->term_frequency)
+            document->tf_idf[word] = freq * idf[word];
+    }
+
+    void Corpus::tfidf_documents_rescan(int num_threads) {
+        tpool::ThreadPool thread_pool{tpool::workers_for(num_threads)};
+
+        thread_pool.parallel_for(documents.size(), [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                emplace_tfidf_document_rescan(&documents[i]);
+        });
     }
 
     void Corpus::tfidf_documents_not_dynamic() {
-        std::vector<std::thread> threads;
-
-        /* every 10 documents gets their own thread!!
-        * done to reduce contention and resource waste.
-        */
-        for (int i = 0; i < num_of_docs; i+=10) {
-            threads.emplace_back([this, i]() {
-                for (int x = 0; x < 10; x++) 
-                    emplace_tfidf_document(&documents[x+i]);
-            });
-        }
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        build_document_frequency(thread_pool);
+
+        // every 10 documents are one task, whatever the corpus size
+        thread_pool.parallel_for(documents.size(), [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                emplace_tfidf_document(&documents[i]);
+        }, 10);
     }
 
     // sequential
     void Corpus::tfidf_documents_seq() {
+        build_document_frequency_seq();
+
+        PROF_SCOPE("tfidf/weight");
         for (auto& document : documents) 
             emplace_tfidf_document(&document);
     }
 
-    // using a thread insert tfidf into document. 
+    // using a thread insert tfidf into document, one idf lookup per term. 
     void Corpus::emplace_tfidf_document(docs::Document * document) {
+        document->tf_idf.reserve(document->term_frequency.size());
+        for (const auto& [word, freq] : document->term_frequency)
+            document->tf_idf[word] = freq * inverse_document_frequency[word];
+    }
+
+    // original implementation, recounts document frequency for every term
+    void Corpus::emplace_tfidf_document_rescan(docs::Document * document) {
         for (const auto& [word, freq] : document->term_frequency)
             document->tf_idf[word] = freq * idf_corpus(num_doc_term(word));
     }
 
+    void Corpus::add_documents(size_t count) {
+        documents.reserve(documents.size() + count);
+        for (size_t i = 0; i < count; i++)
+            documents.emplace_back(&allocator);
+    }
+
+    void Corpus::release_documents() {
+        std::vector<docs::Document>{}.swap(documents);
+        allocator.release();
+    }
+
     int Corpus::get_num_unique_terms() const {
-        return inverse_document_frequency.size();
+        return num_unique_terms;
     }
 
     unsigned Corpus::get_number_of_docs_per_thread() const {
@@ -257,4 +307,108 @@ namespace corpus {
 
         file.close();
     }
+
+    FrozenCorpus::FrozenCorpus(const Corpus& corpus, tpool::ThreadPool& thread_pool) {
+        size_t number_of_rows = corpus.documents.size();
+        row_category.assign(number_of_rows, -1);
+
+        // row sizes and categories, then prefix sum into offsets
+        matrix.row_offsets.assign(number_of_rows + 1, 0);
+        for (size_t r = 0; r < number_of_rows; r++) {
+            const docs::Document& document = corpus.documents[r];
+            matrix.row_offsets[r + 1] = matrix.row_offsets[r] + document.term_frequency.size();
+
+            if (document.category.empty())
+                continue;
+
+            auto found = std::find(category_types.begin(), category_types.end(), document.category);
+            row_category[r] = static_cast<int>(found - category_types.begin());
+            if (found == category_types.end())
+                category_types.push_back(document.category);
+        }
+
+        matrix.term_ids.resize(matrix.row_offsets.back());
+        matrix.values.resize(matrix.row_offsets.back());
+
+        // rows are disjoint, every task fills its own rows
+        thread_pool.parallel_for(number_of_rows, [this, &corpus](size_t begin, size_t end) {
+            std::vector<std::pair<vocab::term_id, double>> sorted_row;
+
+            for (size_t r = begin; r < end; r++) {
+                const auto& term_frequency = corpus.documents[r].term_frequency;
+                sorted_row.assign(term_frequency.begin(), term_frequency.end());
+                std::sort(sorted_row.begin(), sorted_row.end());
+
+                size_t offset = matrix.row_offsets[r];
+                for (const auto& [word, freq] : sorted_row) {
+                    matrix.term_ids[offset] = word;
+                    matrix.values[offset] = freq;
+                    offset++;
+                }
+            }
+        });
+    }
+
+    void FrozenCorpus::tfidf_documents(tpool::ThreadPool& thread_pool) {
+        size_t number_of_terms = vocab::vocabulary.size();
+        size_t number_of_nonzeros = matrix.num_nonzeros();
+        size_t number_of_slices = thread_pool.size() + 1; // one per thread, the waiting one included
+
+        /* every slice counts a contiguous range of term_ids into 
+         * its own dense array, the arrays are then summed by column.
+         */
+        std::vector<std::vector<int>> partial_frequency(number_of_slices);
+        size_t number_in_slice = (number_of_nonzeros + number_of_slices - 1) / number_of_slices;
+        thread_pool.parallel_for(number_of_slices, [&](size_t first, size_t last) {
+            PROF_SCOPE("tfidf/df");
+            for (size_t slice = first; slice < last; slice++) {
+                partial_frequency[slice].assign(number_of_terms, 0);
+                size_t end = std::min(number_of_nonzeros, (slice + 1) * number_in_slice);
+                for (size_t k = slice * number_in_slice; k < end; k++)
+                    partial_frequency[slice][matrix.term_ids[k]]++;
+            }
+        }, 1);
+
+        document_frequency.assign(number_of_terms, 0);
+        thread_pool.parallel_for(number_of_terms, [&](size_t begin, size_t end) {
+            PROF_SCOPE("tfidf/df");
+            for (size_t word = begin; word < end; word++)
+                for (const auto& partial : partial_frequency)
+                    document_frequency[word] += partial[word];
+        });
+
+        apply_inverse_document_frequency(thread_pool);
+    }
+
+    void FrozenCorpus::apply_inverse_document_frequency(tpool::ThreadPool& thread_pool) {
+        PROF_SCOPE("tfidf/weight");
+        size_t number_of_terms = vocab::vocabulary.size();
+        size_t number_of_nonzeros = matrix.num_nonzeros();
+        double number_of_docs = static_cast<double>(matrix.num_rows());
+
+        document_frequency.resize(number_of_terms, 0);
+        inverse_document_frequency.assign(number_of_terms, 0.0);
+        thread_pool.parallel_for(number_of_terms, [&](size_t begin, size_t end) {
+            for (size_t word = begin; word < end; word++)
+                if (document_frequency[word] > 0)
+                    inverse_document_frequency[word] = log(number_of_docs / document_frequency[word]);
+        });
+
+        tpool::NodeReplicas<double> idf{inverse_document_frequency.data(), number_of_terms, thread_pool};
+        thread_pool.parallel_for(number_of_nonzeros, [this, &idf](size_t begin, size_t end) {
+            const double * local_idf = idf.local();
+            for (size_t k = begin; k < end; k++)
+                matrix.values[k] *= local_idf[matrix.term_ids[k]];
+        });
+    }
+
+    void FrozenCorpus::apply_inverse_document_frequency(const IdfTable& idf, tpool::ThreadPool& thread_pool) {
+        PROF_SCOPE("tfidf/weight");
+        tpool::NodeReplicas<double> replicas{idf.values, idf.size, thread_pool};
+        thread_pool.parallel_for(matrix.num_nonzeros(), [this, &idf, &replicas](size_t begin, size_t end) {
+            IdfTable local_idf{replicas.local(), idf.size};
+            for (size_t k = begin; k < end; k++)
+                matrix.values[k] *= local_idf[matrix.term_ids[k]];
+        });
+    }
 } // corpus namespace
\ No newline at end of file
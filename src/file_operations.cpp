@@ -5,6 +5,7 @@
 #include "file_operations.hpp"
 #include "categories.hpp"
 #include "utils.hpp"
+#include "profiler.hpp"
 #include <fstream>
 
 static std::string input_file_name;
@@ -36,84 +37,148 @@ static std::string input_file_name;
 /* --- Constants --- */
 
 
-// return std::pair of first split from csv 'category, text'
-static std::pair<std::string, std::string> split_string(const std::string& str, const char& splitter) {
-    size_t comma_pos = str.find(splitter);
+/* Reads one CSV field starting at pos and moves pos past 
+ * its comma. Quoted fields are returned without their quotes, 
+ * escaped is set when they hold "" that still need unescaping.
+ * Only a quote at pos opens a quoted field, any other quote is 
+ * text, the same rule io::index_records() splits records by.
+ */
+static std::string_view parse_csv_field(std::string_view record, size_t& pos, bool& escaped) {
+    escaped = false;
+
+    if (pos < record.size() && record[pos] == '"') {
+        size_t begin = pos + 1;
+        size_t i = begin;
+        while (i < record.size()) {
+            if (record[i] == '"' && i + 1 < record.size() && record[i + 1] == '"') {
+                escaped = true;
+                i += 2;
+            } else if (record[i] == '"') {
+                break;
+            } else {
+                i++;
+            }
+        }
+
+        std::string_view field = record.substr(begin, i - begin);
+        pos = record.find(',', i);
+        pos = pos == std::string_view::npos ? record.size() : pos + 1;
+        return field;
+    }
+
+    size_t comma = record.find(',', pos);
+    size_t end = comma == std::string_view::npos ? record.size() : comma;
+    std::string_view field = record.substr(pos, end - pos);
+    pos = comma == std::string_view::npos ? record.size() : comma + 1;
 
-    if (comma_pos == std::string::npos)
-        return {str, ""};
-        
-    return {str.substr(0, comma_pos), str.substr(comma_pos + 1)};
+    return field;
 }
 
-// return a new docs::Document object with inputted text and category
-static docs::Document create_document(std::string text, std::string category) {
-    docs::Document new_document;
-    new_document.text = text;
-    new_document.category = category;
+// replace "" with " in a quoted field
+static std::string unescape_csv_field(std::string_view field) {
+    std::string unescaped;
+    unescaped.reserve(field.size());
+
+    for (size_t i = 0; i < field.size(); i++) {
+        unescaped.push_back(field[i]);
+        if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"')
+            i++;
+    }
 
-    return new_document;
+    return unescaped;
 }
 
-// main function to read in training data
-extern void read_csv_to_corpus(corpus::Corpus& corpus, const std::string& file_name) {
+/* Fills a Document from a 'category,text' record. The text is 
+ * everything after the first comma outside quotes, unquoted when 
+ * it is a single quoted field, and stays a view into the mapped 
+ * file unless it holds escaped quotes.
+ */
+extern void parse_csv_record(std::string_view record, docs::Document& document) {
+    size_t pos{0};
+    bool escaped{false};
+
+    std::string_view category = parse_csv_field(record, pos, escaped);
+    document.category = escaped ? unescape_csv_field(category) : std::string{category};
+
+    std::string_view text = record.substr(pos);
+    if (!text.empty() && text.front() == '"') {
+        size_t text_pos{0};
+        std::string_view field = parse_csv_field(text, text_pos, escaped);
+
+        // only a lone quoted field is unquoted, anything else is kept as is
+        if (field.size() + 2 == text.size() && text.back() == '"') {
+            if (escaped)
+                document.text = unescape_csv_field(field);
+            else
+                document.text_view = field;
+            return;
+        }
+    }
+
+    document.text_view = text;
+}
+
+extern void read_csv_to_corpus(corpus::Corpus& corpus, const std::string& file_name, tpool::ThreadPool& thread_pool) {
+    PROF_SCOPE("read");
     
     // set the global input file name
     input_file_name = file_name.substr(file_name.find('/') + 1);
     input_file_name = input_file_name.substr(0, input_file_name.find('.'));
 
-    std::ifstream file(file_name);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("file cannot be opened...");
-    }
+    auto file = std::make_shared<const io::MappedFile>(file_name);
+    std::vector<std::string_view> records = io::index_records(file->view(), true, thread_pool);
 
-    std::string line;
-    int i{0};
-    while (getline(file, line)) {
-        
-        // ignore header
-        if (i == 0) {
-            i += 1;
-            continue;
-        }
+    // ignore header
+    size_t number_of_docs = records.empty() ? 0 : records.size() - 1;
+    size_t first_doc = corpus.documents.size();
+    corpus.add_documents(number_of_docs);
+    thread_pool.place_on_nodes(corpus.documents.data() + first_doc, number_of_docs); // each NUMA node holds the documents it parses
 
-        std::pair<std::string, std::string> split = split_string(line, ',');
-        std::string category = split.first;
+    thread_pool.parallel_for(number_of_docs, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            parse_csv_record(records[i + 1], corpus.documents[first_doc + i]);
+    });
 
-        if (corpus.category_types_set.insert(category).second) {
+    for (size_t i = first_doc; i < corpus.documents.size(); i++) {
+        if (corpus.category_types_set.insert(corpus.documents[i].category).second) {
             corpus.num_of_categories++;
         }
+    }
 
-        corpus.documents.push_back(create_document(split.second, split.first));
-        i += 1;
-    }   
-    i -= 1;
-    
-    corpus.num_of_docs.store(i);
-    file.close();
+    corpus.mapped_files.push_back(std::move(file));
+    corpus.num_of_docs.store(static_cast<int>(corpus.documents.size())); // every document, earlier files included
 }    
 
+extern void read_csv_to_corpus(corpus::Corpus& corpus, const std::string& file_name) {
+    tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+    read_csv_to_corpus(corpus, file_name, thread_pool);
+}
+
 extern std::string get_input_file_name() {
     return input_file_name;
 }
 
-extern void read_unknown_text(corpus::Corpus& corpus, const std::string& file_name) {
-    std::ifstream file{file_name};
-
-    if (!file.is_open())
-        throw std::runtime_error("file cannot be opened...");
-    
-    std::string line;
-    int i{0};
-    while (getline(file, line)) {
-
-        corpus.documents.push_back(create_document(line, ""));
-        i++;
-    }
+extern void read_unknown_text(corpus::Corpus& corpus, const std::string& file_name, tpool::ThreadPool& thread_pool) {
+    PROF_SCOPE("read");
+    auto file = std::make_shared<const io::MappedFile>(file_name);
+    std::vector<std::string_view> records = io::index_records(file->view(), false, thread_pool);
+
+    // one document per line, each a view into the mapped file
+    size_t first_doc = corpus.documents.size();
+    corpus.add_documents(records.size());
+    thread_pool.place_on_nodes(corpus.documents.data() + first_doc, records.size());
+    thread_pool.parallel_for(records.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            corpus.documents[first_doc + i].text_view = records[i];
+    });
+
+    corpus.mapped_files.push_back(std::move(file));
+    corpus.num_of_docs.store(static_cast<int>(corpus.documents.size()));
+}
 
-    corpus.num_of_docs.store(i);
-    file.close();
+extern void read_unknown_text(corpus::Corpus& corpus, const std::string& file_name) {
+    tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+    read_unknown_text(corpus, file_name, thread_pool);
 }
 
 extern std::vector<std::string> read_unknown_cats(const std::string& file_name) {
@@ -131,47 +196,19 @@ extern std::vector<std::string> read_unknown_cats(const std::string& file_name)
     return correct_cats;
 }
 
-extern void convert_results_txt_to_csv(const std::string& txt_file_name, const std::string& csv_file_name) {
-    std::ifstream file{txt_file_name};
-    if (!file.is_open()) 
-        throw std::runtime_error("Cannot open file: " + txt_file_name);
-
-    std::vector<std::pair<std::string, std::string>> res_pln_txt;
-    std::pair<std::string, std::string> percent_to_end;
-    std::string line;
-
-    while (getline(file, line)) {
-        if (line.find(':') == std::string::npos || line.find('#') != std::string::npos)
-            continue;
-
-        if (line.find('%') != std::string::npos) {
-            std::pair<std::string, std::string> split = split_string(line, ':');
-            percent_to_end = {"Accuracy", split.second.substr(0, split.second.size() - 1)};
-            continue;
-        }
-
-        res_pln_txt.emplace_back(split_string(line, ':'));
-    }
-    res_pln_txt.emplace_back(percent_to_end);
-    file.close();
-
+extern void write_processed_csv(const std::string& csv_file_name, const std::array<double, 4>& section_durations, double accuracy) {
     std::ofstream out_file(csv_file_name, std::ios::app);
     if (!out_file) 
         throw std::runtime_error("Error writing to CSV: " + csv_file_name);
 
     out_file.seekp(0, std::ios::end);
     if (out_file.tellp() == 0)
-        out_file << "Vectorization,TF-IDF,Categories,Unknown Classification,Accuracy\n";
-
-    std::unordered_map<std::string, std::string> section_mapping;
-    for (const auto& sec_time : res_pln_txt) {
-        std::string no_ms_time = sec_time.second.substr(1, sec_time.second.find(" ms") - 1);
-        section_mapping[sec_time.first] = no_ms_time;
-    }
-
-    out_file << section_mapping["Vectorization"] << ","
-             << section_mapping["TF-IDF"] << ","
-             << section_mapping["Categories"] << ","
-             << section_mapping["Unknown Classification"] << ","
-             << section_mapping["Accuracy"] << std::endl;
+        out_file << SECTION_NAME[vectorization_] << "," << SECTION_NAME[tfidf_] << "," 
+                 << SECTION_NAME[categories_] << "," << SECTION_NAME[unknown_] << ",Accuracy\n";
+
+    out_file << section_durations[vectorization_] << ","
+             << section_durations[tfidf_] << ","
+             << section_durations[categories_] << ","
+             << section_durations[unknown_] << ","
+             << accuracy << std::endl;
 }
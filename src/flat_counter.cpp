@@ -0,0 +1,58 @@
+/* flat_counter.cpp
+ * source file for flat_counter.hpp
+ */
+
+#include "flat_counter.hpp"
+
+namespace flat {
+
+    TermCounter::TermCounter(size_t initial_capacity) {
+        size_t capacity{GROUP_SIZE};
+        while (capacity < initial_capacity)
+            capacity *= 2;
+        allocate(capacity);
+    }
+
+    int TermCounter::count(vocab::term_id id) const {
+        uint64_t hash = hash_id(id);
+        int8_t tag = static_cast<int8_t>(hash & 0x7f);
+        size_t group = (hash >> 7) & group_mask;
+
+        while (true) {
+            const int8_t * group_control = control.data() + group * GROUP_SIZE;
+            for (uint32_t matches = match_byte(group_control, tag); matches != 0; matches &= matches - 1) {
+                size_t slot = group * GROUP_SIZE + __builtin_ctz(matches);
+                if (keys[slot] == id)
+                    return counts[slot];
+            }
+            if (match_byte(group_control, EMPTY) != 0)
+                return 0;
+            group = (group + 1) & group_mask;
+        }
+    }
+
+    void TermCounter::allocate(size_t capacity) {
+        control.assign(capacity, EMPTY);
+        keys.resize(capacity);
+        counts.resize(capacity);
+        used_slots.reserve(capacity);
+        group_mask = capacity / GROUP_SIZE - 1;
+    }
+
+    void TermCounter::grow() {
+        std::vector<vocab::term_id> old_keys;
+        std::vector<int> old_counts;
+        old_keys.reserve(used_slots.size());
+        old_counts.reserve(used_slots.size());
+        for (uint32_t slot : used_slots) {
+            old_keys.push_back(keys[slot]);
+            old_counts.push_back(counts[slot]);
+        }
+
+        used_slots.clear();
+        allocate(control.size() * 2);
+        for (size_t i = 0; i < old_keys.size(); i++)
+            counts[find_or_insert(old_keys[i])] = old_counts[i];
+    }
+
+} // namespace flat
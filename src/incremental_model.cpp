@@ -0,0 +1,114 @@
+/* incremental_model.cpp
+ * source file for incremental_model.hpp
+ */
+
+#include "incremental_model.hpp"
+#include "sparse_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cats {
+
+    void IncrementalModel::add_documents(const corpus::FrozenCorpus& batch, tpool::ThreadPool& thread_pool) {
+        const sparse::CsrMatrix& matrix = batch.matrix;
+        size_t number_of_terms = std::max(vocab::vocabulary.size(), document_frequency.size());
+
+        // batch category index to model category index
+        std::vector<size_t> category_of(batch.category_types.size());
+        for (size_t c = 0; c < batch.category_types.size(); c++) {
+            auto found = std::find(category_types.begin(), category_types.end(), batch.category_types[c]);
+            category_of[c] = static_cast<size_t>(found - category_types.begin());
+            if (found == category_types.end()) {
+                category_types.push_back(batch.category_types[c]);
+                category_docs.push_back(0);
+                term_sums.emplace_back();
+            }
+        }
+
+        document_frequency.resize(number_of_terms, 0);
+        for (vocab::term_id word : matrix.term_ids)
+            document_frequency[word]++; // every term appears once per row
+        number_of_docs += matrix.num_rows();
+
+        // rows of every category in row order, so each category only visits its own rows
+        std::vector<std::vector<size_t>> category_rows(category_types.size());
+        for (size_t r = 0; r < matrix.num_rows(); r++)
+            if (batch.row_category[r] >= 0)
+                category_rows[category_of[batch.row_category[r]]].push_back(r);
+
+        // the recurrence runs in row order within a category, categories are independent
+        thread_pool.parallel_for(category_types.size(), [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                std::vector<double>& sums = term_sums[c];
+                sums.resize(number_of_terms, 0.0);
+
+                for (size_t r : category_rows[c]) {
+                    sparse::RowView row = matrix.row(r);
+                    for (size_t k = 0; k < row.size; k++)
+                        sums[row.term_ids[k]] = (sums[row.term_ids[k]] + row.values[k]) / row.size;
+                }
+                category_docs[c] += category_rows[c].size();
+            }
+        }, 1);
+
+        inverse_document_frequency.assign(number_of_terms, 0.0);
+        double docs = static_cast<double>(number_of_docs);
+        for (size_t word = 0; word < number_of_terms; word++)
+            if (document_frequency[word] > 0)
+                inverse_document_frequency[word] = log(docs / document_frequency[word]);
+    }
+
+    centroids_s IncrementalModel::centroids(tpool::ThreadPool& thread_pool) const {
+        centroids_s result;
+        size_t number_of_categories = category_types.size();
+
+        result.category_types = category_types;
+        result.weights.resize(number_of_categories);
+        result.norms.resize(number_of_categories);
+
+        thread_pool.parallel_for(number_of_categories, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                const std::vector<double>& sums = term_sums[c];
+                std::vector<double>& weights = result.weights[c];
+
+                weights.assign(std::max(sums.size(), vocab::vocabulary.size()), 0.0);
+                for (size_t t = 0; t < sums.size(); t++)
+                    weights[t] = inverse_document_frequency[t] * sums[t];
+                result.norms[c] = sqrt(sparse::squared_norm(weights.data(), weights.size()));
+            }
+        }, 1);
+
+        return result;
+    }
+}
+
+/* Incremental Functions */
+namespace cats::incremental { // namespace cats::incremental
+
+    static double relative_difference(double expected, double actual) {
+        double scale = std::max(std::fabs(expected), std::fabs(actual));
+        return scale == 0.0 ? 0.0 : std::fabs(expected - actual) / scale;
+    }
+
+    extern double max_relative_difference(const centroids_s& expected, const centroids_s& actual) {
+        if (expected.category_types != actual.category_types)
+            return std::numeric_limits<double>::infinity();
+
+        double max_difference{0.0};
+        for (size_t c = 0; c < expected.category_types.size(); c++) {
+            max_difference = std::max(max_difference, relative_difference(expected.norms[c], actual.norms[c]));
+
+            const std::vector<double>& expected_weights = expected.weights[c];
+            const std::vector<double>& actual_weights = actual.weights[c];
+            size_t number_of_terms = std::max(expected_weights.size(), actual_weights.size());
+            for (size_t t = 0; t < number_of_terms; t++) {
+                double expected_weight = t < expected_weights.size() ? expected_weights[t] : 0.0;
+                double actual_weight = t < actual_weights.size() ? actual_weights[t] : 0.0;
+                max_difference = std::max(max_difference, relative_difference(expected_weight, actual_weight));
+            }
+        }
+
+        return max_difference;
+    }
+}
@@ -0,0 +1,196 @@
+/* mapped_file.cpp
+ * source file for mapped_file.hpp
+ */
+
+#include "mapped_file.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+
+    static constexpr size_t MIN_CHUNK_SIZE{1 << 16}; // smaller files are not worth splitting
+
+    MappedFile::MappedFile(const std::string& file_name) {
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("file cannot be opened...");
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw std::runtime_error("file cannot be opened...");
+        }
+
+        length = static_cast<size_t>(file_stat.st_size);
+        if (length > 0) {
+            void * mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("file cannot be mapped: " + file_name);
+            }
+
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data != nullptr)
+            munmap(const_cast<char *>(data), length);
+    }
+
+    void MappedFile::release(size_t begin, size_t end) const {
+        if (data == nullptr)
+            return;
+
+        size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t first_page = (begin + page_size - 1) / page_size * page_size;
+        size_t last_page = std::min(end, length) / page_size * page_size;
+
+        if (first_page < last_page)
+            madvise(const_cast<char *>(data) + first_page, last_page - first_page, MADV_DONTNEED);
+    }
+
+    /* CSV record scanning state, a quote only opens a quoted field
+     * as the first character of a field, anywhere else it is text
+     */
+    enum CsvState : uint8_t { FIELD_START, UNQUOTED, QUOTED, QUOTE_IN_QUOTED, NUMBER_OF_CSV_STATES };
+
+    static CsvState csv_step(CsvState state, char c) {
+        bool ends_field = c == ',' || c == '\n';
+        switch (state) {
+            case FIELD_START:
+                return c == '"' ? QUOTED : ends_field ? FIELD_START : UNQUOTED;
+            case UNQUOTED:
+                return ends_field ? FIELD_START : UNQUOTED;
+            case QUOTED:
+                return c == '"' ? QUOTE_IN_QUOTED : QUOTED;
+            case QUOTE_IN_QUOTED: // "" is an escaped quote, anything else closes the field
+                return c == '"' ? QUOTED : ends_field ? FIELD_START : UNQUOTED;
+            default:
+                return state;
+        }
+    }
+
+    using CsvTransitions = std::array<CsvState, NUMBER_OF_CSV_STATES>;
+
+    // state at end of [begin, end) for every state it may start in
+    static CsvTransitions csv_transitions(std::string_view text, size_t begin, size_t end) {
+        CsvTransitions states{FIELD_START, UNQUOTED, QUOTED, QUOTE_IN_QUOTED};
+        for (size_t i = begin; i < end; i++)
+            for (CsvState& state : states)
+                state = csv_step(state, text[i]);
+
+        return states;
+    }
+
+    // offsets of every record ending newline in [begin, end)
+    static void find_record_ends(std::string_view text, size_t begin, size_t end, CsvState state, bool quote_aware, std::vector<size_t>& ends) {
+        if (!quote_aware) {
+            const char * position = text.data() + begin;
+            const char * last = text.data() + end;
+            while ((position = static_cast<const char *>(memchr(position, '\n', last - position))) != nullptr) {
+                ends.push_back(position - text.data());
+                position++;
+            }
+            return;
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            if (text[i] == '\n' && state != QUOTED)
+                ends.push_back(i);
+            state = csv_step(state, text[i]);
+        }
+    }
+
+    extern std::vector<std::string_view> index_records(std::string_view text, bool quote_aware, tpool::ThreadPool& thread_pool) {
+        size_t number_of_chunks = std::max<size_t>(1, std::min<size_t>(text.size() / MIN_CHUNK_SIZE, (thread_pool.size() + 1) * 4));
+        std::vector<size_t> chunk_begin(number_of_chunks + 1);
+        for (size_t c = 0; c <= number_of_chunks; c++)
+            chunk_begin[c] = text.size() * c / number_of_chunks;
+
+        /* every chunk maps each state it may start in to the one
+         * it ends in, chaining the maps gives each chunk's real start
+         */
+        std::vector<CsvState> start_states(number_of_chunks, FIELD_START);
+        if (quote_aware) {
+            std::vector<CsvTransitions> transitions(number_of_chunks);
+            thread_pool.parallel_for(number_of_chunks, [&](size_t begin, size_t end) {
+                for (size_t c = begin; c < end; c++)
+                    transitions[c] = csv_transitions(text, chunk_begin[c], chunk_begin[c + 1]);
+            }, 1);
+
+            for (size_t c = 1; c < number_of_chunks; c++)
+                start_states[c] = transitions[c - 1][start_states[c - 1]];
+        }
+
+        std::vector<std::vector<size_t>> chunk_ends(number_of_chunks);
+        thread_pool.parallel_for(number_of_chunks, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++)
+                find_record_ends(text, chunk_begin[c], chunk_begin[c + 1], start_states[c], quote_aware, chunk_ends[c]);
+        }, 1);
+
+        size_t number_of_records{1};
+        for (const auto& ends : chunk_ends)
+            number_of_records += ends.size();
+
+        std::vector<std::string_view> records;
+        records.reserve(number_of_records);
+
+        size_t record_begin{0};
+        auto add_record = [&](size_t record_end) {
+            std::string_view record = text.substr(record_begin, record_end - record_begin);
+            if (!record.empty() && record.back() == '\r')
+                record.remove_suffix(1);
+            records.push_back(record);
+        };
+
+        for (const auto& ends : chunk_ends) {
+            for (size_t record_end : ends) {
+                add_record(record_end);
+                record_begin = record_end + 1;
+            }
+        }
+
+        // last line without a newline
+        if (record_begin < text.size())
+            add_record(text.size());
+
+        return records;
+    }
+
+    extern bool next_record(std::string_view text, size_t& position, bool quote_aware, std::string_view& record) {
+        if (position >= text.size())
+            return false;
+
+        size_t end{position};
+        if (quote_aware) {
+            CsvState state{FIELD_START};
+            while (end < text.size() && (text[end] != '\n' || state == QUOTED)) {
+                state = csv_step(state, text[end]);
+                end++;
+            }
+        } else {
+            end = text.find('\n', position);
+            if (end == std::string_view::npos)
+                end = text.size();
+        }
+
+        record = text.substr(position, end - position);
+        if (!record.empty() && record.back() == '\r')
+            record.remove_suffix(1);
+
+        position = end + 1;
+        return true;
+    }
+
+} // namespace io
@@ -0,0 +1,146 @@
+/* numa.cpp
+ * source file for numa.hpp
+ */
+
+#include "numa.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace numa {
+
+    static constexpr int MPOL_MF_MOVE_PAGES{1 << 1}; // MPOL_MF_MOVE of <numaif.h>, which needs libnuma's headers
+
+    static bool read_line(const std::string& file_name, std::string& line) {
+        std::ifstream file{file_name};
+        return file.is_open() && static_cast<bool>(std::getline(file, line));
+    }
+
+    Topology Topology::detect(const std::string& sysfs_root) {
+        std::string online;
+        if (!read_line(sysfs_root + "/online", online))
+            return single_node();
+
+        std::vector<unsigned> allowed = allowed_cpus();
+        std::vector<Node> nodes;
+
+        try {
+            for (unsigned id : parse_cpu_list(online)) {
+                std::string cpulist;
+                if (!read_line(sysfs_root + "/node" + std::to_string(id) + "/cpulist", cpulist))
+                    continue;
+
+                // memory-only nodes and CPUs outside the affinity mask are skipped
+                Node node{static_cast<int>(id), {}};
+                for (unsigned cpu : parse_cpu_list(cpulist))
+                    if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+                        node.cpus.push_back(cpu);
+                if (!node.cpus.empty())
+                    nodes.push_back(std::move(node));
+            }
+        } catch (std::invalid_argument&) {
+            return single_node();
+        }
+
+        return nodes.empty() ? single_node() : Topology{std::move(nodes)};
+    }
+
+    Topology Topology::single_node() {
+        return Topology{{Node{0, allowed_cpus()}}};
+    }
+
+    size_t Topology::num_cpus() const {
+        size_t count{0};
+        for (const Node& node : node_list)
+            count += node.cpus.size();
+        return count;
+    }
+
+    extern std::vector<unsigned> parse_cpu_list(const std::string& list) {
+        std::vector<unsigned> cpus;
+        size_t pos{0};
+
+        while (pos < list.size() && list[pos] != '\n') {
+            size_t used{0};
+            unsigned first = static_cast<unsigned>(std::stoul(list.substr(pos), &used));
+            unsigned last = first;
+            pos += used;
+
+            if (pos < list.size() && list[pos] == '-') {
+                last = static_cast<unsigned>(std::stoul(list.substr(pos + 1), &used));
+                pos += used + 1;
+            }
+            if (last < first)
+                throw std::invalid_argument("Malformed CPU list: " + list);
+
+            for (unsigned cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+
+            if (pos < list.size() && list[pos] == ',')
+                pos++;
+            else if (pos < list.size() && list[pos] != '\n')
+                throw std::invalid_argument("Malformed CPU list: " + list);
+        }
+
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return cpus;
+    }
+
+    extern std::vector<unsigned> allowed_cpus() {
+        std::vector<unsigned> cpus;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+        }
+
+        if (cpus.empty())
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+                cpus.push_back(cpu);
+
+        return cpus;
+    }
+
+    extern bool pin_current_thread(unsigned cpu) {
+        if (cpu >= CPU_SETSIZE)
+            return false;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    extern bool move_to_node(const void * begin, size_t bytes, int node) {
+#if defined(SYS_move_pages)
+        if (bytes == 0)
+            return true;
+
+        uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uintptr_t first = reinterpret_cast<uintptr_t>(begin) & ~(page_size - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(begin) + bytes;
+
+        std::vector<void *> pages;
+        for (uintptr_t page = first; page < end; page += page_size)
+            pages.push_back(reinterpret_cast<void *>(page));
+        std::vector<int> nodes(pages.size(), node);
+        std::vector<int> status(pages.size(), 0);
+
+        // pid 0 is the calling process, pages that cannot move keep a negative status
+        return syscall(SYS_move_pages, 0, pages.size(), pages.data(), nodes.data(), status.data(), MPOL_MF_MOVE_PAGES) == 0;
+#else
+        return false;
+#endif
+    }
+
+} // namespace numa
@@ -0,0 +1,179 @@
+/* online_classifier.cpp
+ * source file for online_classifier.hpp
+ */
+
+#include "online_classifier.hpp"
+#include "count_vectorization.hpp"
+#include "preprocess.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <unordered_map>
+
+namespace cats {
+
+    static constexpr size_t MEMO_CAPACITY{1 << 15}; // tokens memoized per thread
+    static constexpr vocab::term_id STOPWORD{vocab::UNKNOWN_TERM};     // not counted
+    static constexpr vocab::term_id UNSEEN{vocab::UNKNOWN_TERM - 1};   // counted, no weight
+
+    static std::atomic<size_t> next_instance_id{0};
+
+    /* scratch of the calling thread, reused by every call,
+     * the token memo is dropped when another classifier runs.
+     */
+    struct Scratch {
+        size_t owner{~size_t{0}};
+        std::unordered_map<std::string, vocab::term_id> memo;
+        std::string key;
+        std::string stemmed;
+        std::vector<uint32_t> counts;        // indexed by term id, zero between calls
+        std::vector<vocab::term_id> touched; // terms with a non-zero count
+        std::vector<double> weights;         // TF-IDF of every touched term
+        std::vector<double> dot_products;
+        std::vector<size_t> order;
+    };
+    static thread_local Scratch scratch;
+
+    OnlineClassifier::OnlineClassifier(std::shared_ptr<const CentroidMatrix> centroids, corpus::IdfTable idf,
+                                       std::shared_ptr<const void> idf_owner, size_t num_top_terms)
+        : centroid_matrix{std::move(centroids)},
+          idf{idf},
+          idf_owner{std::move(idf_owner)},
+          num_top_terms{num_top_terms},
+          instance_id{next_instance_id.fetch_add(1, std::memory_order_relaxed)} {}
+
+    // stem and look up a token without interning it
+    static vocab::term_id resolve_token(std::string_view token) {
+        scratch.key.assign(token);
+        auto cached = scratch.memo.find(scratch.key);
+        if (cached != scratch.memo.end())
+            return cached->second;
+
+        preprocess_stem_term(token, scratch.stemmed);
+        vocab::term_id id{STOPWORD};
+        if (!is_stopword(scratch.stemmed)) {
+            id = vocab::vocabulary.find(scratch.stemmed);
+            if (id == vocab::UNKNOWN_TERM || id >= UNSEEN)
+                id = UNSEEN;
+        }
+
+        if (scratch.memo.size() >= MEMO_CAPACITY)
+            scratch.memo.clear();
+        scratch.memo.emplace(scratch.key, id);
+        return id;
+    }
+
+    /* count like count_words_doc() into the scratch counts, terms the 
+     * model has never seen still count towards the document length.
+     */
+    static size_t count_terms(std::string_view text, size_t instance_id, size_t number_of_terms) {
+        if (scratch.owner != instance_id) {
+            scratch.memo.clear();
+            scratch.owner = instance_id;
+        }
+
+        if (scratch.counts.size() < number_of_terms)
+            scratch.counts.resize(number_of_terms, 0);
+
+        preprocess::Tokenizer tokenizer{text};
+        std::string_view token;
+        size_t total_terms{0};
+        scratch.touched.clear();
+
+        while (tokenizer.next(token)) {
+            vocab::term_id id = resolve_token(token);
+            if (id == STOPWORD)
+                continue;
+
+            total_terms++;
+            if (id >= number_of_terms)
+                continue;
+            if (scratch.counts[id]++ == 0)
+                scratch.touched.push_back(id);
+        }
+
+        return total_terms;
+    }
+
+    void OnlineClassifier::vectorize(std::string_view text, std::vector<vocab::term_id>& term_ids, std::vector<double>& values) const {
+        size_t total_terms = count_terms(text, instance_id, idf.size);
+        std::sort(scratch.touched.begin(), scratch.touched.end());
+
+        term_ids.clear();
+        values.clear();
+        for (vocab::term_id term : scratch.touched) {
+            term_ids.push_back(term);
+            values.push_back(static_cast<double>(scratch.counts[term]) / total_terms * idf[term]);
+            scratch.counts[term] = 0;
+        }
+    }
+
+    void OnlineClassifier::classify(std::string_view text, Prediction& prediction) const {
+        prediction.label = {};
+        prediction.score = 0.0;
+        prediction.top_terms.clear();
+
+        size_t total_terms = count_terms(text, instance_id, idf.size);
+
+        /* weights, norm and dot products in one sweep, the
+         * counts are zeroed on the way for the next call.
+         */
+        size_t number_of_categories = centroid_matrix->num_categories();
+        scratch.dot_products.assign(number_of_categories, 0.0);
+        scratch.weights.resize(scratch.touched.size());
+        double doc_norm{0.0};
+
+        for (size_t k = 0; k < scratch.touched.size(); k++) {
+            vocab::term_id term = scratch.touched[k];
+            double weight = static_cast<double>(scratch.counts[term]) / total_terms * idf[term];
+            scratch.counts[term] = 0;
+            scratch.weights[k] = weight;
+            doc_norm += weight * weight;
+
+            const double * row = centroid_matrix->term_row(term);
+            if (row == nullptr)
+                continue;
+            for (size_t c = 0; c < number_of_categories; c++)
+                scratch.dot_products[c] += weight * row[c];
+        }
+
+        doc_norm = sqrt(doc_norm);
+        if (doc_norm < 1e-9)
+            return; // avoids division by zero, like select_top_k()
+
+        // ties keep the earlier category like classify_text
+        size_t best{number_of_categories};
+        for (size_t c = 0; c < number_of_categories; c++) {
+            double similarity = scratch.dot_products[c] / doc_norm;
+            if (similarity > 0.0 && (best == number_of_categories || similarity > prediction.score)) {
+                best = c;
+                prediction.score = similarity;
+            }
+        }
+
+        if (best == number_of_categories)
+            return;
+        prediction.label = centroid_matrix->category_type(best);
+
+        /* the cosine is a sum over terms, each term's share
+         * is its weight times the category's weight
+         */
+        scratch.order.clear();
+        for (size_t k = 0; k < scratch.touched.size(); k++) {
+            const double * row = centroid_matrix->term_row(scratch.touched[k]);
+            if (row != nullptr && row[best] > 0.0 && scratch.weights[k] > 0.0)
+                scratch.order.push_back(k);
+        }
+
+        auto share = [&](size_t k) {
+            return scratch.weights[k] * centroid_matrix->term_row(scratch.touched[k])[best] / doc_norm;
+        };
+        size_t number_of_top = std::min(num_top_terms, scratch.order.size());
+        std::partial_sort(scratch.order.begin(), scratch.order.begin() + number_of_top, scratch.order.end(),
+                          [&](size_t a, size_t b) { return share(a) > share(b); });
+
+        for (size_t i = 0; i < number_of_top; i++)
+            prediction.top_terms.push_back({vocab::vocabulary.term(scratch.touched[scratch.order[i]]), share(scratch.order[i])});
+    }
+
+} // namespace cats
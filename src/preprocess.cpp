@@ -5,80 +5,200 @@
 #include "preprocess.hpp"
 #include "english_stem.h"
 #include "utils.hpp"
-#include <locale>
-#include <codecvt>
+#include <array>
+#include <cstdint>
 
 
-/* Helper for static_assert to trigger an error 
- * for unsupported types. See comment below for 
- * use of chatGPT.
+/* Byte classes used by the tokenizer, same sets
+ * as isspace/ispunct/isdigit/isupper in the "C"
+ * locale. Bytes >= 0x80 (UTF-8) are kept as is.
  */
-template <typename T>
-struct always_false : std::false_type {};
-template <typename InputType>
-
-/* Convert std::string to wstring and wstring to std::string.
- * Used when stemming words to their base forms.
- * 
- * NOTE: I received help from chatGPT to write this function.
- *      The parameters given were "In c++, how can you create
- *      a function that can return different dataTypes and can
- *      accept different dataTypes, without relying on a tuple, 
- *      map, or set?"
- * 
- * Result: chatGPT outputted the following code segments:
- *      template <typename T>
- *      template <typename InputType> // allows any input (shown above this multiline-comment)
- *      auto convert_string_wstring(const InputType& input) {...} // auto allows the return of any value
- */
-static auto convert_string_wstring(const InputType& input) {
-    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-
-    if constexpr (std::is_same<InputType, std::wstring>::value) 
-        return converter.to_bytes(input); // convert wstring to std::string
-    else if constexpr (std::is_same<InputType, std::string>::value) 
-        return converter.from_bytes(input); // convert std::string to std::wstring
-    else 
-        throw std::runtime_error("Bad Cast in convert_string_wstring");
+enum char_class_ : uint8_t {
+    _keep_,  // copied unchanged
+    _upper_, // ASCII uppercase, folded to lowercase
+    _drop_,  // ASCII punctuation and digits
+    _space_  // token separator
+};
+
+static constexpr std::array<uint8_t, 256> build_char_classes() {
+    std::array<uint8_t, 256> classes{};
+
+    for (int c = 'A'; c <= 'Z'; c++)
+        classes[c] = _upper_;
+    for (int c = '0'; c <= '9'; c++)
+        classes[c] = _drop_;
+    for (char c : std::string_view{"!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"})
+        classes[static_cast<unsigned char>(c)] = _drop_;
+    for (char c : std::string_view{" \t\n\v\f\r"})
+        classes[static_cast<unsigned char>(c)] = _space_;
+
+    return classes;
 }
 
-// convert uppercase text to lower case text
-static std::string preprocess_to_lower_text(std::string str) {
-    std::transform(str.begin(), str.end(), str.begin(),
-                   [](unsigned char c){ return tolower(c); });
+static constexpr std::array<uint8_t, 256> CHAR_CLASSES{build_char_classes()};
 
-    return str;
+static inline uint8_t char_class(char c) {
+    return CHAR_CLASSES[static_cast<unsigned char>(c)];
 }
 
-// remove punctuation and numbers from text
-static std::string preprocess_remove_punc_text(std::string str) {
-    std::string processed = "";
+namespace preprocess {
+
+    bool Tokenizer::next(std::string_view& token) {
+        while (position < text.size()) {
+            while (position < text.size() && char_class(text[position]) == _space_)
+                position++;
+
+            size_t begin = position;
+            bool is_clean = true;
+            while (position < text.size() && char_class(text[position]) != _space_) {
+                is_clean &= char_class(text[position]) == _keep_;
+                position++;
+            }
+
+            if (begin == position)
+                return false;
+
+            // nothing to strip or fold, hand out a view into the text
+            if (is_clean) {
+                token = text.substr(begin, position - begin);
+                return true;
+            }
+
+            scratch.clear();
+            for (size_t i = begin; i < position; i++) {
+                uint8_t type = char_class(text[i]);
+                if (type == _keep_)
+                    scratch.push_back(text[i]);
+                else if (type == _upper_)
+                    scratch.push_back(static_cast<char>(text[i] - 'A' + 'a'));
+            }
+
+            // all punctuation/digits, e.g. "2005", try the next token
+            if (!scratch.empty()) {
+                token = scratch;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+} // namespace preprocess
+
+/* Decode UTF-8 into a wide string for the stemmer.
+ * Returns false for invalid UTF-8, which is then
+ * left unstemmed like before.
+ */
+static bool widen_utf8(std::string_view token, std::wstring& wide) {
+    for (size_t i = 0; i < token.size();) {
+        unsigned char lead = static_cast<unsigned char>(token[i]);
+        uint32_t code_point;
+        size_t length;
+
+        if (lead < 0x80) {
+            code_point = lead;
+            length = 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            code_point = lead & 0x1F;
+            length = 2;
+        } else if ((lead & 0xF0) == 0xE0) {
+            code_point = lead & 0x0F;
+            length = 3;
+        } else if ((lead & 0xF8) == 0xF0) {
+            code_point = lead & 0x07;
+            length = 4;
+        } else {
+            return false;
+        }
+
+        if (i + length > token.size())
+            return false;
 
-    for (char c : str)
-        if (!ispunct(c) && !isdigit(c))
-            processed += c;
+        for (size_t k = 1; k < length; k++) {
+            unsigned char continuation = static_cast<unsigned char>(token[i + k]);
+            if ((continuation & 0xC0) != 0x80)
+                return false;
+            code_point = (code_point << 6) | (continuation & 0x3F);
+        }
 
-    return processed;
+        wide.push_back(static_cast<wchar_t>(code_point));
+        i += length;
+    }
+
+    return true;
 }
 
-extern std::string preprocess_prune_term(std::string str) {
-    std::wstring to_prune;
+// encode the stemmed wide string back to UTF-8
+static void narrow_utf8(const std::wstring& wide, std::string& narrow) {
+    for (wchar_t wc : wide) {
+        uint32_t code_point = static_cast<uint32_t>(wc);
 
-    try {
-        to_prune = convert_string_wstring(str);
-    } catch(const std::runtime_error &e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return str;
+        if (code_point < 0x80) {
+            narrow.push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+            narrow.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            narrow.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else if (code_point < 0x10000) {
+            narrow.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            narrow.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            narrow.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+            narrow.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+            narrow.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+            narrow.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            narrow.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+}
+
+extern void preprocess_stem_term(std::string_view token, std::string& stemmed) {
+    // one stemmer and wide buffer per thread, reused for every token
+    static thread_local stemming::english_stem<> stemmer;
+    static thread_local std::wstring to_prune;
+
+    bool is_ascii = true;
+    for (char c : token)
+        is_ascii &= static_cast<unsigned char>(c) < 0x80;
+
+    to_prune.clear();
+    if (is_ascii) {
+        to_prune.append(token.begin(), token.end());
+    } else if (!widen_utf8(token, to_prune)) {
+        stemmed.assign(token);
+        return;
     }
 
     // prune it
-    stemming::english_stem<> stemmer;
     stemmer(to_prune);
 
-    return convert_string_wstring(to_prune);
+    stemmed.clear();
+    if (is_ascii)
+        stemmed.append(to_prune.begin(), to_prune.end());
+    else
+        narrow_utf8(to_prune, stemmed);
 }
 
-// preprocess all text in document
+extern std::string preprocess_prune_term(std::string str) {
+    std::string stemmed;
+    preprocess_stem_term(str, stemmed);
+
+    return stemmed;
+}
+
+// preprocess all text in document, lowercase and remove punctuation and numbers in one pass
 extern void preprocess_text(docs::Document * doc) {
-    doc->text = preprocess_to_lower_text(preprocess_remove_punc_text(doc->text));
-}
\ No newline at end of file
+    size_t length{0};
+
+    // text mapped from a file is read only, take a copy first
+    if (doc->text.empty())
+        doc->text.assign(doc->text_view);
+
+    for (char c : doc->text) {
+        uint8_t type = char_class(c);
+        if (type == _drop_)
+            continue;
+        doc->text[length++] = type == _upper_ ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    doc->text.resize(length);
+}
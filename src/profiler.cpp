@@ -0,0 +1,188 @@
+/* profiler.cpp
+ * source file for profiler.hpp
+ */
+
+#include "profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace prof {
+
+    static thread_local void * thread_totals{nullptr}; // the process has a single profiler
+
+    extern Profiler& profiler() {
+        static Profiler instance;
+        return instance;
+    }
+
+    size_t Profiler::register_site(std::string_view path) {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+
+        auto found = std::find(paths.begin(), paths.end(), path);
+        if (found != paths.end())
+            return static_cast<size_t>(found - paths.begin());
+
+        if (paths.size() == MAX_SITES)
+            throw std::length_error("Profiler: more than " + std::to_string(MAX_SITES) + " sites");
+        paths.emplace_back(path);
+        return paths.size() - 1;
+    }
+
+    Profiler::ThreadTotals& Profiler::local_totals() {
+        if (thread_totals != nullptr)
+            return *static_cast<ThreadTotals *>(thread_totals);
+
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        threads.push_back(std::make_unique<ThreadTotals>());
+        threads.back()->index = threads.size() - 1;
+        thread_totals = threads.back().get();
+        return *threads.back();
+    }
+
+    void Profiler::add(size_t site, uint64_t ns) {
+        Counter& counter = local_totals().sites[site];
+        // single writer, no read-modify-write needed
+        counter.calls.store(counter.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        counter.ns.store(counter.ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    std::vector<Record> Profiler::records() const {
+        std::vector<Record> result;
+        std::lock_guard<std::mutex> lock(registry_mtx);
+
+        for (const auto& totals : threads) {
+            for (size_t site = 0; site < paths.size(); site++) {
+                uint64_t calls = totals->sites[site].calls.load(std::memory_order_relaxed);
+                if (calls != 0)
+                    result.push_back({paths[site], totals->index, calls, totals->sites[site].ns.load(std::memory_order_relaxed)});
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const Record& a, const Record& b) {
+            return a.path != b.path ? a.path < b.path : a.thread < b.thread;
+        });
+        return result;
+    }
+
+    std::vector<Record> Profiler::totals() const {
+        std::vector<Record> result;
+        for (const Record& record : records()) {
+            if (result.empty() || result.back().path != record.path)
+                result.push_back({record.path, 0, 0, 0});
+            result.back().calls += record.calls;
+            result.back().ns += record.ns;
+        }
+        return result;
+    }
+
+    void Profiler::reset() {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+
+        for (auto& totals : threads) {
+            for (Counter& counter : totals->sites) {
+                counter.calls.store(0, std::memory_order_relaxed);
+                counter.ns.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* one node of the JSON hierarchy, parents
+     * without a site of their own have no calls.
+     */
+    struct Node {
+        std::string name;
+        std::string path;
+        uint64_t calls{0};
+        uint64_t ns{0};
+        std::vector<const Record *> per_thread;
+        std::vector<std::string> children;
+    };
+
+    static std::string parent_path(const std::string& path) {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? std::string{} : path.substr(0, slash);
+    }
+
+    static std::string escape_json(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static void write_node(std::ofstream& out, const std::map<std::string, Node>& nodes, const Node& node, const std::string& indent) {
+        out << indent << "{\"name\": \"" << escape_json(node.name) << "\", \"path\": \"" << escape_json(node.path)
+            << "\", \"calls\": " << node.calls << ", \"total_ns\": " << node.ns << ", \"threads\": [";
+        for (size_t i = 0; i < node.per_thread.size(); i++) {
+            const Record& record = *node.per_thread[i];
+            out << (i == 0 ? "" : ", ") << "{\"thread\": " << record.thread << ", \"calls\": " << record.calls << ", \"ns\": " << record.ns << "}";
+        }
+        out << "], \"children\": [";
+
+        for (size_t i = 0; i < node.children.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n");
+            write_node(out, nodes, nodes.at(node.children[i]), indent + "  ");
+        }
+        out << (node.children.empty() ? "" : "\n" + indent) << "]}";
+    }
+
+    void Profiler::write_json(const std::string& file_name) const {
+        std::ofstream out{file_name};
+        if (!out)
+            throw std::runtime_error("File cannot be written: " + file_name);
+
+        std::vector<Record> all = records();
+        std::map<std::string, Node> nodes; // sorted, a parent comes before its children
+
+        for (const Record& record : all) {
+            // create the node and every missing ancestor
+            for (std::string path = record.path; !path.empty() && nodes.count(path) == 0; path = parent_path(path)) {
+                Node& node = nodes[path];
+                node.path = path;
+                node.name = path.substr(path.rfind('/') == std::string::npos ? 0 : path.rfind('/') + 1);
+            }
+            Node& node = nodes[record.path];
+            node.calls += record.calls;
+            node.ns += record.ns;
+            node.per_thread.push_back(&record);
+        }
+
+        std::vector<std::string> roots;
+        for (const auto& [path, node] : nodes) {
+            std::string parent = parent_path(path);
+            if (parent.empty())
+                roots.push_back(path);
+            else
+                nodes[parent].children.push_back(path);
+        }
+
+        size_t number_of_threads{0};
+        for (const Record& record : all)
+            number_of_threads = std::max(number_of_threads, record.thread + 1);
+
+        out << "{\"unit\": \"ns\", \"threads\": " << number_of_threads << ", \"sections\": [";
+        for (size_t i = 0; i < roots.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n");
+            write_node(out, nodes, nodes.at(roots[i]), "  ");
+        }
+        out << (roots.empty() ? "" : "\n") << "]}" << std::endl;
+    }
+
+    void Profiler::write_csv(const std::string& file_name) const {
+        std::ofstream out{file_name};
+        if (!out)
+            throw std::runtime_error("File cannot be written: " + file_name);
+
+        out << "path,thread,calls,ns\n";
+        for (const Record& record : totals())
+            out << record.path << ",all," << record.calls << "," << record.ns << "\n";
+        for (const Record& record : records())
+            out << record.path << "," << record.thread << "," << record.calls << "," << record.ns << "\n";
+    }
+
+} // namespace prof
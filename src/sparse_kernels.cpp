@@ -0,0 +1,261 @@
+/* sparse_kernels.cpp
+ * source file for sparse_kernels.hpp
+ */
+
+#include "sparse_kernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define _SPARSE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace sparse {
+
+    /* -- Scalar Kernels -- */
+
+    static double dot_dense_scalar(const RowView& row, const double * dense, size_t dense_size) {
+        double dot_product{0.0};
+
+        for (size_t k = 0; k < row.size; k++)
+            if (row.term_ids[k] < dense_size)
+                dot_product += row.values[k] * dense[row.term_ids[k]];
+
+        return dot_product;
+    }
+
+    static double squared_norm_scalar(const double * values, size_t size) {
+        double norm{0.0};
+
+        for (size_t k = 0; k < size; k++)
+            norm += values[k] * values[k];
+
+        return norm;
+    }
+
+#ifdef _SPARSE_KERNELS_X86
+
+    /* -- AVX2 Kernels -- */
+
+    __attribute__((target("avx2,fma")))
+    static double horizontal_sum_avx2(__m256d sum) {
+        __m128d low = _mm256_castpd256_pd128(sum);
+        __m128d high = _mm256_extractf128_pd(sum, 1);
+        low = _mm_add_pd(low, high);
+
+        return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+    }
+
+    __attribute__((target("avx2,fma")))
+    static double dot_dense_avx2(const RowView& row, const double * dense, size_t dense_size) {
+        // unsigned compare through a sign flip, AVX2 only has signed 32-bit compares
+        const __m128i sign = _mm_set1_epi32(INT_MIN);
+        const __m128i limit = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(dense_size)), sign);
+        __m256d sum = _mm256_setzero_pd();
+        size_t k{0};
+
+        for (; k + 4 <= row.size; k += 4) {
+            __m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row.term_ids + k));
+            __m128i in_range = _mm_cmplt_epi32(_mm_xor_si128(ids, sign), limit);
+            __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(in_range));
+
+            // out of range lanes are masked off and never touch memory
+            __m256d weights = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), dense, ids, mask, 8);
+            sum = _mm256_fmadd_pd(_mm256_loadu_pd(row.values + k), weights, sum);
+        }
+
+        double dot_product = horizontal_sum_avx2(sum);
+        for (; k < row.size; k++)
+            if (row.term_ids[k] < dense_size)
+                dot_product += row.values[k] * dense[row.term_ids[k]];
+
+        return dot_product;
+    }
+
+    __attribute__((target("avx2,fma")))
+    static double squared_norm_avx2(const double * values, size_t size) {
+        __m256d sum = _mm256_setzero_pd();
+        size_t k{0};
+
+        for (; k + 4 <= size; k += 4) {
+            __m256d v = _mm256_loadu_pd(values + k);
+            sum = _mm256_fmadd_pd(v, v, sum);
+        }
+
+        double norm = horizontal_sum_avx2(sum);
+        for (; k < size; k++)
+            norm += values[k] * values[k];
+
+        return norm;
+    }
+
+    /* -- AVX-512 Kernels -- */
+
+    // spelled out, _mm512_reduce_add_pd trips -Wuninitialized in some GCC headers
+    __attribute__((target("avx512f")))
+    static double horizontal_sum_avx512(__m512d sum) {
+        alignas(64) double lanes[8];
+        _mm512_store_pd(lanes, sum);
+
+        return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+    }
+
+    __attribute__((target("avx512f")))
+    static double dot_dense_avx512(const RowView& row, const double * dense, size_t dense_size) {
+        const __m512i limit = _mm512_set1_epi32(static_cast<int>(dense_size));
+        __m512d sum = _mm512_setzero_pd();
+        size_t k{0};
+
+        for (; k + 8 <= row.size; k += 8) {
+            __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row.term_ids + k));
+
+            // only the low 8 lanes hold IDs, the rest of the compare is ignored
+            __mmask8 in_range = static_cast<__mmask8>(_mm512_cmplt_epu32_mask(_mm512_castsi256_si512(ids), limit));
+            __m512d weights = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), in_range, ids, dense, 8);
+            sum = _mm512_fmadd_pd(_mm512_loadu_pd(row.values + k), weights, sum);
+        }
+
+        double dot_product = horizontal_sum_avx512(sum);
+        for (; k < row.size; k++)
+            if (row.term_ids[k] < dense_size)
+                dot_product += row.values[k] * dense[row.term_ids[k]];
+
+        return dot_product;
+    }
+
+    __attribute__((target("avx512f")))
+    static double squared_norm_avx512(const double * values, size_t size) {
+        __m512d sum = _mm512_setzero_pd();
+        size_t k{0};
+
+        for (; k + 8 <= size; k += 8) {
+            __m512d v = _mm512_loadu_pd(values + k);
+            sum = _mm512_fmadd_pd(v, v, sum);
+        }
+
+        double norm = horizontal_sum_avx512(sum);
+        for (; k < size; k++)
+            norm += values[k] * values[k];
+
+        return norm;
+    }
+
+#endif // _SPARSE_KERNELS_X86
+
+    /* -- Dispatch -- */
+
+    extern KernelLevel detected_kernel_level() {
+        static const KernelLevel detected = []() {
+#ifdef _SPARSE_KERNELS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return KernelLevel::avx512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return KernelLevel::avx2;
+#endif
+            return KernelLevel::scalar;
+        }();
+
+        return detected;
+    }
+
+    static std::atomic<KernelLevel>& active_level() {
+        static std::atomic<KernelLevel> level{detected_kernel_level()};
+        return level;
+    }
+
+    extern KernelLevel kernel_level() {
+        return active_level().load(std::memory_order_relaxed);
+    }
+
+    extern void set_kernel_level(KernelLevel level) {
+        active_level().store(std::min(level, detected_kernel_level()), std::memory_order_relaxed);
+    }
+
+    extern const char * kernel_name(KernelLevel level) {
+        switch (level) {
+            case KernelLevel::avx512: return "AVX-512";
+            case KernelLevel::avx2:   return "AVX2";
+            default:                  return "scalar";
+        }
+    }
+
+    extern double dot_dense(const RowView& row, const double * dense, size_t dense_size) {
+#ifdef _SPARSE_KERNELS_X86
+        // gathers take signed 32-bit indices
+        if (dense_size <= static_cast<size_t>(INT_MAX)) {
+            switch (kernel_level()) {
+                case KernelLevel::avx512: return dot_dense_avx512(row, dense, dense_size);
+                case KernelLevel::avx2:   return dot_dense_avx2(row, dense, dense_size);
+                default:                  break;
+            }
+        }
+#endif
+        return dot_dense_scalar(row, dense, dense_size);
+    }
+
+    extern double squared_norm(const double * values, size_t size) {
+#ifdef _SPARSE_KERNELS_X86
+        switch (kernel_level()) {
+            case KernelLevel::avx512: return squared_norm_avx512(values, size);
+            case KernelLevel::avx2:   return squared_norm_avx2(values, size);
+            default:                  break;
+        }
+#endif
+        return squared_norm_scalar(values, size);
+    }
+
+    /* first index in [begin, size) whose id is >= target,
+     * doubling the step before binary searching.
+     */
+    static size_t gallop(const vocab::term_id * ids, size_t begin, size_t size, vocab::term_id target) {
+        size_t step{1};
+        size_t low{begin};
+        size_t high{begin};
+
+        while (high < size && ids[high] < target) {
+            low = high + 1;
+            high = begin + step;
+            step *= 2;
+        }
+
+        return std::lower_bound(ids + low, ids + std::min(high, size), target) - ids;
+    }
+
+    extern double dot_sorted(const RowView& a, const RowView& b) {
+        const RowView& shorter = a.size <= b.size ? a : b;
+        const RowView& longer = a.size <= b.size ? b : a;
+        double dot_product{0.0};
+
+        if (shorter.size == 0)
+            return dot_product;
+
+        // skewed sizes, gallop through the longer vector
+        if (longer.size / shorter.size >= 32) {
+            size_t j{0};
+            for (size_t i = 0; i < shorter.size && j < longer.size; i++) {
+                j = gallop(longer.term_ids, j, longer.size, shorter.term_ids[i]);
+                if (j < longer.size && longer.term_ids[j] == shorter.term_ids[i])
+                    dot_product += shorter.values[i] * longer.values[j];
+            }
+
+            return dot_product;
+        }
+
+        size_t i{0}, j{0};
+        while (i < a.size && j < b.size) {
+            if (a.term_ids[i] < b.term_ids[j]) {
+                i++;
+            } else if (b.term_ids[j] < a.term_ids[i]) {
+                j++;
+            } else {
+                dot_product += a.values[i++] * b.values[j++];
+            }
+        }
+
+        return dot_product;
+    }
+
+} // namespace sparse
@@ -0,0 +1,168 @@
+/* stem_cache.cpp
+ * source file for stem_cache.hpp
+ */
+
+#include "stem_cache.hpp"
+#include "preprocess.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace stem {
+
+    StemCache stem_cache;
+
+    /* per-thread L1, tagged with the cache and generation 
+     * it was filled from so a clear() or another cache 
+     * instance never sees stale IDs.
+     */
+    struct LocalCache {
+        const StemCache * owner{nullptr};
+        size_t generation{0};
+        std::unordered_map<std::string, vocab::term_id> ids;
+        std::string key; // reused so lookups do not allocate
+    };
+    static thread_local LocalCache local;
+
+    static std::atomic<size_t> next_stripe{0};
+
+    StemCache::Counters& StemCache::local_counters() {
+        static thread_local size_t stripe{next_stripe.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS};
+        return counters[stripe];
+    }
+
+    vocab::term_id StemCache::lookup(std::string_view token, Resolver resolve) {
+        size_t current_generation = generation.load(std::memory_order_acquire);
+        if (local.owner != this || local.generation != current_generation || local.ids.size() >= L1_CAPACITY) {
+            local.ids.clear();
+            local.owner = this;
+            local.generation = current_generation;
+        }
+
+        local.key.assign(token);
+        auto cached = local.ids.find(local.key);
+        if (cached != local.ids.end()) {
+            local_counters().l1_hits.fetch_add(1, std::memory_order_relaxed);
+            return cached->second;
+        }
+
+        Shard& shard = shard_for(local.key);
+        vocab::term_id id{UNRESOLVED};
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.shard_mtx);
+            auto found = shard.entries.find(local.key);
+            if (found != shard.entries.end()) {
+                id = found->second.id.load(std::memory_order_acquire);
+                // warmed entry, resolving twice from two threads gives the same ID
+                if (id == UNRESOLVED) {
+                    id = resolve(found->second.stem);
+                    found->second.id.store(id, std::memory_order_release);
+                }
+            }
+        }
+
+        if (id != UNRESOLVED) {
+            local_counters().shared_hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // stem outside the lock, another thread may insert the same token meanwhile
+            static thread_local std::string stemmed;
+            {
+                PROF_SCOPE("vectorization/tokenize/stem");
+                preprocess_stem_term(token, stemmed);
+                id = resolve(stemmed);
+            }
+
+            {
+                std::unique_lock<std::shared_mutex> lock(shard.shard_mtx);
+                auto [it, inserted] = shard.entries.try_emplace(local.key);
+                if (inserted)
+                    it->second.stem = stemmed;
+                it->second.id.store(id, std::memory_order_release);
+            }
+            local_counters().misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        local.ids.emplace(local.key, id);
+        return id;
+    }
+
+    size_t StemCache::load(const std::string& file_name) {
+        std::ifstream file{file_name};
+        if (!file.is_open())
+            throw std::runtime_error("File cannot be opened: " + file_name);
+
+        size_t num_loaded{0};
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos || tab == 0)
+                continue;
+
+            std::string token{line.substr(0, tab)};
+            Shard& shard = shard_for(token);
+            std::unique_lock<std::shared_mutex> lock(shard.shard_mtx);
+            auto [it, inserted] = shard.entries.try_emplace(std::move(token));
+            if (inserted) {
+                it->second.stem = line.substr(tab + 1);
+                num_loaded++;
+            }
+        }
+
+        return num_loaded;
+    }
+
+    void StemCache::save(const std::string& file_name) const {
+        std::vector<std::pair<std::string, std::string>> stems;
+        for (const Shard& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.shard_mtx);
+            for (const auto& [token, entry] : shard.entries)
+                stems.emplace_back(token, entry.stem);
+        }
+        std::sort(stems.begin(), stems.end());
+
+        std::ofstream file{file_name};
+        if (!file.is_open())
+            throw std::runtime_error("File cannot be written: " + file_name);
+
+        for (const auto& [token, stemmed] : stems)
+            file << token << '\t' << stemmed << '\n';
+    }
+
+    CacheStats StemCache::stats() const {
+        CacheStats totals{0, 0, 0, 0};
+
+        for (const Counters& stripe : counters) {
+            totals.l1_hits += stripe.l1_hits.load(std::memory_order_relaxed);
+            totals.shared_hits += stripe.shared_hits.load(std::memory_order_relaxed);
+            totals.misses += stripe.misses.load(std::memory_order_relaxed);
+        }
+
+        for (const Shard& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.shard_mtx);
+            totals.entries += shard.entries.size();
+        }
+
+        return totals;
+    }
+
+    void StemCache::reset_counters() {
+        for (Counters& stripe : counters) {
+            stripe.l1_hits.store(0, std::memory_order_relaxed);
+            stripe.shared_hits.store(0, std::memory_order_relaxed);
+            stripe.misses.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void StemCache::clear() {
+        for (Shard& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.shard_mtx);
+            shard.entries.clear();
+        }
+
+        generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+} // namespace stem
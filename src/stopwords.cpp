@@ -0,0 +1,171 @@
+/* stopwords.cpp
+ * source file for stopwords.hpp
+ */
+
+#include "stopwords.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+
+namespace stopwords {
+
+    /* words that carry no value and are voided
+     * used from https://towardsdatascience.com/building-a-cross-platform-tfidf-text-summarizer-in-rust-7b05938f4507
+     */
+    static constexpr std::string_view ENGLISH_WORDS[]{
+        "me", "my", "myself", "we", "our", "ours", "ourselves", "you", "your",
+        "yours", "yourself", "yourselves", "he", "him", "his", "himself", "she",
+        "her", "hers", "herself", "it", "its", "itself", "they", "them", "their",
+        "theirs", "themselves", "what", "which", "who", "whom", "this", "that",
+        "these", "those", "am", "is", "are", "was", "were", "be", "been", "being",
+        "have", "has", "had", "having", "do", "does", "did", "doing", "an", "the",
+        "and", "but", "if", "or", "because", "as", "until", "while", "of", "at",
+        "by", "for", "with", "about", "against", "between", "into", "through",
+        "during", "before", "after", "above", "below", "to", "from", "up", "down",
+        "in", "out", "on", "off", "over", "under", "again", "further", "then", "oh",
+        "once", "here", "there", "when", "where", "why", "how", "all", "any",
+        "both", "each", "few", "more", "most", "other", "some", "such", "no",
+        "nor", "not", "only", "own", "same", "so", "than", "too", "very", "can",
+        "will", "just", "don", "should", "now", "a", "b", "c", "d", "e", "f",
+        "g", "h", "i", "j", "k", "l", "m", "n", "o", "p", "q", "r", "s", "t", "u",
+        "v", "w", "x", "y", "z"
+    };
+
+    static constexpr size_t MAX_SEEDS{4096}; ///< Seeds tried per table size before doubling it.
+
+    // smallest table with at least 8 slots per word, a seed then fits within a few hundred tries
+    static constexpr unsigned slot_bits_for(size_t count) {
+        unsigned bits{1};
+        while ((size_t{1} << bits) < count * 8)
+            bits++;
+        return bits;
+    }
+
+    static constexpr uint64_t seed_for(size_t attempt) {
+        return 0xCBF29CE484222325ull + attempt * 0x9E3779B97F4A7C15ull;
+    }
+
+    /* places every word in its slot for this seed, the slots must
+     * all be empty. On the first collision the words placed so far
+     * are taken out again, so the next seed starts from empty slots.
+     */
+    static constexpr bool try_seed(const std::string_view * words, size_t count, word_index * slots, unsigned shift, uint64_t seed) {
+        for (size_t i = 0; i < count; i++) {
+            word_index& slot = slots[hash_word(words[i], seed) >> shift];
+            if (slot != NO_WORD) {
+                for (size_t j = 0; j < i; j++)
+                    slots[hash_word(words[j], seed) >> shift] = NO_WORD;
+                return false;
+            }
+            slot = static_cast<word_index>(i);
+        }
+        return true;
+    }
+
+    static constexpr size_t longest(const std::string_view * words, size_t count) {
+        size_t max_length{0};
+        for (size_t i = 0; i < count; i++)
+            max_length = std::max(max_length, words[i].size());
+        return max_length;
+    }
+
+    /* hash table of a built-in list, generated by the compiler */
+    template <size_t N>
+    struct StaticTable {
+        static constexpr unsigned SLOT_BITS{slot_bits_for(N)};
+        std::array<word_index, size_t{1} << SLOT_BITS> slots{};
+        uint64_t seed{0};
+        bool found{false};
+    };
+
+    template <size_t N>
+    static constexpr StaticTable<N> build_table(const std::string_view (&words)[N]) {
+        StaticTable<N> table;
+        for (word_index& slot : table.slots)
+            slot = NO_WORD;
+
+        for (size_t attempt = 0; attempt < MAX_SEEDS && !table.found; attempt++) {
+            table.seed = seed_for(attempt);
+            table.found = try_seed(words, N, table.slots.data(), 64 - StaticTable<N>::SLOT_BITS, table.seed);
+        }
+        return table;
+    }
+
+    static constexpr auto ENGLISH_TABLE = build_table(ENGLISH_WORDS);
+    static_assert(ENGLISH_TABLE.found, "no perfect hash seed for the English stopwords");
+
+    static const StopwordSet * active_set{nullptr};
+
+    StopwordSet::StopwordSet() : StopwordSet(std::vector<std::string>{}) {}
+
+    StopwordSet::StopwordSet(std::vector<std::string> list) : owned_words{std::move(list)} {
+        owned_words.erase(std::remove(owned_words.begin(), owned_words.end(), std::string{}), owned_words.end());
+        std::sort(owned_words.begin(), owned_words.end());
+        owned_words.erase(std::unique(owned_words.begin(), owned_words.end()), owned_words.end());
+        if (owned_words.size() > MAX_WORDS)
+            throw std::length_error("StopwordSet: more than " + std::to_string(MAX_WORDS) + " stopwords");
+
+        owned_views.assign(owned_words.begin(), owned_words.end());
+        words = owned_views.data();
+        count = owned_views.size();
+        max_length = longest(words, count);
+
+        // a seed almost always fits the first size, a larger table makes it certain
+        for (unsigned bits = slot_bits_for(count); ; bits++) {
+            owned_slots.assign(size_t{1} << bits, NO_WORD);
+            shift = 64 - bits;
+            for (size_t attempt = 0; attempt < MAX_SEEDS; attempt++) {
+                seed = seed_for(attempt);
+                if (try_seed(words, count, owned_slots.data(), shift, seed)) {
+                    slots = owned_slots.data();
+                    return;
+                }
+            }
+        }
+    }
+
+    StopwordSet::StopwordSet(const std::string_view * words, size_t count, const word_index * slots,
+                             unsigned shift, uint64_t seed, size_t max_length)
+        : words{words}, slots{slots}, seed{seed}, shift{shift}, max_length{max_length}, count{count} {}
+
+    extern const StopwordSet& english() {
+        constexpr size_t count{std::size(ENGLISH_WORDS)};
+        static const StopwordSet set{ENGLISH_WORDS, count, ENGLISH_TABLE.slots.data(),
+                                     64 - StaticTable<count>::SLOT_BITS, ENGLISH_TABLE.seed,
+                                     longest(ENGLISH_WORDS, count)};
+        return set;
+    }
+
+    extern StopwordSet load(const std::string& file_name) {
+        std::ifstream file{file_name};
+        if (!file.is_open())
+            throw std::runtime_error("File cannot be opened: " + file_name);
+
+        std::vector<std::string> words;
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#')
+                continue;
+            size_t end = line.find_last_not_of(" \t\r");
+
+            std::string word{line.substr(begin, end - begin + 1)};
+            for (char& c : word)
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            words.push_back(std::move(word));
+        }
+
+        return StopwordSet{std::move(words)};
+    }
+
+    extern const StopwordSet& active() {
+        return active_set != nullptr ? *active_set : english();
+    }
+
+    extern void set_active(const StopwordSet& set) {
+        active_set = &set;
+    }
+
+} // namespace stopwords
@@ -0,0 +1,196 @@
+/* streaming.cpp
+ * source file for streaming.hpp
+ */
+
+#include "streaming.hpp"
+#include "bounded_queue.hpp"
+#include "count_vectorization.hpp"
+#include "file_operations.hpp"
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace stream {
+
+    /* documents of one batch, their text still
+     * points into the mapped file.
+     */
+    struct RawBatch {
+        std::vector<docs::Document> documents;
+        size_t end_offset{0}; // file offset just past the batch
+    };
+
+    /* vectorized batch, term frequencies packed
+     * as CSR rows, the documents are gone.
+     */
+    struct CountedBatch {
+        sparse::CsrMatrix rows;
+        std::vector<std::string> categories;
+        size_t end_offset{0};
+    };
+
+    // first error of any stage, the other stages stop on it
+    struct StageError {
+        std::mutex error_mtx;
+        std::exception_ptr error;
+
+        void set(std::exception_ptr stage_error) {
+            std::lock_guard<std::mutex> lock(error_mtx);
+            if (!error)
+                error = stage_error;
+        }
+    };
+
+    // stage 1, cut the mapped file into batches of documents
+    static void read_batches(const io::MappedFile& file, InputFormat format, size_t batch_size, BoundedQueue<RawBatch>& raw_batches) {
+        std::string_view text = file.view();
+        std::string_view record;
+        size_t position{0};
+        bool is_csv = format == InputFormat::csv;
+
+        // ignore header
+        if (is_csv)
+            io::next_record(text, position, true, record);
+
+        RawBatch batch;
+        while (io::next_record(text, position, is_csv, record)) {
+            batch.documents.emplace_back();
+            if (is_csv)
+                parse_csv_record(record, batch.documents.back());
+            else
+                batch.documents.back().text_view = record;
+
+            if (batch.documents.size() == batch_size) {
+                batch.end_offset = std::min(position, text.size());
+                if (!raw_batches.push(std::move(batch)))
+                    return;
+                batch = RawBatch{};
+            }
+        }
+
+        if (!batch.documents.empty()) {
+            batch.end_offset = text.size();
+            raw_batches.push(std::move(batch));
+        }
+    }
+
+    // stage 2, vectorize a batch on the pool and pack it into CSR rows
+    static CountedBatch count_batch(RawBatch& batch, tpool::ThreadPool& thread_pool) {
+        std::vector<docs::Document>& documents = batch.documents;
+        thread_pool.parallel_for(documents.size(), [&documents](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                vectorize_document(&documents[i]);
+        });
+
+        CountedBatch counted;
+        counted.end_offset = batch.end_offset;
+        counted.categories.reserve(documents.size());
+        counted.rows.row_offsets.reserve(documents.size() + 1);
+
+        std::vector<std::pair<vocab::term_id, double>> sorted_row;
+        for (auto& document : documents) {
+            sorted_row.assign(document.term_frequency.begin(), document.term_frequency.end());
+            std::sort(sorted_row.begin(), sorted_row.end());
+
+            for (const auto& [word, freq] : sorted_row) {
+                counted.rows.term_ids.push_back(word);
+                counted.rows.values.push_back(freq);
+            }
+            counted.rows.row_offsets.push_back(counted.rows.term_ids.size());
+            counted.categories.push_back(std::move(document.category));
+        }
+
+        return counted;
+    }
+
+    // stage 3, append the rows, count document frequencies, release the consumed file pages
+    static void collect_batches(const io::MappedFile& file, BoundedQueue<CountedBatch>& counted_batches, corpus::FrozenCorpus& frozen) {
+        sparse::CsrMatrix& matrix = frozen.matrix;
+        CountedBatch batch;
+        size_t released{0};
+
+        while (counted_batches.pop(batch)) {
+            size_t base = matrix.num_nonzeros();
+            matrix.term_ids.insert(matrix.term_ids.end(), batch.rows.term_ids.begin(), batch.rows.term_ids.end());
+            matrix.values.insert(matrix.values.end(), batch.rows.values.begin(), batch.rows.values.end());
+            for (size_t r = 1; r < batch.rows.row_offsets.size(); r++)
+                matrix.row_offsets.push_back(base + batch.rows.row_offsets[r]);
+
+            // every term appears once per row, so each entry is one document
+            for (vocab::term_id word : batch.rows.term_ids) {
+                if (word >= frozen.document_frequency.size())
+                    frozen.document_frequency.resize(std::max<size_t>(word + 1, vocab::vocabulary.size()), 0);
+                frozen.document_frequency[word]++;
+            }
+
+            for (auto& category : batch.categories) {
+                if (category.empty()) {
+                    frozen.row_category.push_back(-1);
+                    continue;
+                }
+
+                auto found = std::find(frozen.category_types.begin(), frozen.category_types.end(), category);
+                frozen.row_category.push_back(static_cast<int>(found - frozen.category_types.begin()));
+                if (found == frozen.category_types.end())
+                    frozen.category_types.push_back(std::move(category));
+            }
+
+            file.release(released, batch.end_offset);
+            released = batch.end_offset;
+        }
+    }
+
+    extern corpus::FrozenCorpus stream_corpus(const std::string& file_name, InputFormat format, tpool::ThreadPool& thread_pool, const StreamSettings& settings) {
+        io::MappedFile file{file_name};
+        corpus::FrozenCorpus frozen;
+        StageError stage_error;
+
+        size_t batch_size = std::max<size_t>(1, settings.batch_size);
+        BoundedQueue<RawBatch> raw_batches{settings.queue_capacity};
+        BoundedQueue<CountedBatch> counted_batches{settings.queue_capacity};
+
+        std::thread reader([&]() {
+            try {
+                read_batches(file, format, batch_size, raw_batches);
+            } catch (...) {
+                stage_error.set(std::current_exception());
+            }
+            raw_batches.close();
+        });
+
+        std::thread collector([&]() {
+            try {
+                collect_batches(file, counted_batches, frozen);
+            } catch (...) {
+                stage_error.set(std::current_exception());
+                counted_batches.close(); // unblocks the counting loop
+                raw_batches.close();     // unblocks the reader
+            }
+        });
+
+        RawBatch batch;
+        try {
+            while (raw_batches.pop(batch)) {
+                if (!counted_batches.push(count_batch(batch, thread_pool)))
+                    break;
+                batch = RawBatch{}; // drop the documents and their text now
+            }
+        } catch (...) {
+            stage_error.set(std::current_exception());
+            raw_batches.close();
+        }
+
+        raw_batches.close(); // a reader blocked on a full queue after an error
+        counted_batches.close();
+        reader.join();
+        collector.join();
+
+        if (stage_error.error)
+            std::rethrow_exception(stage_error.error);
+
+        frozen.document_frequency.resize(vocab::vocabulary.size(), 0);
+        return frozen;
+    }
+
+} // namespace stream
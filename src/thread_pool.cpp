@@ -0,0 +1,292 @@
+/* thread_pool.cpp
+ * source file for thread_pool.hpp
+ */
+
+#include "thread_pool.hpp"
+#include <chrono>
+
+namespace tpool {
+
+    /* index of the worker running on this thread, -1
+     * for threads that do not belong to a pool.
+     */
+    static thread_local int current_worker{-1};
+    static thread_local const ThreadPool * current_pool{nullptr};
+
+    ThreadPool::ThreadPool(unsigned num_workers) {
+        start(num_workers, nullptr);
+    }
+
+    ThreadPool::ThreadPool(unsigned num_workers, const numa::Topology& topology) {
+        start(num_workers, &topology);
+    }
+
+    void ThreadPool::start(unsigned num_workers, const numa::Topology * topology) {
+        unsigned num_queues = num_workers == 0 ? 1 : num_workers;
+        for (unsigned i = 0; i < num_queues; i++)
+            queues.emplace_back(std::make_unique<WorkerQueue>());
+        worker_stats = std::make_unique<WorkerStats[]>(num_queues + 1);
+        worker_nodes.assign(num_queues, 0);
+
+        /* spread the workers evenly over the topology's CPUs in node order,
+         * nodes no worker landed on are left out of the pool
+         */
+        if (topology != nullptr && num_workers > 0) {
+            std::vector<std::pair<unsigned, int>> cpus; // cpu, node
+            for (const numa::Node& node : topology->nodes())
+                for (unsigned cpu : node.cpus)
+                    cpus.emplace_back(cpu, node.id);
+
+            for (unsigned i = 0; i < num_workers; i++) {
+                size_t k = num_workers <= cpus.size() ? static_cast<size_t>(i) * cpus.size() / num_workers : i % cpus.size();
+                worker_cpus.push_back(cpus[k].first);
+
+                auto found = std::find(node_ids.begin(), node_ids.end(), cpus[k].second);
+                if (found == node_ids.end()) {
+                    node_ids.push_back(cpus[k].second);
+                    node_workers.emplace_back();
+                    found = node_ids.end() - 1;
+                }
+                worker_nodes[i] = static_cast<unsigned>(found - node_ids.begin());
+                node_workers[worker_nodes[i]].push_back(i);
+            }
+        } else {
+            node_ids.push_back(0);
+            node_workers.emplace_back();
+            for (unsigned i = 0; i < num_workers; i++)
+                node_workers[0].push_back(i);
+        }
+
+        // steal from the next queues of the own node, then from the other nodes
+        steal_order.resize(num_queues);
+        for (unsigned home = 0; home < num_queues; home++) {
+            for (unsigned i = 1; i < num_queues; i++)
+                if (worker_nodes[(home + i) % num_queues] == worker_nodes[home])
+                    steal_order[home].push_back((home + i) % num_queues);
+            for (unsigned i = 1; i < num_queues; i++)
+                if (worker_nodes[(home + i) % num_queues] != worker_nodes[home])
+                    steal_order[home].push_back((home + i) % num_queues);
+        }
+
+        workers.reserve(num_workers);
+        for (unsigned i = 0; i < num_workers; i++)
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mtx);
+            stopping.store(true);
+        }
+        sleep_cv.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    size_t ThreadPool::default_grain(size_t count) const {
+        size_t number_of_tasks = static_cast<size_t>(queues.size()) * 8;
+        size_t grain = count / number_of_tasks;
+
+        return grain == 0 ? 1 : grain;
+    }
+
+    void ThreadPool::submit(TaskGroup& group, std::function<void()> task) {
+        unsigned home = (current_pool == this && current_worker >= 0)
+                        ? static_cast<unsigned>(current_worker)
+                        : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        submit_to(home, group, std::move(task));
+    }
+
+    void ThreadPool::submit_to(unsigned queue, TaskGroup& group, std::function<void()> task, bool own) {
+        group.remaining.fetch_add(1, std::memory_order_relaxed);
+
+        auto wrapped = [&group, task = std::move(task)]() {
+            std::exception_ptr error;
+            try {
+                task();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            /* decrement under the lock, the waiter may destroy 
+             * the group as soon as it observes 0 remaining.
+             */
+            std::lock_guard<std::mutex> lock(group.group_mtx);
+            if (error && !group.error)
+                group.error = error;
+            if (group.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                group.done_cv.notify_all();
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(queues[queue]->queue_mtx);
+            (own ? queues[queue]->own_tasks : queues[queue]->tasks).emplace_back(std::move(wrapped));
+        }
+
+        (own ? queues[queue]->own_pending : pending).fetch_add(1, std::memory_order_release);
+        {
+            // a worker between its predicate check and its sleep must not miss this task
+            std::lock_guard<std::mutex> lock(sleep_mtx);
+        }
+
+        /* only the queue's worker can run an own task, make sure it wakes,
+         * the others see no stealable work and go back to sleep
+         */
+        if (own)
+            sleep_cv.notify_all();
+        else
+            sleep_cv.notify_one();
+    }
+
+    bool ThreadPool::try_run_one(unsigned home, bool owner) {
+        std::function<void()> task;
+
+        bool own_task{false};
+        {
+            std::lock_guard<std::mutex> lock(queues[home]->queue_mtx);
+            if (owner && !queues[home]->own_tasks.empty()) {
+                // own tasks in submission order
+                task = std::move(queues[home]->own_tasks.front());
+                queues[home]->own_tasks.pop_front();
+                own_task = true;
+            } else if (!queues[home]->tasks.empty()) {
+                // own work from the back (most recent, still in cache)
+                task = std::move(queues[home]->tasks.back());
+                queues[home]->tasks.pop_back();
+            }
+        }
+
+        // steal the oldest work of another queue
+        for (size_t i = 0; !task && i < steal_order[home].size(); i++) {
+            WorkerQueue& victim = *queues[steal_order[home][i]];
+            std::lock_guard<std::mutex> lock(victim.queue_mtx);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+            return false;
+
+        (own_task ? queues[home]->own_pending : pending).fetch_sub(1, std::memory_order_acq_rel);
+        task();
+        return true;
+    }
+
+    void ThreadPool::worker_loop(unsigned index) {
+        current_worker = static_cast<int>(index);
+        current_pool = this;
+        if (!worker_cpus.empty())
+            numa::pin_current_thread(worker_cpus[index]); // before any task, so everything it touches is node-local
+
+        while (true) {
+            if (try_run_one(index, true))
+                continue;
+
+            // wake only for work this worker can run, other workers' own tasks do not count
+            auto has_work = [this, index]() {
+                return pending.load(std::memory_order_acquire) > 0 || queues[index]->own_pending.load(std::memory_order_acquire) > 0;
+            };
+
+            std::unique_lock<std::mutex> lock(sleep_mtx);
+            sleep_cv.wait(lock, [this, &has_work]() { return stopping.load() || has_work(); });
+
+            if (stopping.load() && !has_work())
+                return;
+        }
+    }
+
+    void ThreadPool::wait(TaskGroup& group) {
+        bool owner = current_pool == this && current_worker >= 0;
+        unsigned home = owner ? static_cast<unsigned>(current_worker) : 0;
+
+        while (group.remaining.load(std::memory_order_acquire) > 0) {
+            if (try_run_one(home, owner))
+                continue;
+
+            // nothing left to steal, sleep until the group finishes or new work may have appeared
+            std::unique_lock<std::mutex> lock(group.group_mtx);
+            group.done_cv.wait_for(lock, std::chrono::microseconds(200), [&group]() {
+                return group.remaining.load(std::memory_order_acquire) == 0;
+            });
+        }
+
+        std::lock_guard<std::mutex> lock(group.group_mtx);
+        if (group.error) {
+            std::exception_ptr error = group.error;
+            group.error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    unsigned ThreadPool::current_node() const {
+        return (current_pool == this && current_worker >= 0) ? worker_nodes[current_worker] : 0;
+    }
+
+    void ThreadPool::run_on_nodes(const std::function<void(unsigned)>& fn) {
+        if (num_nodes() < 2) {
+            fn(0);
+            return;
+        }
+
+        TaskGroup group;
+        for (unsigned node = 0; node < num_nodes(); node++)
+            submit_to(node_workers[node].front(), group, [&fn, node]() { fn(node); }, true);
+        wait(group);
+    }
+
+    size_t ThreadPool::first_task_of_node(unsigned node, size_t number_of_tasks) const {
+        size_t workers_before{0};
+        for (unsigned n = 0; n < node; n++)
+            workers_before += node_workers[n].size();
+
+        return number_of_tasks * workers_before / workers.size();
+    }
+
+    unsigned ThreadPool::queue_of_task(size_t task, size_t number_of_tasks) const {
+        unsigned node{0};
+        while (node + 1 < num_nodes() && task >= first_task_of_node(node + 1, number_of_tasks))
+            node++;
+
+        const std::vector<unsigned>& candidates = node_workers[node];
+        return candidates[(task - first_task_of_node(node, number_of_tasks)) % candidates.size()];
+    }
+
+    void ThreadPool::record_task(size_t items, std::chrono::steady_clock::time_point start) {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        WorkerStats& stats = worker_stats[(current_pool == this && current_worker >= 0) ? static_cast<size_t>(current_worker) : queues.size()];
+
+        stats.items.fetch_add(items, std::memory_order_relaxed);
+        stats.tasks.fetch_add(1, std::memory_order_relaxed);
+        stats.busy_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    std::vector<NodeStats> ThreadPool::node_stats() const {
+        std::vector<NodeStats> stats(num_nodes());
+        for (unsigned node = 0; node < num_nodes(); node++) {
+            stats[node].node = node_ids[node];
+            stats[node].workers = static_cast<unsigned>(node_workers[node].size());
+        }
+
+        // tasks run by waiting threads outside the pool count for node 0
+        for (size_t i = 0; i <= queues.size(); i++) {
+            NodeStats& node = stats[i < queues.size() ? worker_nodes[i] : 0];
+            node.items += worker_stats[i].items.load(std::memory_order_relaxed);
+            node.tasks += worker_stats[i].tasks.load(std::memory_order_relaxed);
+            node.busy_ns += worker_stats[i].busy_ns.load(std::memory_order_relaxed);
+        }
+
+        return stats;
+    }
+
+    void ThreadPool::reset_node_stats() {
+        for (size_t i = 0; i <= queues.size(); i++) {
+            worker_stats[i].items.store(0, std::memory_order_relaxed);
+            worker_stats[i].tasks.store(0, std::memory_order_relaxed);
+            worker_stats[i].busy_ns.store(0, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace tpool
@@ -0,0 +1,78 @@
+/* top_terms.cpp
+ * source file for top_terms.hpp
+ */
+
+#include "top_terms.hpp"
+#include "document.hpp"
+#include <algorithm>
+
+namespace topk {
+
+    // heap order: the term ranking last is on top
+    static bool heap_order(const scored_term& a, const scored_term& b) {
+        return ranks_before(a, b);
+    }
+
+    void BoundedHeap::push(const scored_term& term) {
+        if (k == 0)
+            return;
+
+        if (heap.size() == k && !ranks_before(term, heap.front()))
+            return; // most terms stop here once the heap is full
+
+        // only a term that would be kept is checked against the k kept ones
+        if (std::find(heap.begin(), heap.end(), term) != heap.end())
+            return;
+
+        if (heap.size() == k) {
+            std::pop_heap(heap.begin(), heap.end(), heap_order);
+            heap.back() = term;
+        } else {
+            heap.push_back(term);
+        }
+        std::push_heap(heap.begin(), heap.end(), heap_order);
+    }
+
+    void BoundedHeap::merge(const BoundedHeap& other) {
+        for (const scored_term& term : other.heap)
+            push(term);
+    }
+
+    std::vector<scored_term> BoundedHeap::sorted() const {
+        std::vector<scored_term> result(heap);
+        std::sort(result.begin(), result.end(), ranks_before);
+        return result;
+    }
+
+    extern void top_terms(const vocab::term_map<double>& tf_idf, size_t k, std::vector<scored_term>& top) {
+        top.clear();
+        if (k == 0)
+            return;
+
+        // min-heap of the k best seen so far, every term is unique within a document
+        for (const auto& term : tf_idf) {
+            if (top.size() < k) {
+                top.push_back(term);
+                std::push_heap(top.begin(), top.end(), heap_order);
+            } else if (ranks_before(term, top.front())) {
+                std::pop_heap(top.begin(), top.end(), heap_order);
+                top.back() = term;
+                std::push_heap(top.begin(), top.end(), heap_order);
+            }
+        }
+
+        std::sort_heap(top.begin(), top.end(), heap_order);
+    }
+
+    extern std::vector<std::vector<scored_term>> document_top_terms(const corpus::Corpus& corpus, size_t k, tpool::ThreadPool& thread_pool) {
+        std::vector<std::vector<scored_term>> result(corpus.documents.size());
+
+        thread_pool.parallel_for(corpus.documents.size(), [&](size_t begin, size_t end) {
+            for (size_t d = begin; d < end; d++)
+                top_terms(corpus.documents[d].tf_idf, k, result[d]);
+        });
+
+        return result;
+    }
+
+} // namespace topk
@@ -0,0 +1,180 @@
+/* trained_model.cpp
+ * source file for trained_model.hpp
+ */
+
+#include "trained_model.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace model {
+
+    static constexpr size_t SECTION_ALIGNMENT{8};
+
+    static uint64_t align_up(uint64_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    // size of a string section, offsets then bytes
+    static uint64_t string_section_size(const std::vector<uint64_t>& offsets) {
+        return offsets.size() * sizeof(uint64_t) + offsets.back();
+    }
+
+    static void write_padding(std::ofstream& out, uint64_t offset) {
+        static const char zeros[SECTION_ALIGNMENT]{};
+        out.write(zeros, align_up(offset) - offset);
+    }
+
+    extern void save_model(const std::string& file_name, const vocab::Vocabulary& vocabulary,
+                           const corpus::IdfTable& inverse_document_frequency, const cats::CentroidMatrix& centroids) {
+        size_t number_of_terms = vocabulary.size();
+        size_t number_of_categories = centroids.num_categories();
+
+        std::vector<uint64_t> term_offsets{0};
+        term_offsets.reserve(number_of_terms + 1);
+        for (size_t t = 0; t < number_of_terms; t++)
+            term_offsets.push_back(term_offsets.back() + vocabulary.term(static_cast<vocab::term_id>(t)).size());
+
+        std::vector<uint64_t> category_offsets{0};
+        for (size_t c = 0; c < number_of_categories; c++)
+            category_offsets.push_back(category_offsets.back() + centroids.category_type(c).size());
+
+        ModelHeader header{};
+        std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+        header.version = MODEL_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.num_terms = number_of_terms;
+        header.num_categories = number_of_categories;
+        header.num_matrix_terms = std::min(centroids.num_terms(), number_of_terms);
+        header.vocabulary_offset = align_up(sizeof(ModelHeader));
+        header.idf_offset = align_up(header.vocabulary_offset + string_section_size(term_offsets));
+        header.categories_offset = align_up(header.idf_offset + number_of_terms * sizeof(double));
+        header.norms_offset = align_up(header.categories_offset + string_section_size(category_offsets));
+        header.matrix_offset = align_up(header.norms_offset + number_of_categories * sizeof(double));
+        header.file_size = header.matrix_offset + header.num_matrix_terms * number_of_categories * sizeof(double);
+
+        std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("model file cannot be opened: " + file_name);
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        write_padding(out, sizeof(header));
+
+        out.write(reinterpret_cast<const char *>(term_offsets.data()), term_offsets.size() * sizeof(uint64_t));
+        for (size_t t = 0; t < number_of_terms; t++) {
+            const std::string& term = vocabulary.term(static_cast<vocab::term_id>(t));
+            out.write(term.data(), term.size());
+        }
+        write_padding(out, header.vocabulary_offset + string_section_size(term_offsets));
+
+        // terms interned after training (unknown documents) have no training idf
+        std::vector<double> idf(number_of_terms, 0.0);
+        for (size_t t = 0; t < number_of_terms; t++)
+            idf[t] = inverse_document_frequency[static_cast<vocab::term_id>(t)];
+        out.write(reinterpret_cast<const char *>(idf.data()), idf.size() * sizeof(double));
+
+        out.write(reinterpret_cast<const char *>(category_offsets.data()), category_offsets.size() * sizeof(uint64_t));
+        for (size_t c = 0; c < number_of_categories; c++)
+            out.write(centroids.category_type(c).data(), centroids.category_type(c).size());
+        write_padding(out, header.categories_offset + string_section_size(category_offsets));
+
+        for (size_t c = 0; c < number_of_categories; c++) {
+            double norm = centroids.norm(c);
+            out.write(reinterpret_cast<const char *>(&norm), sizeof(norm));
+        }
+
+        out.write(reinterpret_cast<const char *>(centroids.data()), header.num_matrix_terms * number_of_categories * sizeof(double));
+
+        if (!out)
+            throw std::runtime_error("model file cannot be written: " + file_name);
+    }
+
+    // throws unless [offset, offset + size) lies inside the file
+    static void check_section(const ModelHeader& header, uint64_t offset, uint64_t size, const char * section) {
+        if (offset % SECTION_ALIGNMENT != 0 || offset > header.file_size || size > header.file_size - offset)
+            throw std::runtime_error(std::string("model file is corrupt: bad ") + section + " section");
+    }
+
+    // validates a string section and returns its bytes
+    static const char * check_strings(const ModelHeader& header, const char * base, uint64_t offset, uint64_t count, const char * section) {
+        check_section(header, offset, (count + 1) * sizeof(uint64_t), section);
+        const uint64_t * offsets = reinterpret_cast<const uint64_t *>(base + offset);
+        uint64_t bytes_offset = offset + (count + 1) * sizeof(uint64_t);
+
+        for (uint64_t i = 0; i < count; i++)
+            if (offsets[i] > offsets[i + 1])
+                throw std::runtime_error(std::string("model file is corrupt: bad ") + section + " section");
+        check_section(header, bytes_offset, offsets[count], section);
+
+        return base + bytes_offset;
+    }
+
+    std::shared_ptr<const TrainedModel> TrainedModel::load(const std::string& file_name) {
+        auto file = std::make_shared<const io::MappedFile>(file_name);
+        std::string_view bytes = file->view();
+
+        if (bytes.size() < sizeof(ModelHeader) || std::memcmp(bytes.data(), MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0)
+            throw std::runtime_error("not a model file: " + file_name);
+
+        const ModelHeader& header = *reinterpret_cast<const ModelHeader *>(bytes.data());
+        if (header.byte_order != BYTE_ORDER_MARK)
+            throw std::runtime_error("model file was saved on a machine with another byte order: " + file_name);
+        if (header.version != MODEL_VERSION)
+            throw std::runtime_error("model file version " + std::to_string(header.version) + " is not supported (expected "
+                                     + std::to_string(MODEL_VERSION) + "): " + file_name);
+        if (header.file_size != bytes.size())
+            throw std::runtime_error("model file is truncated: " + file_name);
+        if (header.num_matrix_terms > header.num_terms
+            || header.num_terms >= vocab::UNKNOWN_TERM
+            || header.num_categories > header.file_size
+            || (header.num_categories != 0 && header.num_matrix_terms > header.file_size / sizeof(double) / header.num_categories))
+            throw std::runtime_error("model file is corrupt: bad counts");
+
+        const char * base = bytes.data();
+        auto model = std::make_shared<TrainedModel>();
+        model->header = &header;
+
+        model->vocabulary_bytes = check_strings(header, base, header.vocabulary_offset, header.num_terms, "vocabulary");
+        model->vocabulary_offsets = reinterpret_cast<const uint64_t *>(base + header.vocabulary_offset);
+
+        check_section(header, header.idf_offset, header.num_terms * sizeof(double), "idf");
+        model->idf = reinterpret_cast<const double *>(base + header.idf_offset);
+
+        const char * category_bytes = check_strings(header, base, header.categories_offset, header.num_categories, "categories");
+        const uint64_t * category_offsets = reinterpret_cast<const uint64_t *>(base + header.categories_offset);
+        std::vector<std::string> category_types;
+        category_types.reserve(header.num_categories);
+        for (uint64_t c = 0; c < header.num_categories; c++)
+            category_types.emplace_back(category_bytes + category_offsets[c], category_offsets[c + 1] - category_offsets[c]);
+
+        check_section(header, header.norms_offset, header.num_categories * sizeof(double), "norms");
+        const double * norms = reinterpret_cast<const double *>(base + header.norms_offset);
+
+        check_section(header, header.matrix_offset, header.num_matrix_terms * header.num_categories * sizeof(double), "centroid matrix");
+        model->centroid_matrix = cats::CentroidMatrix::from_weights(std::move(category_types),
+                                                                    std::vector<double>(norms, norms + header.num_categories),
+                                                                    reinterpret_cast<const double *>(base + header.matrix_offset),
+                                                                    header.num_matrix_terms, file);
+
+        model->file = std::move(file);
+        return model;
+    }
+
+    std::string_view TrainedModel::term(vocab::term_id id) const {
+        if (id >= header->num_terms)
+            throw std::out_of_range("term id " + std::to_string(id) + " is not in the model");
+
+        return {vocabulary_bytes + vocabulary_offsets[id], vocabulary_offsets[id + 1] - vocabulary_offsets[id]};
+    }
+
+    void TrainedModel::register_vocabulary(vocab::Vocabulary& vocabulary) const {
+        std::string term_string;
+        for (size_t t = 0; t < header->num_terms; t++) {
+            term_string.assign(term(static_cast<vocab::term_id>(t)));
+            if (vocabulary.intern(term_string) != t)
+                throw std::runtime_error("model vocabulary conflicts with the terms already interned at '" + term_string + "'");
+        }
+    }
+
+} // namespace model
@@ -0,0 +1,56 @@
+/* vocabulary.cpp
+ * source file for vocabulary.hpp
+ */
+
+#include "vocabulary.hpp"
+#include <mutex>
+#include <stdexcept>
+
+namespace vocab {
+
+    Vocabulary vocabulary;
+
+    term_id Vocabulary::intern(const std::string& term) {
+        {
+            std::shared_lock<std::shared_mutex> lock(vocab_mtx);
+            auto found = ids.find(term);
+            if (found != ids.end())
+                return found->second;
+        }
+
+        // another thread may have inserted it between the two locks
+        std::unique_lock<std::shared_mutex> lock(vocab_mtx);
+        auto [it, inserted] = ids.try_emplace(term, static_cast<term_id>(terms.size()));
+        if (inserted)
+            terms.push_back(term);
+
+        return it->second;
+    }
+
+    term_id Vocabulary::find(const std::string& term) const {
+        std::shared_lock<std::shared_mutex> lock(vocab_mtx);
+        auto found = ids.find(term);
+
+        return found == ids.end() ? UNKNOWN_TERM : found->second;
+    }
+
+    const std::string& Vocabulary::term(term_id id) const {
+        std::shared_lock<std::shared_mutex> lock(vocab_mtx);
+        if (id >= terms.size())
+            throw std::out_of_range("term id " + std::to_string(id) + " is not in the vocabulary");
+
+        return terms[id];
+    }
+
+    size_t Vocabulary::size() const {
+        std::shared_lock<std::shared_mutex> lock(vocab_mtx);
+        return terms.size();
+    }
+
+    void Vocabulary::clear() {
+        std::unique_lock<std::shared_mutex> lock(vocab_mtx);
+        ids.clear();
+        terms.clear();
+    }
+
+} // namespace vocab
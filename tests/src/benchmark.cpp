@@ -0,0 +1,222 @@
+/* benchmark.cpp */
+
+/* Kernel microbenchmarks.
+ * Times every hot kernel of the pipeline on its own, single
+ * threaded, over the documents of a bundled dataset. Each
+ * kernel gets untimed setup, warmup repetitions, then timed
+ * repetitions summarized as min/median/mean/stddev/p90/max
+ * and a throughput in tokens/s or docs/s off the median.
+ *
+ *  $ make bench
+ *  $ ./bench [dataset=1] [repetitions=10] [warmup=2] [kernel filter]
+ */
+
+#include "TFIDF.hpp"
+#include "preprocess.hpp"
+#include "stem_cache.hpp"
+#include "thread_pool.hpp"
+#include "top_terms.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+static volatile double sink; // keeps results alive so kernels are not optimized away
+
+/* statistics of one kernel's repetitions, in milliseconds */
+struct Summary {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double p90;
+    double max;
+};
+
+static Summary summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double variance{0.0};
+    for (double sample : samples)
+        variance += (sample - mean) * (sample - mean);
+
+    return Summary{
+        samples.front(),
+        n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2.0,
+        mean,
+        n > 1 ? std::sqrt(variance / (n - 1)) : 0.0,
+        samples[std::min(n - 1, static_cast<size_t>(0.9 * n))],
+        samples.back()
+    };
+}
+
+/* one kernel: untimed setup before every repetition, then the timed run */
+struct Kernel {
+    std::string name;
+    std::string unit;     // what the throughput counts, "tokens" or "docs"
+    size_t units;         // counted per repetition
+    std::function<void()> setup;
+    std::function<void()> run;
+};
+
+static void run_kernel(const Kernel& kernel, int repetitions, int warmup) {
+    for (int i = 0; i < warmup; i++) {
+        kernel.setup();
+        kernel.run();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(repetitions);
+    for (int i = 0; i < repetitions; i++) {
+        kernel.setup();
+        auto start = std::chrono::steady_clock::now();
+        kernel.run();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    Summary summary = summarize(samples);
+    std::cout << kernel.name << "\t" << kernel.units << " " << kernel.unit << "\t" << repetitions << "\t"
+              << summary.min << "\t" << summary.median << "\t" << summary.mean << "\t"
+              << summary.stddev << "\t" << summary.p90 << "\t" << summary.max << "\t"
+              << kernel.units / (summary.median / 1000.0) << " " << kernel.unit << "/s" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    int dataset = argc >= 2 ? atoi(argv[1]) : 1;
+    int repetitions = std::max(1, argc >= 3 ? atoi(argv[2]) : 10);
+    int warmup = std::max(0, argc >= 4 ? atoi(argv[3]) : 2);
+    std::string filter{argc >= 5 ? argv[4] : ""};
+
+    /* a fully processed corpus, every kernel reads its inputs from it */
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    corpus::Corpus corpus;
+    try {
+        read_csv_to_corpus(std::ref(corpus), input_folder + "training-data.csv");
+    } catch (std::runtime_error &e) {
+        std::cerr << "Cannot read dataset-" << dataset << ": " << e.what() << std::endl;
+        return 1;
+    }
+    vectorize_corpus_sequential(&corpus);
+    corpus.tfidf_documents_seq();
+    std::vector<cats::Category> categories = cats::seq::get_all_cat_seq(corpus);
+    corpus::IdfTable idf{corpus.inverse_document_frequency.data(), corpus.inverse_document_frequency.size()};
+
+    std::vector<docs::Document>& documents = corpus.documents;
+    size_t number_of_docs = documents.size();
+
+    /* every token of the corpus, for the per-token kernels */
+    std::vector<std::string> tokens;
+    for (const auto& document : documents) {
+        preprocess::Tokenizer tokenizer{document.raw_text()};
+        std::string_view token;
+        while (tokenizer.next(token))
+            tokens.emplace_back(token);
+    }
+
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({"preprocess_text", "docs", number_of_docs,
+        [&]() {
+            for (auto& document : documents)
+                document.text.clear(); // back to the mapped text, copied again by the kernel
+        },
+        [&]() {
+            for (auto& document : documents)
+                preprocess_text(&document);
+            sink = documents.back().text.size();
+        }});
+
+    kernels.push_back({"preprocess_prune_term", "tokens", tokens.size(),
+        []() {},
+        [&]() {
+            size_t length{0};
+            for (const auto& token : tokens)
+                length += preprocess_prune_term(token).size();
+            sink = length;
+        }});
+
+    // counting only, with a warm stem cache, term frequencies are the next kernel
+    kernels.push_back({"count_words_doc", "tokens", tokens.size(),
+        [&]() {
+            for (auto& document : documents) {
+                document.text.clear();
+                document.term_count.clear();
+                document.total_terms = 0;
+            }
+        },
+        [&]() {
+            for (auto& document : documents)
+                count_words_doc(&document);
+            sink = documents.back().total_terms;
+        }});
+
+    kernels.push_back({"calculate_term_frequency_doc", "docs", number_of_docs,
+        [&]() {
+            for (auto& document : documents)
+                document.term_frequency.clear();
+        },
+        [&]() {
+            for (auto& document : documents)
+                document.calculate_term_frequency_doc();
+            sink = documents.back().term_frequency.size();
+        }});
+
+    // emplace_tfidf_document is private, tfidf_document() is the same loop over an IdfTable
+    kernels.push_back({"emplace_tfidf_document", "docs", number_of_docs,
+        [&]() {
+            for (auto& document : documents)
+                document.tf_idf.clear();
+        },
+        [&]() {
+            for (auto& document : documents)
+                corpus::tfidf_document(&document, idf);
+            sink = documents.back().tf_idf.size();
+        }});
+
+    /* sort_unordered_umap was replaced by bounded top-k selection, a pool without workers
+     * keeps document_top_terms on this thread like the other kernels
+     */
+    tpool::ThreadPool serial_pool{0};
+    kernels.push_back({"document_top_terms", "docs", number_of_docs,
+        []() {},
+        [&]() {
+            std::vector<std::vector<topk::scored_term>> top = topk::document_top_terms(corpus, topk::DEFAULT_IMPORTANT_TERMS, serial_pool);
+            double best{0.0};
+            for (const auto& terms : top)
+                best += terms.empty() ? 0.0 : terms.front().second;
+            sink = best;
+        }});
+
+    /* put_tf_idf_all is private to Category, this times the whole sequential build:
+     * a corpus scan per category, the fold, top-k selection and the centroid
+     */
+    kernels.push_back({"get_all_cat_seq", "docs", number_of_docs,
+        []() {},
+        [&]() {
+            std::vector<cats::Category> built = cats::seq::get_all_cat_seq(corpus);
+            sink = built.size();
+        }});
+
+    // cosine_similarity is internal, classify_text() scores a document against every Category with it
+    kernels.push_back({"cosine_similarity", "docs", number_of_docs,
+        []() {},
+        [&]() {
+            size_t classified{0};
+            for (const auto& document : documents)
+                classified += !cats::classify_text(document.tf_idf, categories, document.category).classified_type.empty();
+            sink = classified;
+        }});
+
+    std::cout << "Dataset " << dataset << ": " << number_of_docs << " documents, " << tokens.size() << " tokens, "
+              << categories.size() << " categories, " << warmup << " warmup + " << repetitions << " repetitions" << std::endl;
+    std::cout << "Kernel\tUnits/rep\tReps\tMin (ms)\tMedian (ms)\tMean (ms)\tStddev (ms)\tp90 (ms)\tMax (ms)\tThroughput" << std::endl;
+
+    for (const Kernel& kernel : kernels)
+        if (filter.empty() || kernel.name.find(filter) != std::string::npos)
+            run_kernel(kernel, repetitions, warmup);
+
+    return 0;
+}
@@ -1,7 +1,835 @@
 /* main.cpp */
 
 #include "TFIDF.hpp"
+#include "corpus_generator.hpp"
+#include "stem_cache.hpp"
+#include "stopwords.hpp"
+#include <csignal>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <numeric>
+#include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* load a bundled dataset for benchmarking, falls back 
+ * to the testing text when no training CSV is bundled.
+ */
+static void load_benchmark_corpus(corpus::Corpus& corpus, const std::string& input_folder) {
+    try {
+        read_csv_to_corpus(std::ref(corpus), input_folder + "training-data.csv");
+    } catch (std::runtime_error &e) {
+        read_unknown_text(std::ref(corpus), input_folder + "testing-data.txt");
+    }
+}
+
+/* Document-frequency benchmark.
+ * Compares the original per-term corpus rescan against the
+ * precomputed document-frequency index on all bundled datasets.
+ */
+static int run_df_benchmark(int num_threads) {
+    std::cout << "Dataset\tDocuments\tTerms\tRescan (ms)\tIndexed (ms)\tSpeedup\tMax Diff" << std::endl;
+
+    for (int dataset = 1; dataset <= 3; dataset++) {
+        std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+        corpus::Corpus rescan_corpus;
+        corpus::Corpus indexed_corpus;
+
+        try {
+            load_benchmark_corpus(rescan_corpus, input_folder);
+            load_benchmark_corpus(indexed_corpus, input_folder);
+        } catch (std::runtime_error &e) {
+            std::cerr << "Skipping dataset-" << dataset << ": " << e.what() << std::endl;
+            continue;
+        }
+
+        vectorize_corpus_threaded(&rescan_corpus, num_threads);
+        vectorize_corpus_threaded(&indexed_corpus, num_threads);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        rescan_corpus.tfidf_documents_rescan(num_threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        double rescan_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        indexed_corpus.tfidf_documents(num_threads);
+        end = std::chrono::high_resolution_clock::now();
+        double indexed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        /* both paths must produce the same weights */
+        double max_diff{0.0};
+        for (size_t i = 0; i < indexed_corpus.documents.size(); i++)
+            for (const auto& [word, tf_idf] : indexed_corpus.documents[i].tf_idf)
+                max_diff = std::max(max_diff, std::fabs(tf_idf - rescan_corpus.documents[i].tf_idf.at(word)));
+
+        std::cout << dataset << "\t" << indexed_corpus.documents.size() << "\t" 
+                  << indexed_corpus.get_num_unique_terms() << "\t" 
+                  << rescan_ms << "\t" << indexed_ms << "\t" 
+                  << rescan_ms / indexed_ms << "x\t" << max_diff << std::endl;
+    }
+
+    return 0;
+}
+
+/* Online classification latency benchmark.
+ * Trains on a dataset, then classifies every testing
+ * line one at a time through TFIDF_::classify() from
+ * num_threads threads and reports the distribution.
+ */
+static int run_classify_benchmark(int dataset, int num_threads) {
+    static constexpr int ROUNDS{20};
+
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    TFIDF::TFIDF_ tfidf{true, input_folder + "training-data.csv", input_folder + "testing-data.txt", 
+                        input_folder + "testing-correct-data.txt", "", "", 
+                        true, true, false, false, false, false, true, num_threads};
+    tfidf.process_training_data();
+
+    corpus::Corpus texts;
+    std::vector<std::string> correct_types;
+    try {
+        read_unknown_text(std::ref(texts), input_folder + "testing-data.txt");
+        correct_types = read_unknown_cats(input_folder + "testing-correct-data.txt");
+    } catch (std::runtime_error &e) {
+        std::cerr << "Cannot read dataset-" << dataset << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    /* one warm pass, also checks the labels */
+    int correct{0};
+    try {
+        for (size_t i = 0; i < texts.documents.size(); i++) {
+            cats::Prediction prediction = tfidf.classify(texts.documents[i].raw_text());
+            correct += i < correct_types.size() && prediction.label == correct_types[i];
+        }
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<double>> latencies(std::max(1, num_threads));
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& thread_latencies : latencies) {
+        threads.emplace_back([&tfidf, &texts, &thread_latencies]() {
+            cats::Prediction prediction;
+            thread_latencies.reserve(texts.documents.size() * ROUNDS);
+            for (int round = 0; round < ROUNDS; round++) {
+                for (const auto& document : texts.documents) {
+                    auto call_start = std::chrono::steady_clock::now();
+                    prediction = tfidf.classify(document.raw_text());
+                    auto call_end = std::chrono::steady_clock::now();
+                    thread_latencies.push_back(std::chrono::duration<double, std::micro>(call_end - call_start).count());
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& thread_latencies : latencies)
+        all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+    std::sort(all.begin(), all.end());
+
+    auto percentile = [&all](double p) {
+        return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+    };
+    double mean = std::accumulate(all.begin(), all.end(), 0.0) / all.size();
+
+    std::cout << "Dataset\tThreads\tCalls\tAccuracy (%)\tMean (us)\tp50 (us)\tp90 (us)\tp99 (us)\tp99.9 (us)\tMax (us)\tCalls/s" << std::endl;
+    std::cout << dataset << "\t" << latencies.size() << "\t" << all.size() << "\t" 
+              << 100.0 * correct / std::max<size_t>(1, texts.documents.size()) << "\t" 
+              << mean << "\t" << percentile(0.50) << "\t" << percentile(0.90) << "\t" 
+              << percentile(0.99) << "\t" << percentile(0.999) << "\t" << all.back() << "\t" 
+              << all.size() / wall_ms * 1000.0 << std::endl;
+
+    return 0;
+}
+
+/* Incremental training benchmark.
+ * Splits a training set into batches and adds them one at
+ * a time to an IncrementalModel, against a full CSR retrain
+ * on every prefix, and checks both give the same centroids.
+ * The batches are also written as CSV files and fed to a
+ * TFIDF_ through add_training_data(), checked the same way.
+ */
+static int run_incremental_benchmark(int dataset, int num_batches) {
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+    corpus::Corpus all_documents;
+
+    try {
+        read_csv_to_corpus(std::ref(all_documents), input_folder + "training-data.csv", thread_pool);
+    } catch (std::runtime_error &e) {
+        std::cerr << "Cannot read dataset-" << dataset << ": " << e.what() << std::endl;
+        return 1;
+    }
+    vectorize_corpus_threaded(&all_documents, thread_pool);
+
+    size_t number_of_docs = all_documents.documents.size();
+    num_batches = static_cast<int>(std::clamp<size_t>(std::max(1, num_batches), 1, std::max<size_t>(1, number_of_docs)));
+
+    /* every batch as a CSV file with the training header */
+    std::string batch_folder{"tests/output/incremental/"};
+    std::vector<std::string> batch_files;
+    try {
+        io::MappedFile training_file{input_folder + "training-data.csv"};
+        std::vector<std::string_view> records = io::index_records(training_file.view(), true, thread_pool);
+        if (records.size() != number_of_docs + 1)
+            throw std::runtime_error("record count does not match the corpus");
+
+        std::filesystem::create_directories(batch_folder);
+        for (int batch_index = 0; batch_index < num_batches; batch_index++) {
+            batch_files.push_back(batch_folder + "batch-" + std::to_string(batch_index + 1) + ".csv");
+            std::ofstream batch_file{batch_files.back(), std::ios::binary};
+            batch_file << records[0] << '\n';
+            for (size_t i = number_of_docs * batch_index / num_batches; i < number_of_docs * (batch_index + 1) / num_batches; i++)
+                batch_file << records[i + 1] << '\n';
+            if (!batch_file)
+                throw std::runtime_error("cannot write " + batch_files.back());
+        }
+    } catch (std::runtime_error &e) {
+        std::cerr << "Cannot split dataset-" << dataset << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    /* trained on the first batch, then fed the others */
+    TFIDF::TFIDF_ tfidf{true, batch_files.front(), "", "", "", "", 
+                        true, true, false, false, false, false, true, -1, true};
+
+    cats::IncrementalModel model;
+    corpus::Corpus prefix;
+    bool exact{true};
+
+    std::cout << "Batch	Documents	Retrain (ms)	Update (ms)	Centroids (ms)	Speedup	Max Rel Diff	TFIDF_ (ms)	TFIDF_ Max Rel Diff" << std::endl;
+    for (int batch_index = 0; batch_index < num_batches; batch_index++) {
+        size_t begin = number_of_docs * batch_index / num_batches;
+        size_t end = number_of_docs * (batch_index + 1) / num_batches;
+
+        corpus::Corpus batch;
+        batch.documents.assign(all_documents.documents.begin() + begin, all_documents.documents.begin() + end);
+        prefix.documents.insert(prefix.documents.end(), batch.documents.begin(), batch.documents.end());
+
+        /* full retrain on every document so far */
+        auto start = std::chrono::high_resolution_clock::now();
+        corpus::FrozenCorpus retrained{prefix, thread_pool};
+        retrained.tfidf_documents(thread_pool);
+        cats::centroids_s expected = cats::csr::get_all_centroids_csr(retrained, thread_pool);
+        double retrain_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        /* fold in the new batch only */
+        start = std::chrono::high_resolution_clock::now();
+        model.add_documents(corpus::FrozenCorpus{batch, thread_pool}, thread_pool);
+        double update_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        cats::centroids_s actual = model.centroids(thread_pool);
+        double centroids_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        double max_diff = cats::incremental::max_relative_difference(expected, actual);
+        corpus::IdfTable idf = model.idf();
+        for (size_t word = 0; word < retrained.inverse_document_frequency.size(); word++)
+            max_diff = std::max(max_diff, std::fabs(retrained.inverse_document_frequency[word] - idf[static_cast<vocab::term_id>(word)]));
+
+        /* the same batch through TFIDF_, which also refreshes its centroid matrix and online classifier */
+        start = std::chrono::high_resolution_clock::now();
+        bool added{true};
+        if (batch_index == 0)
+            tfidf.process_training_data();
+        else
+            added = tfidf.add_training_data(batch_files[batch_index]);
+        double tfidf_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        double tfidf_diff = added && tfidf.online_classifier ? cats::incremental::max_relative_difference(expected, tfidf.trained_centroids) 
+                                                               : std::numeric_limits<double>::infinity();
+        exact = exact && max_diff < 1e-9 && tfidf_diff < 1e-9;
+
+        std::cout << batch_index + 1 << "\t" << model.num_docs() << "\t" << retrain_ms << "\t" 
+                  << update_ms << "\t" << centroids_ms << "\t" 
+                  << retrain_ms / (update_ms + centroids_ms) << "x\t" << max_diff << "\t"
+                  << tfidf_ms << "\t" << tfidf_diff << std::endl;
+    }
+
+    std::cout << "Matches full retrain: " << (exact ? "yes" : "no") << std::endl;
+    return exact ? 0 : 1;
+}
+
+/* classification daemon, see ClassifyServer */
+static serve::ClassifyServer * running_server{nullptr};
+
+static void stop_running_server(int) {
+    if (running_server != nullptr)
+        running_server->stop(); // a lock-free store, safe in a signal handler
+}
+
+/* load the saved model of a dataset, or train it when there is none */
+static void prepare_model(TFIDF::TFIDF_& tfidf, int dataset) {
+    std::string model_file{"tests/output/model-" + std::to_string(dataset) + ".bin"};
+    if (std::filesystem::exists(model_file) && tfidf.load_model(model_file)) {
+        std::cerr << "Loaded model " << model_file << std::endl;
+        return;
+    }
+
+    std::cerr << "No model at " << model_file << ", training on dataset " << dataset << std::endl;
+    tfidf.process_training_data();
+}
+
+static TFIDF::TFIDF_ make_serving_tfidf(int dataset) {
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    return TFIDF::TFIDF_{true, input_folder + "training-data.csv", input_folder + "testing-data.txt", 
+                         input_folder + "testing-correct-data.txt", "", "", 
+                         true, true, false, false, false, false, true, -1};
+}
+
+static void print_server_stats(const serve::ServerStats& stats, double wall_ms) {
+    std::cerr << "Served " << stats.documents << " documents over " << stats.connections << " connections in " 
+              << stats.batches << " batches (" << stats.average_batch() << " per batch), " 
+              << stats.documents / wall_ms * 1000.0 << " documents/s" << std::endl;
+}
+
+/* Classification daemon.
+ * Answers newline-delimited documents on stdin/stdout,
+ * or on a Unix socket until SIGINT/SIGTERM.
+ */
+static int run_server(int dataset, const std::string& socket_path) {
+    TFIDF::TFIDF_ tfidf = make_serving_tfidf(dataset);
+    prepare_model(tfidf, dataset);
+
+    std::unique_ptr<serve::ClassifyServer> server;
+    try {
+        server = tfidf.make_server();
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (socket_path.empty()) {
+        std::ios::sync_with_stdio(false); // lets the server see lines already buffered
+        server->serve_stream(std::cin, std::cout);
+    } else {
+        running_server = server.get();
+        std::signal(SIGINT, stop_running_server);
+        std::signal(SIGTERM, stop_running_server);
+        try {
+            std::cerr << "Listening on " << socket_path << std::endl;
+            server->serve_socket(socket_path);
+        } catch (std::runtime_error &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        running_server = nullptr;
+    }
+
+    print_server_stats(server->stats(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
+
+static int connect_unix_socket(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    // the server may still be binding
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+/* Classification server throughput benchmark.
+ * Serves a dataset's model on a local socket and
+ * has num_clients connections each stream every
+ * testing line ROUNDS times, pipelined.
+ */
+static int run_serve_benchmark(int dataset, int num_clients) {
+    static constexpr int ROUNDS{10};
+
+    TFIDF::TFIDF_ tfidf = make_serving_tfidf(dataset);
+    prepare_model(tfidf, dataset);
+
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    corpus::Corpus texts;
+    std::vector<std::string> correct_types;
+    std::unique_ptr<serve::ClassifyServer> server;
+    try {
+        read_unknown_text(std::ref(texts), input_folder + "testing-data.txt");
+        correct_types = read_unknown_cats(input_folder + "testing-correct-data.txt");
+        server = tfidf.make_server();
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string request;
+    for (const auto& document : texts.documents) {
+        request += document.raw_text();
+        request += '\n';
+    }
+
+    std::string socket_path{"/tmp/tfidf-bench-" + std::to_string(getpid()) + ".sock"};
+    std::thread server_thread([&server, &socket_path]() { server->serve_socket(socket_path); });
+
+    std::vector<int> correct(std::max(1, num_clients), 0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t client = 0; client < correct.size(); client++) {
+        clients.emplace_back([&, client]() {
+            int fd = connect_unix_socket(socket_path);
+            if (fd < 0)
+                return;
+
+            std::thread writer([fd, &request]() {
+                for (int round = 0; round < ROUNDS; round++)
+                    for (size_t sent = 0; sent < request.size();) {
+                        ssize_t n = write(fd, request.data() + sent, request.size() - sent);
+                        if (n <= 0)
+                            return;
+                        sent += static_cast<size_t>(n);
+                    }
+            });
+
+            // every reply is one line, the first round is checked against the correct labels
+            size_t expected = texts.documents.size() * ROUNDS;
+            size_t replies{0};
+            std::string pending;
+            char chunk[1 << 14];
+            while (replies < expected) {
+                ssize_t n = read(fd, chunk, sizeof(chunk));
+                if (n <= 0)
+                    break;
+                pending.append(chunk, static_cast<size_t>(n));
+
+                size_t begin{0};
+                size_t newline;
+                while ((newline = pending.find('\n', begin)) != std::string::npos) {
+                    size_t index = replies % texts.documents.size();
+                    std::string label = pending.substr(begin, pending.find('\t', begin) - begin);
+                    if (replies < texts.documents.size() && index < correct_types.size() && label == correct_types[index])
+                        correct[client]++;
+                    replies++;
+                    begin = newline + 1;
+                }
+                pending.erase(0, begin);
+            }
+
+            writer.join();
+            close(fd);
+        });
+    }
+    for (auto& client : clients)
+        client.join();
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    server->stop();
+    server_thread.join();
+
+    serve::ServerStats stats = server->stats();
+    std::cout << "Dataset\tClients\tDocuments\tBatches\tAvg Batch\tAccuracy (%)\tWall (ms)\tDocuments/s" << std::endl;
+    std::cout << dataset << "\t" << correct.size() << "\t" << stats.documents << "\t" << stats.batches << "\t" 
+              << stats.average_batch() << "\t" << 100.0 * correct[0] / std::max<size_t>(1, texts.documents.size()) << "\t" 
+              << wall_ms << "\t" << stats.documents / wall_ms * 1000.0 << std::endl;
+
+    return 0;
+}
+
+/* CSV quoting regression check.
+ * A quote only opens a quoted field as the first character of
+ * a field, so a stray inch mark must not merge later records.
+ * Reads tests/data/csv-quotes/ through the mapped reader and the
+ * streaming reader, then splits a copy large enough for many
+ * chunks both in parallel and sequentially.
+ */
+static int run_csv_check(int num_threads) {
+    const std::string file_name{"tests/data/csv-quotes/training-data.csv"};
+    const std::vector<std::string> expected_categories{"sport", "tech", "business", "politics"};
+    const std::vector<std::string> expected_texts{
+        "a 12\" sub woofer for the stadium",
+        "a quoted \"field\", with a comma\nand a newline",
+        "plain text ending in a quote\"",
+        "\"closed\" then more text"
+    };
+    tpool::ThreadPool thread_pool{static_cast<unsigned>(std::max(1, num_threads))};
+    int failures{0};
+
+    auto check = [&failures](bool passed, const std::string& what) {
+        std::cout << (passed ? "PASS\t" : "FAIL\t") << what << std::endl;
+        failures += !passed;
+    };
+
+    corpus::Corpus corpus;
+    read_csv_to_corpus(corpus, file_name, thread_pool);
+    check(corpus.documents.size() == expected_categories.size(), "mapped reader: " + std::to_string(corpus.documents.size()) + " documents");
+    for (size_t i = 0; i < std::min(corpus.documents.size(), expected_categories.size()); i++)
+        check(corpus.documents[i].category == expected_categories[i] && corpus.documents[i].raw_text() == expected_texts[i],
+              "mapped reader: record " + std::to_string(i + 1));
+
+    corpus::FrozenCorpus streamed = stream::stream_corpus(file_name, stream::InputFormat::csv, thread_pool, stream::StreamSettings{1, 2});
+    check(streamed.matrix.num_rows() == expected_categories.size(), "streaming reader: " + std::to_string(streamed.matrix.num_rows()) + " documents");
+    for (size_t i = 0; i < std::min(streamed.row_category.size(), expected_categories.size()); i++)
+        check(streamed.row_category[i] >= 0 && streamed.category_types[streamed.row_category[i]] == expected_categories[i],
+              "streaming reader: record " + std::to_string(i + 1));
+
+    /* chunks start at arbitrary bytes, inside quoted fields and right after stray quotes */
+    io::MappedFile file{file_name};
+    std::string_view fixture = file.view();
+    std::string records{fixture.substr(fixture.find('\n') + 1)};
+    std::string text{fixture.substr(0, fixture.find('\n') + 1)};
+    while (text.size() < (1 << 22))
+        text += records;
+
+    std::vector<std::string_view> indexed = io::index_records(text, true, thread_pool);
+    std::vector<std::string_view> sequential;
+    std::string_view record;
+    size_t position{0};
+    while (io::next_record(text, position, true, record))
+        sequential.push_back(record);
+    size_t expected_records = 1 + (text.size() - fixture.find('\n') - 1) / records.size() * expected_categories.size();
+    check(indexed == sequential && indexed.size() == expected_records,
+          "chunked index: " + std::to_string(indexed.size()) + " records, expected " + std::to_string(expected_records));
+
+    return failures == 0 ? 0 : 1;
+}
+
+/* Synthetic corpus generator.
+ * Writes a seeded Zipfian dataset into
+ * tests/data/dataset-<dataset>/, so every
+ * other mode can run on it by number.
+ */
+static int run_generator(int argc, char * argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: ./test generate <dataset> [threads] [--docs=N] [--testing=F] [--vocab=N] [--zipf=S] "
+                  << "[--length=fixed|uniform|lognormal] [--mean-length=N] [--length-sigma=S] [--min-length=N] [--max-length=N] "
+                  << "[--categories=N] [--skew=F] [--seed=N] [--overwrite]" << std::endl;
+        return 1;
+    }
+
+    int dataset = atoi(argv[2]);
+    int num_threads{-1};
+    bool overwrite{false};
+    gen::CorpusConfig config;
+
+    try {
+        for (int i = 3; i < argc; i++) {
+            std::string arg{argv[i]};
+            size_t equals = arg.find('=');
+            std::string key{arg.substr(0, equals)};
+            std::string value{equals == std::string::npos ? "" : arg.substr(equals + 1)};
+
+            if (arg.rfind("--", 0) != 0)
+                num_threads = std::stoi(arg);
+            else if (key == "--overwrite")
+                overwrite = true;
+            else if (key == "--docs")
+                config.num_docs = std::stoull(value);
+            else if (key == "--testing")
+                config.testing_fraction = std::stod(value);
+            else if (key == "--vocab")
+                config.vocabulary_size = std::stoull(value);
+            else if (key == "--zipf")
+                config.zipf_exponent = std::stod(value);
+            else if (key == "--length")
+                config.length_distribution = gen::parse_length_distribution(value);
+            else if (key == "--mean-length")
+                config.mean_length = std::stoull(value);
+            else if (key == "--length-sigma")
+                config.length_sigma = std::stod(value);
+            else if (key == "--min-length")
+                config.min_length = std::stoull(value);
+            else if (key == "--max-length")
+                config.max_length = std::stoull(value);
+            else if (key == "--categories")
+                config.num_categories = std::stoull(value);
+            else if (key == "--skew")
+                config.category_skew = std::stod(value);
+            else if (key == "--seed")
+                config.seed = std::stoull(value);
+            else
+                throw std::invalid_argument("Unknown option: " + arg);
+        }
+    } catch (std::logic_error &e) {
+        std::cerr << "Cannot parse generator options: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string output_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    if (!overwrite && std::ifstream{output_folder + "training-data.csv"}.good()) {
+        std::cerr << output_folder << " already holds a dataset, pass --overwrite to replace it" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    gen::CorpusSummary summary;
+    try {
+        tpool::ThreadPool thread_pool{tpool::workers_for(num_threads)};
+        summary = gen::write_corpus(config, output_folder, thread_pool);
+    } catch (std::exception &e) {
+        std::cerr << "Cannot generate dataset-" << dataset << ": " << e.what() << std::endl;
+        return 1;
+    }
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Dataset\tTraining\tTesting\tTokens\tMiB\tVocabulary\tCategories\tSeed\tWall (ms)" << std::endl;
+    std::cout << dataset << "\t" << summary.training_docs << "\t" << summary.testing_docs << "\t" << summary.tokens << "\t" 
+              << summary.bytes / (1024.0 * 1024.0) << "\t" << config.vocabulary_size << "\t" << config.num_categories << "\t" 
+              << config.seed << "\t" << wall_ms << std::endl;
+
+    return 0;
+}
+
+/* Strong and weak scaling harness.
+ * Maps a dataset once, warms the stem cache and the
+ * vocabulary with an untimed pass, then times every
+ * stage on prefixes of the training and testing sets
+ * for every thread count, in this one process.
+ */
+static constexpr std::array<const char *, 5> SCALING_STAGES{"read", "vectorization", "tfidf", "categories", "classification"};
+
+/* splits "1,2,4" style lists */
+static std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> values;
+    size_t begin{0};
+    while (begin <= text.size()) {
+        size_t comma = std::min(text.find(',', begin), text.size());
+        values.push_back(text.substr(begin, comma - begin));
+        begin = comma + 1;
+    }
+    return values;
+}
+
+/* one run of every stage on the first training_docs / testing_docs records */
+static std::array<double, SCALING_STAGES.size()> run_scaling_point(const std::vector<std::string_view>& training_records, size_t training_docs, 
+                                                                   const std::vector<std::string_view>& testing_records, size_t testing_docs, 
+                                                                   tpool::ThreadPool& thread_pool) {
+    std::array<double, SCALING_STAGES.size()> stage_ms{};
+    auto start = std::chrono::steady_clock::now();
+    auto lap = [&](size_t stage) {
+        auto now = std::chrono::steady_clock::now();
+        stage_ms[stage] = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+    };
+
+    /* the prefixes end where their last record does, the header stays in the training one */
+    std::string_view training_text{training_records[0].data(), 
+                                   static_cast<size_t>(training_records[training_docs].data() + training_records[training_docs].size() - training_records[0].data())};
+    std::string_view testing_text{testing_records[0].data(), 
+                                  static_cast<size_t>(testing_records[testing_docs - 1].data() + testing_records[testing_docs - 1].size() - testing_records[0].data())};
+
+    corpus::Corpus training;
+    corpus::Corpus testing;
+    std::vector<std::string_view> records = io::index_records(training_text, true, thread_pool);
+    training.add_documents(records.size() - 1);
+    thread_pool.parallel_for(records.size() - 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            parse_csv_record(records[i + 1], training.documents[i]);
+    });
+    for (const auto& document : training.documents)
+        if (training.category_types_set.insert(document.category).second)
+            training.num_of_categories++;
+    training.num_of_docs.store(static_cast<int>(training.documents.size()));
+    records = io::index_records(testing_text, false, thread_pool);
+    testing.add_documents(records.size());
+    thread_pool.parallel_for(records.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            testing.documents[i].text_view = records[i];
+    });
+    testing.num_of_docs.store(static_cast<int>(testing.documents.size()));
+    lap(0);
+
+    vectorize_corpus_threaded(&training, thread_pool);
+    lap(1);
+
+    training.tfidf_documents(thread_pool);
+    lap(2);
+
+    auto centroids = cats::CentroidMatrix::from_categories(cats::par::get_all_cat_par(training, thread_pool));
+    lap(3);
+
+    vectorize_corpus_threaded(&testing, thread_pool);
+    testing.tfidf_documents(corpus::IdfTable{training.inverse_document_frequency.data(), training.inverse_document_frequency.size()}, thread_pool);
+    cats::BatchScores scores = cats::BatchClassifier{centroids}.classify(testing, thread_pool);
+    lap(4);
+
+    return stage_ms;
+}
+
+static int run_scaling_harness(int argc, char * argv[]) {
+    int dataset = argc >= 3 ? atoi(argv[2]) : 1;
+    int repetitions{3};
+    std::vector<unsigned> thread_counts;
+    std::vector<double> size_fractions;
+
+    try {
+        for (int i = 3; i < argc; i++) {
+            std::string arg{argv[i]};
+            if (arg.rfind("--threads=", 0) == 0)
+                for (const std::string& count : split_list(arg.substr(std::strlen("--threads="))))
+                    thread_counts.push_back(static_cast<unsigned>(std::max(1, std::stoi(count))));
+            else if (arg.rfind("--sizes=", 0) == 0)
+                for (const std::string& fraction : split_list(arg.substr(std::strlen("--sizes="))))
+                    size_fractions.push_back(std::stod(fraction));
+            else if (arg.rfind("--repetitions=", 0) == 0)
+                repetitions = std::max(1, std::stoi(arg.substr(std::strlen("--repetitions="))));
+            else
+                throw std::invalid_argument("Unknown option: " + arg);
+        }
+    } catch (std::logic_error &e) {
+        std::cerr << "Usage: ./test scaling <dataset> [--threads=1,2,4] [--sizes=0.25,0.5,1] [--repetitions=3]" << std::endl 
+                  << "Cannot parse scaling options: " << e.what() << std::endl;
+        return 1;
+    }
+
+    /* powers of two up to the hardware threads, and sizes proportional to them for weak scaling */
+    if (thread_counts.empty()) {
+        unsigned hardware_threads = std::max(1u, NUMBER_OF_THREADS_MAX);
+        for (unsigned count = 1; count < hardware_threads; count *= 2)
+            thread_counts.push_back(count);
+        thread_counts.push_back(hardware_threads);
+    }
+    std::sort(thread_counts.begin(), thread_counts.end());
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+    if (size_fractions.empty())
+        for (unsigned count : thread_counts)
+            size_fractions.push_back(static_cast<double>(count) / thread_counts.back());
+    std::sort(size_fractions.begin(), size_fractions.end());
+
+    /* map both files and find their records once, every point reads from the page cache */
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
+    std::unique_ptr<io::MappedFile> training_file;
+    std::unique_ptr<io::MappedFile> testing_file;
+    std::vector<std::string_view> training_records;
+    std::vector<std::string_view> testing_records;
+    {
+        tpool::ThreadPool thread_pool{tpool::workers_for(-1)};
+        try {
+            training_file = std::make_unique<io::MappedFile>(input_folder + "training-data.csv");
+            testing_file = std::make_unique<io::MappedFile>(input_folder + "testing-data.txt");
+        } catch (std::runtime_error &e) {
+            std::cerr << "Cannot read dataset-" << dataset << ": " << e.what() << std::endl;
+            return 1;
+        }
+        training_records = io::index_records(training_file->view(), true, thread_pool);
+        testing_records = io::index_records(testing_file->view(), false, thread_pool);
+        if (training_records.size() < 2 || testing_records.empty()) {
+            std::cerr << "Cannot read dataset-" << dataset << ": no documents" << std::endl;
+            return 1;
+        }
+
+        // untimed, so the stem cache and vocabulary are warm for every point alike
+        run_scaling_point(training_records, training_records.size() - 1, testing_records, testing_records.size(), thread_pool);
+    }
+
+    struct Point {
+        size_t fraction;    // index into size_fractions
+        size_t threads;     // index into thread_counts
+        size_t docs;
+        std::array<double, SCALING_STAGES.size() + 1> ms; // median of every stage, then of their total
+    };
+    std::vector<Point> points;
+
+    for (size_t t = 0; t < thread_counts.size(); t++) {
+        /* the thread waiting on a parallel_for runs tasks too, so p threads are p - 1 workers
+         * and the caller, 1 thread runs everything on the caller. Not capped, so counts above
+         * the hardware threads show oversubscription.
+         */
+        tpool::ThreadPool thread_pool{thread_counts[t] - 1};
+
+        for (size_t f = 0; f < size_fractions.size(); f++) {
+            double fraction = std::clamp(size_fractions[f], 0.0, 1.0);
+            size_t training_docs = std::max<size_t>(1, static_cast<size_t>(std::llround(fraction * (training_records.size() - 1))));
+            size_t testing_docs = std::max<size_t>(1, static_cast<size_t>(std::llround(fraction * testing_records.size())));
+
+            std::vector<std::array<double, SCALING_STAGES.size() + 1>> runs(repetitions);
+            for (auto& run : runs) {
+                auto stage_ms = run_scaling_point(training_records, training_docs, testing_records, testing_docs, thread_pool);
+                std::copy(stage_ms.begin(), stage_ms.end(), run.begin());
+                run.back() = std::accumulate(stage_ms.begin(), stage_ms.end(), 0.0);
+            }
+
+            Point point{f, t, training_docs, {}};
+            for (size_t stage = 0; stage < point.ms.size(); stage++) {
+                std::vector<double> samples;
+                for (const auto& run : runs)
+                    samples.push_back(run[stage]);
+                std::sort(samples.begin(), samples.end());
+                point.ms[stage] = samples[samples.size() / 2];
+            }
+            points.push_back(point);
+        }
+    }
+
+    auto find_point = [&](size_t fraction, size_t threads) -> const Point * {
+        for (const Point& point : points)
+            if (point.fraction == fraction && point.threads == threads)
+                return &point;
+        return nullptr;
+    };
+
+    /* strong scaling against 1 thread at the same size, weak scaling against
+     * 1 thread at size / threads when that size was swept too
+     */
+    std::string report_file{"tests/output/results/scaling-" + std::to_string(dataset) + ".csv"};
+    std::ofstream report{report_file};
+    if (!report)
+        std::cerr << "Cannot write " << report_file << ", printing the report only" << std::endl;
+
+    const std::string header{"stage,size_fraction,documents,threads,median_ms,speedup,efficiency,karp_flatt,weak_efficiency"};
+    report << header << "\n";
+    std::cout << "Stage\tSize\tDocuments\tThreads\tMedian (ms)\tSpeedup\tEfficiency\tKarp-Flatt\tWeak Efficiency" << std::endl;
+
+    bool has_single_thread = thread_counts.front() == 1;
+    for (size_t stage = 0; stage <= SCALING_STAGES.size(); stage++) {
+        std::string stage_name{stage < SCALING_STAGES.size() ? SCALING_STAGES[stage] : "total"};
+
+        for (const Point& point : points) {
+            double threads = thread_counts[point.threads];
+            double ms = point.ms[stage];
+            std::string speedup, efficiency, karp_flatt, weak_efficiency;
+
+            const Point * serial = has_single_thread ? find_point(point.fraction, 0) : nullptr;
+            if (serial != nullptr && ms > 0.0) {
+                double s = serial->ms[stage] / ms;
+                speedup = std::to_string(s);
+                efficiency = std::to_string(s / threads);
+                if (threads > 1)
+                    karp_flatt = std::to_string((1.0 / s - 1.0 / threads) / (1.0 - 1.0 / threads));
+            }
+
+            for (size_t f = 0; has_single_thread && f < size_fractions.size() && ms > 0.0; f++) {
+                if (std::fabs(size_fractions[f] * threads - size_fractions[point.fraction]) < 1e-9) {
+                    if (const Point * base = find_point(f, 0))
+                        weak_efficiency = std::to_string(base->ms[stage] / ms);
+                }
+            }
+
+            report << stage_name << "," << size_fractions[point.fraction] << "," << point.docs << "," << threads << "," << ms << "," 
+                   << speedup << "," << efficiency << "," << karp_flatt << "," << weak_efficiency << "\n";
+            std::cout << stage_name << "\t" << size_fractions[point.fraction] << "\t" << point.docs << "\t" << threads << "\t" << ms << "\t" 
+                      << (speedup.empty() ? "-" : speedup) << "\t" << (efficiency.empty() ? "-" : efficiency) << "\t" 
+                      << (karp_flatt.empty() ? "-" : karp_flatt) << "\t" << (weak_efficiency.empty() ? "-" : weak_efficiency) << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+/* allocation counters of one corpus's document maps */
+static void print_allocator_stats(const std::string& corpus_name, const arena::AllocatorStats& stats) {
+    std::cout << "Allocator (" << corpus_name << "): " << stats.allocations << " allocations, " 
+              << stats.deallocations << " frees, " 
+              << stats.bytes / 1024 << " KiB requested, " 
+              << stats.reserved / 1024 << " KiB in " << stats.blocks << " arena blocks, " 
+              << stats.threads << " threads" << std::endl;
+}
 
 int main(int argc, char * argv[]) {
 
@@ -11,23 +839,83 @@ int main(int argc, char * argv[]) {
         return 1;
     }
 
+    /* benchmark modes */
+    if (std::string(argv[1]) == "bench-df")
+        return run_df_benchmark(argc >= 3 ? atoi(argv[2]) : NUMBER_OF_THREADS_MAX);
+    if (std::string(argv[1]) == "serve")
+        return run_server(argc >= 3 ? atoi(argv[2]) : 1, argc >= 4 ? argv[3] : "");
+    if (std::string(argv[1]) == "bench-serve")
+        return run_serve_benchmark(argc >= 3 ? atoi(argv[2]) : 1, argc >= 4 ? atoi(argv[3]) : 4);
+    if (std::string(argv[1]) == "bench-incremental")
+        return run_incremental_benchmark(argc >= 3 ? atoi(argv[2]) : 1, argc >= 4 ? atoi(argv[3]) : 4);
+    if (std::string(argv[1]) == "bench-classify")
+        return run_classify_benchmark(argc >= 3 ? atoi(argv[2]) : 1, argc >= 4 ? atoi(argv[3]) : 1);
+    if (std::string(argv[1]) == "check-csv")
+        return run_csv_check(argc >= 3 ? atoi(argv[2]) : 4);
+    if (std::string(argv[1]) == "generate")
+        return run_generator(argc, argv);
+    if (std::string(argv[1]) == "scaling")
+        return run_scaling_harness(argc, argv);
+
+    /* separate --options from the dataset and thread arguments */
+    std::vector<std::string> args;
+    std::set<std::string> options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg{argv[i]};
+        if (arg.rfind("--", 0) == 0)
+            options.insert(arg);
+        else
+            args.push_back(arg);
+    }
+
+    if (args.empty()) {
+        std::cerr << "No dataset specified..." << std::endl << "Terminating early." << std::endl;
+        return 1;
+    }
+
+    bool is_parallel = args.size() >= 2;
+    bool use_csr = options.count("--csr") > 0;
+    bool use_stem_file = options.count("--stem-cache") > 0;
+    bool use_streaming = options.count("--stream") > 0;
+    bool save_model = options.count("--save-model") > 0;
+    bool load_model = options.count("--load-model") > 0;
+    bool use_training_idf = options.count("--train-idf") > 0;
+    bool use_arenas = options.count("--arena") > 0;
+    bool use_numa = options.count("--numa") > 0;
+    bool write_profile = options.count("--profile") > 0;
+    std::string stopword_file;
+    for (const std::string& option : options)
+        if (option.rfind("--stopwords=", 0) == 0)
+            stopword_file = option.substr(std::strlen("--stopwords="));
+    int dataset = atoi(args[0].c_str());
+    int num_threads = is_parallel ? atoi(args[1].c_str()) : 1;
+
     /* acquire dataset number */
-    std::string input_folder{"tests/data/dataset-" + std::to_string(atoi(argv[1])) + "/"};
+    std::string input_folder{"tests/data/dataset-" + std::to_string(dataset) + "/"};
     std::string input_training{input_folder + "training-data.csv"};
     std::string input_testing_txt{input_folder + "testing-data.txt"};
     std::string input_testing_cat{input_folder + "testing-correct-data.txt"};
 
     /* set the output files */
     std::string base_output_folder{"tests/output/"}; 
-    std::string base_file_name{""};
-    if (argc < 3) {
-        base_file_name += "sequential-" + std::to_string(atoi(argv[1])) + "-";
+    std::string base_file_name{load_model ? "model-" : use_streaming ? "stream-" : use_csr ? "csr-" : ""};
+    if (use_training_idf)
+        base_file_name += "train-idf-";
+    if (use_arenas)
+        base_file_name += "arena-";
+    if (use_numa)
+        base_file_name += "numa-";
+    if (!is_parallel) {
+        base_file_name += "sequential-" + std::to_string(dataset) + "-";
     } else {
-        base_file_name += "parallel-" + std::to_string(atoi(argv[2])) + "-" + std::to_string(atoi(argv[1])) + "-";
+        base_file_name += "parallel-" + std::to_string(num_threads) + "-" + std::to_string(dataset) + "-";
     }
     std::string results_output{base_output_folder + "results/" + base_file_name + "results.txt"};
     std::string logging_output{base_output_folder + "logs/" + base_file_name + "errors.log"};
     std::string procssd_output{base_output_folder + "processed-data-results/" + base_file_name + "processed.csv"};
+    std::string stem_cache_file{base_output_folder + "stem-cache.txt"};
+    std::string model_file{base_output_folder + "model-" + std::to_string(dataset) + ".bin"};
+    std::string profile_output{base_output_folder + "results/" + base_file_name + "profile"};
 
     /* grab std::out and send to files */
     std::ofstream out(results_output);
@@ -37,9 +925,28 @@ int main(int argc, char * argv[]) {
     std::cout.rdbuf(out.rdbuf());
     std::cerr.rdbuf(err.rdbuf());
 
+    /* replace the English stopwords before anything is vectorized */
+    static stopwords::StopwordSet loaded_stopwords;
+    if (!stopword_file.empty()) {
+        try {
+            loaded_stopwords = stopwords::load(stopword_file);
+            stopwords::set_active(loaded_stopwords);
+        } catch (std::runtime_error &e) {
+            std::cerr << "No stopwords loaded, using English: " << e.what() << std::endl;
+        }
+    }
+    /* warm the stem cache from a previous run */
+    if (use_stem_file) {
+        try {
+            stem::stem_cache.load(stem_cache_file);
+        } catch (std::runtime_error &e) {
+            std::cerr << "No stem cache loaded: " << e.what() << std::endl;
+        }
+    }
+
     /* initialize TF-IDF object */
     TFIDF::TFIDF_ tfidf{
-        argc >= 3,         // using multithreading?
+        is_parallel,       // using multithreading?
         input_training,    // training data file
         input_testing_txt, // testing data file
         input_testing_cat, // correct testing categories file
@@ -52,21 +959,89 @@ int main(int argc, char * argv[]) {
         true, // output the testing data classifications
         true, // convert output to processed CSV files
         true, // log errors
-        argc >= 3 ? atoi(argv[2]) : 1 // number of threads to use
+        num_threads, // number of threads to use
+        use_csr,     // frozen CSR corpus for TF-IDF, categories, classification
+        use_streaming, // stream the input files in batches (implies CSR)
+        use_training_idf, // weight unknown documents with the trained IDF
+        topk::DEFAULT_IMPORTANT_TERMS, // top terms kept per category
+        use_arenas, // per-thread arenas for the documents' term maps
+        use_numa    // workers pinned per NUMA node, documents and read-only tables placed per node
     };
 
-    tfidf.process_all_data(); // process both training and testing data
+    if (load_model) {
+        /* classify only, the trained categories come from a previous --save-model run */
+        auto start = std::chrono::high_resolution_clock::now();
+        bool loaded = tfidf.load_model(model_file);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        if (loaded) {
+            std::cout << "Model: loaded " << model_file << " in " << elapsed_time_ms(start, end) << " ms" << std::endl;
+            tfidf.process_testing_data();
+        }
+    } else {
+        tfidf.process_all_data(); // process both training and testing data
+
+        if (save_model && tfidf.save_model(model_file))
+            std::cout << "Model: saved " << model_file << std::endl;
+    }
+
+    std::cout << "Stopwords: " << stopwords::active().size() << " in use" << std::endl;
+
+    /* items every NUMA node processed per section, to check the placement */
+    if (use_numa) {
+        for (int section = vectorization_; section <= unknown_; section++) {
+            for (const tpool::NodeStats& node : tfidf.section_node_stats[section]) {
+                std::cout << "NUMA node " << node.node << " (" << SECTION_NAME[section] << "): " 
+                          << node.workers << " workers, " << node.items << " items in " 
+                          << node.tasks << " tasks, " << node.busy_ns / 1e6 << " ms busy, " 
+                          << node.items_per_second() << " items/s" << std::endl;
+            }
+        }
+    }
+
+    /* per-stage and per-thread times, sub-stages only with PROFILE=1 builds */
+    if (write_profile) {
+        try {
+            prof::profiler().write_json(profile_output + ".json");
+            prof::profiler().write_csv(profile_output + ".csv");
+        } catch (std::runtime_error &e) {
+            std::cerr << "Error writing profile: " << e.what() << std::endl;
+        }
+    }
+
+    /* stem cache counters, for sizing the cache */
+    stem::CacheStats stem_stats = stem::stem_cache.stats();
+    std::cout << "Stem Cache: " << stem_stats.l1_hits << " L1 hits, " 
+              << stem_stats.shared_hits << " shared hits, " 
+              << stem_stats.misses << " misses, " 
+              << stem_stats.entries << " entries (" 
+              << stem_stats.hit_rate() * 100 << "% hit rate)" << std::endl;
+
+    /* allocator counters of the documents' term maps, then the cost of freeing them */
+    print_allocator_stats("trained", tfidf.trained_corpus.allocator_stats());
+    print_allocator_stats("unknown", tfidf.un_trained_corpus.allocator_stats());
+    auto release_start = std::chrono::high_resolution_clock::now();
+    tfidf.trained_corpus.release_documents();
+    tfidf.un_trained_corpus.release_documents();
+    auto release_end = std::chrono::high_resolution_clock::now();
+    std::cout << "Allocator: corpora freed in " << elapsed_time_ms(release_start, release_end) << " ms" << std::endl;
+
+    if (use_stem_file) {
+        try {
+            stem::stem_cache.save(stem_cache_file);
+        } catch (std::runtime_error &e) {
+            std::cerr << "Error saving stem cache: " << e.what() << std::endl;
+        }
+    }
 
     /* close the buffer */
     std::cout.rdbuf(coutBuf);
     std::cerr.rdbuf(cerrBuf);
 
     /* notify user of completion */
-    bool is_parallel = argc >= 3;
-    int dataset = atoi(argv[1]);
     std::cout << "\n  ✅ Test complete!" << std::endl;
     if (is_parallel) {
-        std::cout << "  🧵 Mode:     Parallel (" << atoi(argv[2]) << " threads)" << std::endl;
+        std::cout << "  🧵 Mode:     Parallel (" << num_threads << " threads)" << std::endl;
     } else {
         std::cout << "  🔁 Mode:     Sequential" << std::endl;
     }